@@ -0,0 +1,55 @@
+#include "cache.hpp"
+
+#include <immintrin.h>
+
+namespace DiStore::Cache {
+    NodeCache::NodeCache() : slots(std::make_unique<Slot[]>(Constants::NODE_CACHE_SLOTS)) {
+        for (size_t i = 0; i < Constants::NODE_CACHE_SLOTS; i++) {
+            slots[i].seq = 0;
+            slots[i].key = 0;
+        }
+    }
+
+    auto NodeCache::prepare(const RemotePointer &p) const noexcept -> uint64_t {
+        return slot_of(p).seq.load(std::memory_order_acquire);
+    }
+
+    auto NodeCache::fill(const RemotePointer &p, uint64_t token, const DataLayer::LinkedNode16 *image) noexcept
+        -> bool
+    {
+        auto &slot = slot_of(p);
+
+        // a writer or another fill came in between
+        if ((token & 1) || !slot.seq.compare_exchange_strong(token, token + 1)) {
+            return false;
+        }
+
+        slot.key.store(key_of(p), std::memory_order_relaxed);
+        memcpy(&slot.image, image, sizeof(DataLayer::LinkedNode16));
+        slot.seq.store(token + 2, std::memory_order_release);
+        return true;
+    }
+
+    auto NodeCache::invalidate(const RemotePointer &p) noexcept -> void {
+        auto &slot = slot_of(p);
+
+        // the slot is bumped even if it holds another node, to drop pending fills of p
+        auto seq = slot.seq.load(std::memory_order_relaxed);
+        while (true) {
+            if (seq & 1) {
+                _mm_pause();
+                seq = slot.seq.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (slot.seq.compare_exchange_weak(seq, seq + 1)) {
+                break;
+            }
+        }
+
+        if (slot.key.load(std::memory_order_relaxed) == key_of(p)) {
+            slot.key.store(0, std::memory_order_relaxed);
+        }
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+}
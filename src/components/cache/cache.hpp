@@ -0,0 +1,84 @@
+#ifndef __DISTORE__CACHE__CACHE__
+#define __DISTORE__CACHE__CACHE__
+#include "memory/memory.hpp"
+#include "memory/remote_memory/remote_memory.hpp"
+#include "data_layer/data_layer.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace DiStore::Cache {
+    using namespace Memory;
+    namespace Constants {
+        // a power of two, each slot holds one LinkedNode16 image
+        static constexpr size_t NODE_CACHE_SLOTS = 4096;
+    }
+
+    /*
+     * A direct-mapped cache of data node images on the compute node, keyed by their
+     * remote addresses. Each slot is a seqlock, so readers never write shared memory
+     * and a slot changing under a reader turns the read into a miss.
+     *
+     * A fill takes a token from the slot before the remote read and is dropped if the
+     * slot changed since then. Whoever writes a data node back invalidates it afterwards,
+     * which bumps the slot, so a fill racing with the write back can not bring the old
+     * image in again.
+     */
+    class NodeCache {
+    public:
+        NodeCache();
+        NodeCache(const NodeCache &) = delete;
+        NodeCache(NodeCache &&) = delete;
+        auto operator=(const NodeCache &) = delete;
+        auto operator=(NodeCache &&) = delete;
+        ~NodeCache() = default;
+
+        // call before reading p remotely, the result is given to fill
+        auto prepare(const RemotePointer &p) const noexcept -> uint64_t;
+        auto fill(const RemotePointer &p, uint64_t token, const DataLayer::LinkedNode16 *image) noexcept
+            -> bool;
+        auto invalidate(const RemotePointer &p) noexcept -> void;
+
+        inline auto contains(const RemotePointer &p) const noexcept -> bool {
+            return slot_of(p).key.load(std::memory_order_relaxed) == key_of(p);
+        }
+
+        /*
+         * Run f on the cached image of p. Return true only if f returns true and the image
+         * is not changed meanwhile; otherwise whatever f produced should be thrown away
+         */
+        template <typename F>
+        auto read(const RemotePointer &p, F &&f) const noexcept -> bool {
+            auto &slot = slot_of(p);
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            if ((seq & 1) || slot.key.load(std::memory_order_relaxed) != key_of(p)) {
+                return false;
+            }
+
+            auto ok = f(slot.image);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return ok && slot.seq.load(std::memory_order_relaxed) == seq;
+        }
+
+    private:
+        struct alignas(64) Slot {
+            // odd while the slot is written
+            std::atomic<uint64_t> seq;
+            std::atomic<uint64_t> key;
+            DataLayer::LinkedNode16 image;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+
+        static inline auto key_of(const RemotePointer &p) noexcept -> uint64_t {
+            return reinterpret_cast<uint64_t>(p.raw_ptr());
+        }
+
+        inline auto slot_of(const RemotePointer &p) const noexcept -> Slot & {
+            // Fibonacci hashing, nodes are allocated at regular strides
+            auto h = (key_of(p) * 0x9e3779b97f4a7c15UL) >> 32;
+            return slots[h & (Constants::NODE_CACHE_SLOTS - 1)];
+        }
+    };
+}
+#endif
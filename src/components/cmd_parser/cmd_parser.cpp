@@ -1,3 +1,5 @@
 #include "cmd_parser.hpp"
 const std::string CmdParser::Parser::regex_long_suffix = "=*\\s*(\\S+)";
 const std::string CmdParser::Parser::regex_short_suffix = "\\s*(\\S+)";
+const std::string CmdParser::Parser::regex_switch_long_suffix = "(?:=(\\S+))?\\s";
+const std::string CmdParser::Parser::regex_switch_short_suffix = "()\\s";
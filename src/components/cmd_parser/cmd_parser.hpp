@@ -67,8 +67,10 @@ namespace CmdParser {
         auto operator=( Parser &&) -> Parser & = default;
         ~Parser() = default;
 
+        // a switch takes no value, it is on once given, or set with --switch=true/false
         auto add_switch(const std::string &full, const std::string &shrt) -> bool {
-            return regex_map.insert({full, {full + regex_long_suffix, shrt + regex_short_suffix}}).second;
+            return regex_map.insert({full, {full + regex_switch_long_suffix,
+                                            shrt + regex_switch_short_suffix}}).second;
         }
 
         auto more_switch(const std::string &full, const std::string &shrt) -> Parser & {
@@ -77,7 +79,6 @@ namespace CmdParser {
         }
 
         auto add_switch(const std::string &full, const std::string &shrt, bool default_value) -> bool {
-            auto pair = std::make_pair(full + regex_long_suffix, shrt + regex_short_suffix);
             if (!add_switch(full, shrt)) {
                 return false;
             }
@@ -247,6 +248,8 @@ namespace CmdParser {
     private:
         static const std::string regex_long_suffix;
         static const std::string regex_short_suffix;
+        static const std::string regex_switch_long_suffix;
+        static const std::string regex_switch_short_suffix;
         OptionMap plain_map;
         RegexMap regex_map;
         mutable ParsedOptionMap parsed_map;
@@ -6,6 +6,12 @@
 #define __STATS__
 #define __BREAKDOWN__
 #define __HUGE_PAGE__
+// index the bottom level of the search layer with a B+-tree instead of skip list towers
+// #define __BTREE_SEARCH_LAYER__
+// cache images of hot data nodes on the compute node
+#define __NODE_CACHE__
+// revalidate cached images with a header read, needed if several compute nodes write
+// #define __CACHE_REVALIDATE__
 namespace DiStore {
     namespace Config {
 
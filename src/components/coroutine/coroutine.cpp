@@ -0,0 +1,157 @@
+#include "coroutine.hpp"
+
+namespace DiStore::Coroutine {
+    auto SlotAwaiter::await_ready() noexcept -> bool {
+        if (sched->free_slots.empty()) {
+            return false;
+        }
+
+        slot = sched->free_slots.back();
+        sched->free_slots.pop_back();
+        return true;
+    }
+
+    auto SlotAwaiter::await_suspend(std::coroutine_handle<> h) -> void {
+        sched->slot_waiters.push_back({h, &slot});
+    }
+
+    auto YieldAwaiter::await_suspend(std::coroutine_handle<> h) -> void {
+        sched->ready.push_back(h);
+    }
+
+    RDMAAwaiter::RDMAAwaiter(Scheduler *s, int slot_, enum ibv_wr_opcode op,
+                             const Request *reqs, size_t count_)
+        : sched(s), slot(slot_), opcode(op), count(count_)
+    {
+        if (count > Constants::MAX_CHAIN) {
+            throw std::runtime_error("Too many requests in one chain\n");
+        }
+
+        std::copy(reqs, reqs + count, requests.begin());
+    }
+
+    auto RDMAAwaiter::await_suspend(std::coroutine_handle<> h) -> bool {
+        sched->states[slot].waiter = h;
+        return sched->post(slot, opcode, requests.data(), count) != 0;
+    }
+
+    auto RDMAAwaiter::await_resume() const noexcept -> bool {
+        return count == 0 || sched->states[slot].succeed;
+    }
+
+    Scheduler::Scheduler(std::vector<RDMAContext *> rdma_, size_t slots, size_t slot_size_)
+        : rdma(std::move(rdma_)), slot_size(slot_size_), states(slots), wcs(slots),
+          live(0), finished(0)
+    {
+        buffer = reinterpret_cast<byte_ptr_t>(rdma.front()->get_edible_buf());
+
+        // hand out low slots first
+        for (int i = slots - 1; i >= 0; i--) {
+            free_slots.push_back(i);
+        }
+    }
+
+    auto Scheduler::spawn(Task<void> task) -> void {
+        ++live;
+        run(this, std::move(task));
+    }
+
+    auto Scheduler::run(Scheduler *sched, Task<void> task) -> Detached {
+        co_await task;
+        --sched->live;
+        ++sched->finished;
+    }
+
+    auto Scheduler::poll() -> size_t {
+        auto before = finished;
+
+        for (auto ctx : rdma) {
+            auto polled = ctx->poll_completions(wcs.data(), wcs.size());
+            for (int i = 0; i < polled; i++) {
+                auto &state = states[wcs[i].wr_id];
+                if (wcs[i].status != IBV_WC_SUCCESS) {
+                    Debug::error("Request of slot %lu failed with %s\n", wcs[i].wr_id,
+                                 ibv_wc_status_str(wcs[i].status));
+                    state.succeed = false;
+                }
+
+                if (--state.outstanding == 0) {
+                    state.waiter.resume();
+                }
+            }
+        }
+
+        // coroutines yielding now are resumed in the next poll
+        auto rounds = ready.size();
+        for (size_t i = 0; i < rounds; i++) {
+            auto h = ready.front();
+            ready.pop_front();
+            h.resume();
+        }
+
+        return finished - before;
+    }
+
+    auto Scheduler::release(int slot) -> void {
+        if (slot_waiters.empty()) {
+            free_slots.push_back(slot);
+            return;
+        }
+
+        auto [h, granted] = slot_waiters.front();
+        slot_waiters.pop_front();
+        *granted = slot;
+        ready.push_back(h);
+    }
+
+    auto Scheduler::post(int slot, enum ibv_wr_opcode opcode, const Request *reqs, size_t count)
+        -> size_t
+    {
+        auto &state = states[slot];
+        state.outstanding = 0;
+        state.succeed = true;
+
+        struct ibv_send_wr *heads[Constants::MAX_CHAIN] = {nullptr};
+        struct ibv_send_wr *tails[Constants::MAX_CHAIN] = {nullptr};
+        int nodes[Constants::MAX_CHAIN];
+        size_t chains = 0;
+
+        // one chain per memory node, and only its last request is signaled
+        for (size_t i = 0; i < count; i++) {
+            auto node = reqs[i].remote.get_node();
+
+            size_t c = 0;
+            while (c < chains && nodes[c] != node) {
+                ++c;
+            }
+            if (c == chains) {
+                nodes[chains++] = node;
+            }
+
+            auto wr = rdma[node]->next_send_wr(slot, reqs[i].size, slot * slot_size + reqs[i].offset,
+                                               reqs[i].remote.get_as<byte_ptr_t>(), opcode);
+            wr->send_flags = 0;
+
+            if (tails[c]) {
+                tails[c]->next = wr;
+            } else {
+                heads[c] = wr;
+            }
+            tails[c] = wr;
+        }
+
+        for (size_t c = 0; c < chains; c++) {
+            tails[c]->send_flags = IBV_SEND_SIGNALED;
+            auto ctx = rdma[nodes[c]];
+            auto [status, _] = opcode == IBV_WR_RDMA_READ ?
+                ctx->post_batch_read(heads[c]) : ctx->post_batch_write(heads[c]);
+            if (status != RDMAUtil::Enums::Status::Ok) {
+                state.succeed = false;
+                break;
+            }
+            ++state.outstanding;
+        }
+
+        return state.outstanding;
+    }
+}
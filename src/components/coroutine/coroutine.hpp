@@ -0,0 +1,333 @@
+#ifndef __DISTORE__COROUTINE__COROUTINE__
+#define __DISTORE__COROUTINE__COROUTINE__
+#include "memory/memory.hpp"
+#include "memory/remote_memory/remote_memory.hpp"
+#include "rdma_util/rdma_util.hpp"
+#include "debug/debug.hpp"
+
+#include <array>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace DiStore::Coroutine {
+    using namespace Memory;
+    using namespace RDMAUtil;
+
+    namespace Constants {
+        // a split writes the predecessor and two halves in one chain
+        static constexpr size_t MAX_CHAIN = 3;
+    }
+
+    template<typename T>
+    class Task;
+
+    namespace Detail {
+        // resume whoever co_awaits the finished task
+        struct FinalAwaiter {
+            auto await_ready() const noexcept -> bool {
+                return false;
+            }
+
+            template<typename Promise>
+            auto await_suspend(std::coroutine_handle<Promise> h) noexcept -> std::coroutine_handle<> {
+                if (auto c = h.promise().continuation; c) {
+                    return c;
+                }
+                return std::noop_coroutine();
+            }
+
+            auto await_resume() const noexcept -> void {}
+        };
+
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            auto initial_suspend() const noexcept -> std::suspend_always {
+                return {};
+            }
+
+            auto final_suspend() const noexcept -> FinalAwaiter {
+                return {};
+            }
+
+            auto unhandled_exception() noexcept -> void {
+                exception = std::current_exception();
+            }
+        };
+
+        template<typename T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+
+            auto get_return_object() -> Task<T>;
+
+            auto return_value(T v) -> void {
+                value = std::move(v);
+            }
+
+            auto result() -> T {
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct Promise<void> : PromiseBase {
+            auto get_return_object() -> Task<void>;
+
+            auto return_void() const noexcept -> void {}
+
+            auto result() -> void {
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+        };
+    }
+
+    /*
+     * A lazily started coroutine. It runs when co_awaited and resumes the awaiting
+     * coroutine on completion, so nested tasks do not grow the native stack
+     */
+    template<typename T = void>
+    class Task {
+    public:
+        using promise_type = Detail::Promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        explicit Task(handle_type h) : handle(h) {}
+        Task(const Task &) = delete;
+        Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        auto operator=(const Task &) = delete;
+        auto operator=(Task &&other) noexcept -> Task & {
+            if (this != &other) {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task() {
+            if (handle)
+                handle.destroy();
+        }
+
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+
+        auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<> {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        auto await_resume() -> T {
+            return handle.promise().result();
+        }
+
+    private:
+        handle_type handle;
+    };
+
+    template<typename T>
+    inline auto Detail::Promise<T>::get_return_object() -> Task<T> {
+        return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+    }
+
+    inline auto Detail::Promise<void>::get_return_object() -> Task<void> {
+        return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+    }
+
+    // an eagerly started coroutine that frees itself once finished
+    struct Detached {
+        struct promise_type {
+            auto get_return_object() const noexcept -> Detached {
+                return {};
+            }
+
+            auto initial_suspend() const noexcept -> std::suspend_never {
+                return {};
+            }
+
+            auto final_suspend() const noexcept -> std::suspend_never {
+                return {};
+            }
+
+            auto return_void() const noexcept -> void {}
+
+            auto unhandled_exception() const noexcept -> void {
+                std::terminate();
+            }
+        };
+    };
+
+    // a remote range and the offset in a slot it is read into or written from
+    struct Request {
+        RemotePointer remote;
+        size_t size;
+        size_t offset;
+    };
+
+    class Scheduler;
+
+    class SlotAwaiter {
+    public:
+        SlotAwaiter(Scheduler *s) : sched(s), slot(-1) {}
+
+        auto await_ready() noexcept -> bool;
+        auto await_suspend(std::coroutine_handle<> h) -> void;
+        auto await_resume() const noexcept -> int {
+            return slot;
+        }
+
+    private:
+        Scheduler *sched;
+        int slot;
+    };
+
+    class YieldAwaiter {
+    public:
+        YieldAwaiter(Scheduler *s) : sched(s) {}
+
+        auto await_ready() const noexcept -> bool {
+            return false;
+        }
+        auto await_suspend(std::coroutine_handle<> h) -> void;
+        auto await_resume() const noexcept -> void {}
+
+    private:
+        Scheduler *sched;
+    };
+
+    class RDMAAwaiter {
+    public:
+        RDMAAwaiter(Scheduler *s, int slot_, enum ibv_wr_opcode op, const Request *reqs, size_t count_);
+
+        auto await_ready() const noexcept -> bool {
+            return count == 0;
+        }
+        // do not suspend if nothing could be posted
+        auto await_suspend(std::coroutine_handle<> h) -> bool;
+        // whether all requests succeed
+        auto await_resume() const noexcept -> bool;
+
+    private:
+        Scheduler *sched;
+        int slot;
+        enum ibv_wr_opcode opcode;
+        std::array<Request, Constants::MAX_CHAIN> requests;
+        size_t count;
+    };
+
+    /*
+     * Per-thread scheduler driving coroutines over a set of RDMA contexts (one per memory
+     * node) that share a buffer. The buffer is cut into slots, and a coroutine acquires a
+     * slot before it touches remote memory. Requests of a slot are posted with the slot
+     * index as wr_id, and poll() resumes the coroutine once all chains of the slot complete.
+     *
+     * Not thread-safe, every thread owns its scheduler
+     */
+    class Scheduler {
+    public:
+        Scheduler(std::vector<RDMAContext *> rdma, size_t slots, size_t slot_size);
+        Scheduler(const Scheduler &) = delete;
+        Scheduler(Scheduler &&) = delete;
+        auto operator=(const Scheduler &) = delete;
+        auto operator=(Scheduler &&) = delete;
+
+        // start a task, it is freed once finished
+        auto spawn(Task<void> task) -> void;
+
+        // resume coroutines whose requests completed, return the number of finished tasks
+        auto poll() -> size_t;
+
+        inline auto alive() const noexcept -> size_t {
+            return live;
+        }
+
+        inline auto acquire() noexcept -> SlotAwaiter {
+            return SlotAwaiter(this);
+        }
+        auto release(int slot) -> void;
+
+        inline auto yield() noexcept -> YieldAwaiter {
+            return YieldAwaiter(this);
+        }
+
+        /*
+         * co_await read(...) or write(...) to transfer up to MAX_CHAIN requests of a slot
+         * in one go. The result tells whether all requests succeed.
+         *
+         * There is no initializer_list version because GCC can not keep its backing array
+         * in a coroutine frame
+         */
+        inline auto read(int slot, const Request &a) -> RDMAAwaiter {
+            return RDMAAwaiter(this, slot, IBV_WR_RDMA_READ, &a, 1);
+        }
+
+        inline auto read(int slot, const Request &a, const Request &b) -> RDMAAwaiter {
+            Request reqs[] = {a, b};
+            return RDMAAwaiter(this, slot, IBV_WR_RDMA_READ, reqs, 2);
+        }
+
+        inline auto write(int slot, const Request &a) -> RDMAAwaiter {
+            return RDMAAwaiter(this, slot, IBV_WR_RDMA_WRITE, &a, 1);
+        }
+
+        inline auto write(int slot, const Request &a, const Request &b) -> RDMAAwaiter {
+            Request reqs[] = {a, b};
+            return RDMAAwaiter(this, slot, IBV_WR_RDMA_WRITE, reqs, 2);
+        }
+
+        inline auto write(int slot, const Request &a, const Request &b, const Request &c)
+            -> RDMAAwaiter
+        {
+            Request reqs[] = {a, b, c};
+            return RDMAAwaiter(this, slot, IBV_WR_RDMA_WRITE, reqs, 3);
+        }
+
+        inline auto slot_buffer(int slot) const noexcept -> byte_ptr_t {
+            return buffer + slot * slot_size;
+        }
+
+    private:
+        friend class SlotAwaiter;
+        friend class YieldAwaiter;
+        friend class RDMAAwaiter;
+
+        struct SlotState {
+            std::coroutine_handle<> waiter;
+            size_t outstanding;
+            bool succeed;
+        };
+
+        std::vector<RDMAContext *> rdma;
+        byte_ptr_t buffer;
+        size_t slot_size;
+        std::vector<SlotState> states;
+        std::vector<struct ibv_wc> wcs;
+
+        std::vector<int> free_slots;
+        // coroutines waiting for a slot, and where to put the granted slot
+        std::deque<std::pair<std::coroutine_handle<>, int *>> slot_waiters;
+        std::deque<std::coroutine_handle<>> ready;
+
+        size_t live;
+        size_t finished;
+
+        static auto run(Scheduler *sched, Task<void> task) -> Detached;
+
+        // post requests of slot chained by memory node, return the number of posted chains
+        auto post(int slot, enum ibv_wr_opcode opcode, const Request *reqs, size_t count) -> size_t;
+    };
+}
+#endif
@@ -1 +1,122 @@
 #include "data_layer.hpp"
+
+#include <array>
+#include <immintrin.h>
+
+namespace DiStore::DataLayer {
+    static inline auto load_be(const byte_t *p) noexcept -> uint64_t {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        return __builtin_bswap64(w);
+    }
+
+    // order slots a and b ascending if up is set, otherwise descending
+    static inline auto compare_exchange(uint64_t *hi, uint64_t *lo, uint64_t *slot, size_t a, size_t b, bool up)
+        noexcept -> void
+    {
+        auto greater = hi[a] > hi[b] || (hi[a] == hi[b] && lo[a] > lo[b]);
+        if (greater == up) {
+            std::swap(hi[a], hi[b]);
+            std::swap(lo[a], lo[b]);
+            std::swap(slot[a], slot[b]);
+        }
+    }
+
+#if defined(__AVX2__)
+    // compare-exchange slots [a, a + 4) with [b, b + 4) in the same direction
+    static inline auto compare_exchange4(uint64_t *hi, uint64_t *lo, uint64_t *slot, size_t a, size_t b, bool up)
+        noexcept -> void
+    {
+        // there is no unsigned 64-bit comparison, flip the sign bits instead
+        const auto sign = _mm256_set1_epi64x(INT64_MIN);
+        auto ah = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hi + a));
+        auto bh = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hi + b));
+        auto al = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lo + a));
+        auto bl = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lo + b));
+        auto as = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(slot + a));
+        auto bs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(slot + b));
+
+        auto sah = _mm256_xor_si256(ah, sign), sbh = _mm256_xor_si256(bh, sign);
+        auto sal = _mm256_xor_si256(al, sign), sbl = _mm256_xor_si256(bl, sign);
+        auto eq = _mm256_cmpeq_epi64(sah, sbh);
+        auto swap = up ? _mm256_or_si256(_mm256_cmpgt_epi64(sah, sbh),
+                                         _mm256_and_si256(eq, _mm256_cmpgt_epi64(sal, sbl)))
+                       : _mm256_or_si256(_mm256_cmpgt_epi64(sbh, sah),
+                                         _mm256_and_si256(eq, _mm256_cmpgt_epi64(sbl, sal)));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(hi + a), _mm256_blendv_epi8(ah, bh, swap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(hi + b), _mm256_blendv_epi8(bh, ah, swap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lo + a), _mm256_blendv_epi8(al, bl, swap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lo + b), _mm256_blendv_epi8(bl, al, swap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(slot + a), _mm256_blendv_epi8(as, bs, swap));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(slot + b), _mm256_blendv_epi8(bs, as, swap));
+    }
+#endif
+
+    auto sort_keys(const KV *pairs, size_t count, uint8_t *perm) noexcept -> void {
+        static_assert(Constants::KEYLEN == 2 * sizeof(uint64_t));
+
+        // pad to a power of two with max keys, which sink to the end
+        size_t width = 4;
+        while (width < count) {
+            width <<= 1;
+        }
+
+        alignas(32) uint64_t hi[Constants::SORT_WIDTH];
+        alignas(32) uint64_t lo[Constants::SORT_WIDTH];
+        alignas(32) uint64_t slot[Constants::SORT_WIDTH];
+        for (size_t i = 0; i < width; i++) {
+            hi[i] = i < count ? load_be(pairs[i].key) : UINT64_MAX;
+            lo[i] = i < count ? load_be(pairs[i].key + sizeof(uint64_t)) : UINT64_MAX;
+            slot[i] = i;
+        }
+
+        for (size_t k = 2; k <= width; k <<= 1) {
+            for (size_t j = k >> 1; j > 0; j >>= 1) {
+#if defined(__AVX2__)
+                // partners at least four slots apart are four contiguous lanes
+                if (j >= 4) {
+                    for (size_t i = 0; i < width; i += 4) {
+                        if ((i & j) == 0) {
+                            compare_exchange4(hi, lo, slot, i, i + j, (i & k) == 0);
+                        }
+                    }
+                    continue;
+                }
+#endif
+                for (size_t i = 0; i < width; i++) {
+                    if (auto l = i ^ j; l > i) {
+                        compare_exchange(hi, lo, slot, i, l, (i & k) == 0);
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            perm[i] = slot[i];
+        }
+    }
+
+    static constexpr auto make_crc32c_table() -> std::array<uint32_t, 256> {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++) {
+            auto c = i;
+            for (int k = 0; k < 8; k++) {
+                // reflected Castagnoli polynomial
+                c = (c >> 1) ^ ((c & 1) ? 0x82F63B78U : 0);
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+
+    static constexpr auto crc32c_table = make_crc32c_table();
+
+    auto crc32c_sw(uint32_t crc, const void *data, size_t len) noexcept -> uint32_t {
+        auto p = reinterpret_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < len; i++) {
+            crc = crc32c_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+}
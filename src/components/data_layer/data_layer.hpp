@@ -6,13 +6,28 @@
 #include "misc/misc.hpp"
 #include "workload/workload.hpp"
 
-#include <boost/crc.hpp>
+#include <string_view>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
 
 namespace DiStore::DataLayer {
     using namespace Memory;
     namespace Constants {
         static constexpr size_t KEYLEN = Workload::Constants::KEY_SIZE;
         static constexpr size_t VALLEN = KEYLEN;
+        // the largest number of keys sort_keys takes, a power of two
+        static constexpr size_t SORT_WIDTH = 32;
+        // fingerprints covered by a node checksum, which are all of a remote node
+        static constexpr size_t CRC_FINGERPRINTS = 16;
+        // "DISTORE" followed by the layout version
+        static constexpr uint64_t SUPERBLOCK_MAGIC = 0x44495354'4f524501;
+        // data nodes a checkpoint samples, the superblock fills one memory page
+        static constexpr size_t SUPERBLOCK_SAMPLES =
+            (Memory::Constants::MEMORY_PAGE_SIZE - 3 * sizeof(uint64_t)) / sizeof(uint64_t);
     }
 
     namespace Enums {
@@ -37,83 +52,260 @@ namespace DiStore::DataLayer {
 
     using namespace Enums;
 
+    /*
+     * Sort the first count (at most 32) keys of pairs with a bitonic network and put
+     * their slots into perm in ascending key order. Keys are compared as two big-endian
+     * words kept in separated hi and lo arrays, so that with AVX2 four compare-exchanges
+     * of a step are done at once
+     */
+    auto sort_keys(const KV *pairs, size_t count, uint8_t *perm) noexcept -> void;
+
+    // table-driven crc32c for targets without SSE4.2
+    auto crc32c_sw(uint32_t crc, const void *data, size_t len) noexcept -> uint32_t;
+
+    // CRC32C (Castagnoli) of len bytes continuing from crc, without pre or post inversion
+    inline auto crc32c(uint32_t crc, const void *data, size_t len) noexcept -> uint32_t {
+#if defined(__SSE4_2__) && defined(__x86_64__)
+        auto p = reinterpret_cast<const uint8_t *>(data);
+        uint64_t c = crc;
+        for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+            uint64_t w;
+            memcpy(&w, p, sizeof(w));
+            c = _mm_crc32_u64(c, w);
+        }
+
+        for (; len > 0; --len, ++p) {
+            c = _mm_crc32_u8((uint32_t)c, *p);
+        }
+        return (uint32_t)c;
+#else
+        return crc32c_sw(crc, data, len);
+#endif
+    }
+
+    /*
+     * A node checksum is the xor of the checksum of next and the fingerprints and those of
+     * the slots, so that a change to one slot replaces a single term. A slot is seeded by
+     * its index, otherwise pairs moved to other slots would go unnoticed
+     */
+    inline auto header_crc(uint32_t next, const uint8_t *fingerprints) noexcept -> uint32_t {
+        return crc32c(crc32c(UINT32_MAX, &next, sizeof(next)), fingerprints, Constants::CRC_FINGERPRINTS);
+    }
+
+    inline auto slot_crc(uint32_t i, const KV &kv) noexcept -> uint32_t {
+        return crc32c(i, &kv, sizeof(KV));
+    }
+
+    // number of pairs a node of type t holds, 0 for the head and unknown types
+    inline static auto capacity_of(Enums::LinkedNodeType t) -> uint32_t {
+        switch(t) {
+        case LinkedNodeType::Type10:
+        case LinkedNodeType::Type12:
+        case LinkedNodeType::Type14:
+        case LinkedNodeType::Type16:
+            return t;
+        default:
+            return 0;
+        }
+    }
+
     template <std::size_t M, std::size_t N>
     struct LinkedNode {
         RemotePointer llink;
         RemotePointer rlink;
-        uint16_t crc;
+        uint32_t crc;
         LinkedNodeType type;
 
         // next writtable slot
         uint32_t next;
 
+        // bumped by every write back and repeated in trailer, see node_intact
+        uint32_t version;
+
         // here we leave extra space for fingerprints so that we do not need to
         // move data when morphing. Such space cost is marginal
         uint8_t fingerprints[M];
         KV pairs[N];
+        uint32_t trailer;
+
+        // the type of a node of this layout, which its capacity stands for
+        static constexpr LinkedNodeType node_type = static_cast<LinkedNodeType>(N);
 
         LinkedNode()
             : llink(nullptr),
               rlink(nullptr),
-              type(static_cast<LinkedNodeType>(N)),
-              next(0)
+              type(node_type),
+              next(0),
+              version(0),
+              trailer(0)
         {
             memset(fingerprints, 0, sizeof(fingerprints));
             // memset(pairs, 0, sizeof(pairs));
         }
 
+        // a LinkedNode16 buffer holds nodes of all types, the trailer of a node of type t
+        // is right behind its last slot. The offset is taken from the start of the node
+        // rather than from pairs, which may be shorter than a slot of type t
+        inline static auto trailer_offset(LinkedNodeType t) noexcept -> size_t {
+            return offsetof(LinkedNode, pairs) + capacity_of(t) * sizeof(KV);
+        }
+
+        inline auto trailer_of(LinkedNodeType t) const noexcept -> uint32_t {
+            uint32_t v;
+            memcpy(&v, reinterpret_cast<const byte_t *>(this) + trailer_offset(t), sizeof(v));
+            return v;
+        }
+
+        // the writer holding the node's lock seals its image right before writing it back
+        inline auto seal() noexcept -> void {
+            ++version;
+            if (capacity_of(type)) {
+                memcpy(reinterpret_cast<byte_t *>(this) + trailer_offset(type), &version,
+                       sizeof(version));
+            }
+        }
+
         auto available() const noexcept -> bool {
             return next < N;
         }
 
+        /*
+         * store, update and remove patch crc for the slot and the header they change, so
+         * a node fetched with a valid crc stays valid without another crc_validate.
+         * Other changes, e.g., absorb, morphs and splits, leave crc for the caller
+         */
+        inline auto patch_slot(uint32_t i, const KV &before) noexcept -> void {
+            crc ^= slot_crc(i, before) ^ slot_crc(i, pairs[i]);
+        }
+
+        inline auto patch_header(uint32_t before) noexcept -> void {
+            crc ^= before ^ header_crc(next, fingerprints);
+        }
+
         // uninsert, not upsert
-        auto store(const std::string &key, const std::string &value) -> bool {
+        auto store(std::string_view key, std::string_view value) -> bool {
             if (!available()) {
                 return false;
             }
 
-            if (find(key)) {
+            if (locate(key) != -1) {
                 return true;
             }
 
-            fingerprints[next] = (uint8_t)CityHash64(key.c_str(), key.size());
-            memcpy(pairs[next].key, key.c_str(), key.size());
-            memcpy(pairs[next].value, value.c_str(), value.size());
+            auto header = header_crc(next, fingerprints);
+            auto before = pairs[next];
+            fingerprints[next] = (uint8_t)CityHash64(key.data(), key.size());
+            memcpy(pairs[next].key, key.data(), key.size());
+            memcpy(pairs[next].value, value.data(), value.size());
+            patch_slot(next, before);
             ++next;
+            patch_header(header);
 
             return true;
         }
 
-        auto find(const std::string &key) -> std::optional<std::string> {
-            auto finger = (uint8_t)CityHash64(key.c_str(), key.size());
+        auto find(std::string_view key) -> std::optional<std::string> {
+            auto i = locate(key);
+            if (i == -1) {
+                return {};
+            }
 
-            for (int i = 0; i < next; i++) {
-                // fuck the type conversion
-                if (finger != fingerprints[i])
-                    continue;
-                if (key.compare(0, key.size(), (char *)&pairs[i].key[0], key.size()) == 0) {
-                    return std::string((char *)&pairs[i].value[0], Constants::VALLEN);
-                }
+            return std::string((char *)&pairs[i].value[0], Constants::VALLEN);
+        }
+
+        // copy the value of key into a buffer of VALLEN bytes
+        auto find(std::string_view key, byte_ptr_t value) const noexcept -> bool {
+            auto i = locate(key);
+            if (i == -1) {
+                return false;
             }
 
-            return {};
+            memcpy(value, pairs[i].value, Constants::VALLEN);
+            return true;
         }
 
-        auto update(const std::string &key, const std::string &value) -> bool {
-            auto finger = (uint8_t)CityHash64(key.c_str(), key.size());
+        auto update(std::string_view key, std::string_view value) -> bool {
+            auto i = locate(key);
+            if (i == -1) {
+                return false;
+            }
 
-            for (int i = 0; i < next; i++) {
-                if (finger != fingerprints[i])
-                    continue;
+            auto before = pairs[i];
+            memcpy(pairs[i].value, value.data(), value.size());
+            patch_slot(i, before);
+            return true;
+        }
+
+        // the last pair fills the hole so that pairs stay packed before next
+        auto remove(std::string_view key) noexcept -> bool {
+            auto i = locate(key);
+            if (i == -1) {
+                return false;
+            }
+
+            auto header = header_crc(next, fingerprints);
+            --next;
+            if ((uint32_t)i != next) {
+                auto before = pairs[i];
+                fingerprints[i] = fingerprints[next];
+                pairs[i] = pairs[next];
+                patch_slot(i, before);
+            }
+            fingerprints[next] = 0;
+            patch_header(header);
+            return true;
+        }
 
-                // fuck the type conversion
-                if (key.compare(0, key.size(), (char *)&pairs[i].key[0], key.size()) == 0) {
-                    memcpy(pairs[i].value, value.c_str(), value.size());
-                    return true;
+        // append all pairs of other, the caller makes sure that they fit
+        template <std::size_t P, std::size_t Q>
+        auto absorb(const LinkedNode<P, Q> &other) noexcept -> void {
+            for (uint32_t i = 0; i < other.next; i++) {
+                fingerprints[next] = other.fingerprints[i];
+                pairs[next] = other.pairs[i];
+                ++next;
+            }
+        }
+
+        // slot of key, -1 if it is not stored
+        auto locate(std::string_view key) const noexcept -> int {
+            auto finger = (uint8_t)CityHash64(key.data(), key.size());
+            auto filled = std::min<uint32_t>(next, N);
+            uint32_t candidates = 0;
+
+#ifdef __SSE2__
+            if constexpr (M == 16) {
+                // all fingerprints are probed at once
+                auto f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints));
+                candidates = _mm_movemask_epi8(_mm_cmpeq_epi8(f, _mm_set1_epi8(finger)));
+                candidates &= (1U << filled) - 1;
+            } else
+#endif
+            {
+                for (uint32_t i = 0; i < filled; i++) {
+                    candidates |= (uint32_t)(finger == fingerprints[i]) << i;
                 }
             }
 
-            return false;
+            for (; candidates; candidates &= candidates - 1) {
+                auto i = __builtin_ctz(candidates);
+                if (key_equal(key, pairs[i].key)) {
+                    return i;
+                }
+            }
+
+            return -1;
+        }
+
+        static auto key_equal(std::string_view key, const byte_t *stored) noexcept -> bool {
+#ifdef __SSE2__
+            if (key.size() == Constants::KEYLEN) {
+                static_assert(Constants::KEYLEN == sizeof(__m128i));
+                auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key.data()));
+                auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stored));
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+            }
+#endif
+            return memcmp(key.data(), stored, key.size()) == 0;
         }
 
         auto store(const_byte_ptr_t key, size_t k_sz, const_byte_ptr_t val, size_t v_sz)
@@ -123,19 +315,37 @@ namespace DiStore::DataLayer {
                 return false;
             }
 
+            auto header = header_crc(next, fingerprints);
+            auto before = pairs[next];
             fingerprints[next] = CityHash64((char *)key, k_sz);
             memcpy(pairs[next].key, key, k_sz);
             memcpy(pairs[next].value, val, v_sz);
+            patch_slot(next, before);
             ++next;
+            patch_header(header);
             return true;
         }
 
-        auto scan(const std::string &key, size_t ct, std::vector<std::string> &ret) -> uint64_t {
+        // slots of the stored pairs in ascending key order
+        auto sorted_slots(uint8_t *perm) const noexcept -> uint32_t {
+            auto filled = std::min<uint32_t>(next, N);
+            sort_keys(pairs, filled, perm);
+            return filled;
+        }
+
+        // copy at most ct values of keys not before key into values if it is given,
+        // in ascending key order
+        auto scan(std::string_view key, size_t ct, byte_ptr_t values) const noexcept -> uint64_t {
+            uint8_t perm[N];
+            auto filled = sorted_slots(perm);
+
             auto total = 0UL;
-            for (int i = 0; i < next; i++) {
-                if (ct - total > 0 &&
-                    key.compare(0, key.size(), (char *)&pairs[i].key[0], key.size()) <= 0) {
-                    ret.emplace_back((char *)&pairs[i].value[0], Constants::VALLEN);
+            for (uint32_t i = 0; i < filled && total < ct; i++) {
+                auto &p = pairs[perm[i]];
+                if (key.compare(0, key.size(), std::string_view((char *)&p.key[0], key.size())) <= 0) {
+                    if (values) {
+                        memcpy(values + total * Constants::VALLEN, p.value, Constants::VALLEN);
+                    }
                     ++total;
                 }
             }
@@ -205,34 +415,59 @@ namespace DiStore::DataLayer {
         }
     }
 
-    inline auto crc_validate(const LinkedNode16 *buffer, LinkedNodeType type) -> uint16_t {
-        boost::crc_optimal<16, 0x1021, 0xFFFF, 0, false, false>  crcer;
-
-        switch (type) {
-        case Enums::LinkedNodeType::Type10: {
-            crcer.process_bytes(reinterpret_cast<const void *>(buffer->pairs), 10 * sizeof(KV));
-            return crcer.checksum();            
-        }
-        case Enums::LinkedNodeType::Type12: {
-            crcer.process_bytes(reinterpret_cast<const void *>(buffer->pairs), 12 * sizeof(KV));
-            return crcer.checksum();            
-        }
-        case Enums::LinkedNodeType::Type14: {
-            crcer.process_bytes(reinterpret_cast<const void *>(buffer->pairs), 14 * sizeof(KV));
-            return crcer.checksum();            
+    // next and fingerprints are covered too, a torn read may otherwise pair the fingerprints
+    // from before a removal with the pairs after it
+    inline auto crc_validate(const LinkedNode16 *buffer, LinkedNodeType type) -> uint32_t {
+        auto slots = capacity_of(type);
+        if (slots == 0) {
+            return 0;
         }
-        case Enums::LinkedNodeType::Type16: {
-            crcer.process_bytes(reinterpret_cast<const void *>(buffer->pairs), 16 * sizeof(KV));
-            return crcer.checksum();
+
+        // the slot chains are independent, so their crc32 instructions overlap
+        auto crc = header_crc(buffer->next, buffer->fingerprints);
+        for (uint32_t i = 0; i < slots; i++) {
+            crc ^= slot_crc(i, buffer->pairs[i]);
         }
-        default:
-            return 0;
+        return crc;
+    }
+
+    /*
+     * A read overlapping a write back mostly sees different versions in the header and the
+     * trailer, which rejects it with an integer compare. RDMA does not promise the order
+     * bytes of a read land in, so an image whose versions agree still has its crc checked.
+     * The head has no slots and only its crc is compared
+     */
+    inline auto node_intact(const LinkedNode16 *buffer, LinkedNodeType type) -> bool {
+        if (capacity_of(type) && buffer->version != buffer->trailer_of(type)) {
+            return false;
         }
+        return crc_validate(buffer, type) == buffer->crc;
     }
 
 
 
 
+    /*
+     * Kept by a compute node in the first page of segment 0 of memory node 0, which no
+     * segment hands out. head is the data node of the skip list head, whose rlink leads
+     * to the whole data layer, and samples are data nodes in chain order taken by the
+     * last checkpoint, which split the chain for a parallel recovery. crc covers them
+     */
+    struct Superblock {
+        uint64_t magic;
+        RemotePointer head;
+        uint32_t sampled;
+        uint32_t crc;
+        RemotePointer samples[Constants::SUPERBLOCK_SAMPLES];
+
+        inline auto samples_crc() const noexcept -> uint32_t {
+            return crc32c(UINT32_MAX, samples, std::min<size_t>(sampled, Constants::SUPERBLOCK_SAMPLES) *
+                                                   sizeof(RemotePointer));
+        }
+    };
+
+    static_assert(sizeof(Superblock) <= Memory::Constants::MEMORY_PAGE_SIZE);
+
     // not used
     struct LinkedNodeVar {
         RemotePointer llink;
@@ -0,0 +1,186 @@
+#include "epoch.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace DiStore::Epoch {
+    auto EpochManager::instance() -> EpochManager & {
+        // never destroyed, detached threads may still leave their epochs at exit
+        static auto manager = new EpochManager;
+        return *manager;
+    }
+
+    EpochManager::EpochManager() : global_epoch(1) {
+        for (auto &r : records) {
+            r.state = 0;
+            r.used = false;
+            r.oldest = 0;
+            r.pins[0] = r.pins[1] = 0;
+        }
+    }
+
+    EpochManager::~EpochManager() {
+        for (auto &r : records) {
+            reclaim(r.limbo, UINT64_MAX);
+        }
+        reclaim(orphans, UINT64_MAX);
+    }
+
+    EpochManager::Owner::~Owner() {
+        if (!record)
+            return;
+
+        {
+            std::scoped_lock<std::mutex, std::mutex> _(manager->orphan_mutex, record->limbo_mutex);
+            manager->orphans.insert(manager->orphans.end(), record->limbo.begin(), record->limbo.end());
+            record->limbo.clear();
+        }
+        record->pins[0] = record->pins[1] = 0;
+        record->state.store(0, std::memory_order_release);
+        record->used.store(false, std::memory_order_release);
+    }
+
+    auto EpochManager::get_record() -> Record * {
+        thread_local Owner owner;
+        if (owner.record && owner.manager == this) {
+            return owner.record;
+        }
+
+        if (owner.record) {
+            throw std::runtime_error("A thread can only join one EpochManager\n");
+        }
+
+        for (auto &r : records) {
+            auto expect = false;
+            if (!r.used.load(std::memory_order_relaxed) && r.used.compare_exchange_strong(expect, true)) {
+                owner.manager = this;
+                owner.record = &r;
+                return &r;
+            }
+        }
+
+        throw std::runtime_error("Too many threads in the epoch manager\n");
+    }
+
+    auto EpochManager::enter() -> uint64_t {
+        auto r = get_record();
+        auto e = global_epoch.load(std::memory_order_acquire);
+        if (r->pins[0] + r->pins[1] == 0) {
+            r->oldest = e;
+            r->state.store((e << 1) | 1, std::memory_order_seq_cst);
+        }
+        ++r->pins[e & 1];
+        return e;
+    }
+
+    auto EpochManager::exit(uint64_t epoch) -> void {
+        auto r = get_record();
+        if (--r->pins[epoch & 1] != 0 || epoch != r->oldest) {
+            return;
+        }
+
+        // the global epoch stays at oldest + 1 until the oldest pins are gone
+        if (r->pins[(epoch + 1) & 1] != 0) {
+            r->oldest = epoch + 1;
+            r->state.store((r->oldest << 1) | 1, std::memory_order_release);
+        } else {
+            r->state.store(0, std::memory_order_release);
+        }
+    }
+
+    auto EpochManager::retire(void *object, void (*deleter)(void *)) -> void {
+        auto call = [](void *o, void *d) {
+            reinterpret_cast<void (*)(void *)>(d)(o);
+        };
+        retire(object, call, reinterpret_cast<void *>(deleter));
+    }
+
+    auto EpochManager::retire(void *object, void (*deleter)(void *, void *), void *ctx) -> void {
+        auto r = get_record();
+        size_t held;
+        {
+            std::scoped_lock<std::mutex> _(r->limbo_mutex);
+            r->limbo.push_back({object, ctx, deleter, global_epoch.load(std::memory_order_acquire)});
+            held = r->limbo.size();
+        }
+
+        if (held >= Constants::COLLECT_THRESHOLD) {
+            collect();
+        }
+    }
+
+    auto EpochManager::pending() -> size_t {
+        auto r = get_record();
+        std::scoped_lock<std::mutex> _(r->limbo_mutex);
+        return r->limbo.size();
+    }
+
+    auto EpochManager::collect() -> void {
+        auto e = try_advance();
+        auto r = get_record();
+        {
+            std::scoped_lock<std::mutex> _(r->limbo_mutex);
+            reclaim(r->limbo, e);
+        }
+
+        if (std::unique_lock<std::mutex> l(orphan_mutex, std::try_to_lock); l.owns_lock()) {
+            reclaim(orphans, e);
+        }
+    }
+
+    auto EpochManager::reclaim_all(void *ctx) -> void {
+        auto take = [ctx](std::vector<Retired> &limbo, std::vector<Retired> &out) {
+            auto mine = std::partition(limbo.begin(), limbo.end(), [&](const Retired &r) {
+                return r.ctx != ctx;
+            });
+            out.insert(out.end(), mine, limbo.end());
+            limbo.erase(mine, limbo.end());
+        };
+
+        std::vector<Retired> freed;
+        for (auto &r : records) {
+            std::scoped_lock<std::mutex> _(r.limbo_mutex);
+            take(r.limbo, freed);
+        }
+        {
+            std::scoped_lock<std::mutex> _(orphan_mutex);
+            take(orphans, freed);
+        }
+
+        // deleters run unlocked, they may retire again
+        for (auto &r : freed) {
+            r.deleter(r.object, r.ctx);
+        }
+    }
+
+    auto EpochManager::try_advance() -> uint64_t {
+        auto e = global_epoch.load(std::memory_order_seq_cst);
+
+        // every active thread must have observed e
+        for (auto &r : records) {
+            if (!r.used.load(std::memory_order_acquire))
+                continue;
+
+            auto s = r.state.load(std::memory_order_seq_cst);
+            if ((s & 1) && (s >> 1) != e) {
+                return e;
+            }
+        }
+
+        if (global_epoch.compare_exchange_strong(e, e + 1)) {
+            return e + 1;
+        }
+        return e;
+    }
+
+    auto EpochManager::reclaim(std::vector<Retired> &limbo, uint64_t epoch) -> void {
+        auto safe = std::partition(limbo.begin(), limbo.end(), [&](const Retired &r) {
+            return r.epoch + 2 > epoch;
+        });
+
+        for (auto i = safe; i != limbo.end(); i++) {
+            i->deleter(i->object, i->ctx);
+        }
+        limbo.erase(safe, limbo.end());
+    }
+}
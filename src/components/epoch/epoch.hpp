@@ -0,0 +1,121 @@
+#ifndef __DISTORE__EPOCH__EPOCH__
+#define __DISTORE__EPOCH__EPOCH__
+#include "debug/debug.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace DiStore::Epoch {
+    namespace Constants {
+        static constexpr size_t MAX_THREADS = 256;
+        // retired objects a thread accumulates before it tries to reclaim
+        static constexpr size_t COLLECT_THRESHOLD = 64;
+    }
+
+    // an object waiting for every reader of its epoch to leave
+    struct Retired {
+        void *object;
+        void *ctx;
+        void (*deleter)(void *, void *);
+        uint64_t epoch;
+    };
+
+    /*
+     * Epoch-based reclamation shared by all lock-free structures of a process.
+     *
+     * A reader enters the current global epoch before reading shared nodes and leaves
+     * afterwards. A node unlinked in epoch e is freed once the global epoch reaches e + 2,
+     * which only happens after every reader active in e has left.
+     *
+     * Each enter pins the epoch it observed and exit unpins exactly that one, so nested
+     * guards and coroutines interleaved on a thread announce their own epochs. The thread's
+     * record shows the oldest pinned one. The global epoch only advances once every record
+     * shows it, so pins of a thread are always within two neighbouring epochs and a full
+     * window of coroutines does not hold the record back
+     */
+    class EpochManager {
+    public:
+        static auto instance() -> EpochManager &;
+
+        EpochManager();
+        EpochManager(const EpochManager &) = delete;
+        EpochManager(EpochManager &&) = delete;
+        auto operator=(const EpochManager &) = delete;
+        auto operator=(EpochManager &&) = delete;
+        ~EpochManager();
+
+        // return the pinned epoch, which is handed back to exit
+        auto enter() -> uint64_t;
+        auto exit(uint64_t epoch) -> void;
+
+        // free object with deleter once no reader can hold it
+        auto retire(void *object, void (*deleter)(void *)) -> void;
+        // the same, but deleter is called with ctx, e.g., the owner of object
+        auto retire(void *object, void (*deleter)(void *, void *), void *ctx) -> void;
+
+        // advance the global epoch if possible and free what is safe to free
+        auto collect() -> void;
+
+        // free every object retired with ctx right away, for an owner going away. No
+        // reader may hold any of them
+        auto reclaim_all(void *ctx) -> void;
+
+        inline auto current() const noexcept -> uint64_t {
+            return global_epoch.load(std::memory_order_acquire);
+        }
+
+        // objects retired by the calling thread and not yet freed
+        auto pending() -> size_t;
+
+    private:
+        struct alignas(64) Record {
+            // (epoch << 1) | 1 if the owner is inside an epoch, otherwise 0
+            std::atomic<uint64_t> state;
+            std::atomic<bool> used;
+            // the oldest pinned epoch, and pins per epoch parity
+            uint64_t oldest;
+            size_t pins[2];
+            // only contended by reclaim_all
+            std::mutex limbo_mutex;
+            std::vector<Retired> limbo;
+        };
+
+        // releases the record of an exiting thread
+        struct Owner {
+            EpochManager *manager = nullptr;
+            Record *record = nullptr;
+            ~Owner();
+        };
+
+        std::atomic<uint64_t> global_epoch;
+        Record records[Constants::MAX_THREADS];
+
+        // retired objects left behind by exited threads
+        std::mutex orphan_mutex;
+        std::vector<Retired> orphans;
+
+        auto get_record() -> Record *;
+        auto try_advance() -> uint64_t;
+        static auto reclaim(std::vector<Retired> &limbo, uint64_t epoch) -> void;
+    };
+
+    // RAII guard keeping its holder, a thread or a coroutine, inside an epoch
+    class Guard {
+    public:
+        Guard() : epoch(EpochManager::instance().enter()) {}
+
+        Guard(const Guard &) = delete;
+        Guard(Guard &&) = delete;
+        auto operator=(const Guard &) = delete;
+        auto operator=(Guard &&) = delete;
+
+        ~Guard() {
+            EpochManager::instance().exit(epoch);
+        }
+
+    private:
+        uint64_t epoch;
+    };
+}
+#endif
@@ -1,4 +1,79 @@
 #include "handover_locktable.hpp"
+
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 namespace DiStore::Concurrency {
+    static inline auto futex(std::atomic<RequestState> *word, int op, RequestState value) -> void {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, static_cast<uint32_t>(value),
+                nullptr, nullptr, 0);
+    }
+
+    auto ConcurrencyRequests::finish() noexcept -> void {
+        // the slot outlives the waiter, so a late wake-up only disturbs the next one
+        if (state.exchange(RequestState::Done, std::memory_order_acq_rel) == RequestState::Parked) {
+            futex(&state, FUTEX_WAKE_PRIVATE, RequestState::Done);
+        }
+    }
+
+    auto ConcurrencyRequests::wait() noexcept -> void {
+        for (int i = 0; i < Constants::WAIT_SPINS; i++) {
+            if (state.load(std::memory_order_acquire) == RequestState::Done)
+                return;
+            _mm_pause();
+        }
+
+        auto expect = RequestState::Pending;
+        if (!state.compare_exchange_strong(expect, RequestState::Parked))
+            return;
+
+        while (state.load(std::memory_order_acquire) != RequestState::Done) {
+            futex(&state, FUTEX_WAIT_PRIVATE, RequestState::Parked);
+        }
+    }
+
+    RequestRing::RequestRing() : tail(0), head(0) {
+        for (size_t i = 0; i < Constants::REQUEST_RING_SIZE; i++) {
+            slots[i].seq = i;
+        }
+    }
+
+    auto RequestRing::claim() noexcept -> ConcurrencyRequests * {
+        auto pos = tail.fetch_add(1, std::memory_order_acq_rel);
+        auto req = &slots[pos & (Constants::REQUEST_RING_SIZE - 1)];
+        while (req->seq.load(std::memory_order_acquire) != pos) {
+            _mm_pause();
+        }
+
+        req->ticket = pos;
+        req->state.store(RequestState::Pending, std::memory_order_relaxed);
+        return req;
+    }
+
+    auto RequestRing::publish(ConcurrencyRequests *req) noexcept -> void {
+        req->seq.store(req->ticket + 1, std::memory_order_release);
+    }
+
+    auto RequestRing::release(ConcurrencyRequests *req) noexcept -> void {
+        req->seq.store(req->ticket + Constants::REQUEST_RING_SIZE, std::memory_order_release);
+    }
+
+    auto RequestRing::try_pop(ConcurrencyRequests *&req) noexcept -> bool {
+        auto pos = head.load(std::memory_order_relaxed);
+        if (pos == tail.load(std::memory_order_acquire))
+            return false;
+
+        req = &slots[pos & (Constants::REQUEST_RING_SIZE - 1)];
+        while (req->seq.load(std::memory_order_acquire) != pos + 1) {
+            _mm_pause();
+        }
+        head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
 
+    auto RequestRing::unpop() noexcept -> void {
+        head.store(head.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
 }
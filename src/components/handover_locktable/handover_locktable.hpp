@@ -5,16 +5,38 @@
 #include "memory/remote_memory/remote_memory.hpp"
 #include "city/city.hpp"
 
-#include "tbb/concurrent_queue.h"
-
 #include <atomic>
 #include <mutex>
 
 namespace DiStore::Concurrency {
+    namespace Constants {
+        // requests a winner takes from waiters by default and at least
+        static constexpr int COMBINING_DEPTH = 4;
+        static constexpr int MAX_COMBINING_DEPTH = 32;
+        // pauses a winner of a hot node waits for more requests before serving them
+        static constexpr int COMBINING_WINDOW = 256;
+        // slots of the request ring of a context, a power of two
+        static constexpr size_t REQUEST_RING_SIZE = 32;
+        // pauses a waiter spins for before parking until its request is served
+        static constexpr int WAIT_SPINS = 2048;
+
+        static_assert((REQUEST_RING_SIZE & (REQUEST_RING_SIZE - 1)) == 0);
+        static_assert(REQUEST_RING_SIZE >= MAX_COMBINING_DEPTH);
+    }
+
     enum class ConcurrencyContextType {
         Insert,
         Update,
         Delete,
+        // a reader that keeps seeing torn images, which never takes requests
+        Read,
+    };
+
+    enum class RequestState : uint32_t {
+        Pending,
+        Done,
+        // the waiter sleeps on the futex of the state
+        Parked,
     };
 
     /*
@@ -22,39 +44,97 @@ namespace DiStore::Concurrency {
      * 0. thread compete to be the winner
      * 1. tag and content are used for waiting threads to submit their
      *    requests to the winner thread
-     * 2. is_done is used by the winner to notify waiting threads
+     * 2. state is used by the winner to notify waiting threads
      * 3. expected is used by the winner to check whether the node
      *    that the winner is currently operating on is the node expected
      *    by waiting threads (this guarantee update correctness)
      * 4. next is a guard for the winner to determine whether node split
      *    occurs and let waiting threads to retry if so.
+     *
+     * Requests live inline in the ring of the winner's context, a slot per cache line
      */
-    struct ConcurrencyRequests {
+    struct alignas(64) ConcurrencyRequests {
         // used to point to strings
         const void *tag;
         const void *content;
+        // the skip list node the waiting thread found locked
+        const void *expected;
 
-        std::atomic<bool> is_done;
         bool succeed;
         bool retry;
+        std::atomic<RequestState> state;
+
+        // ring position the slot is free for, or the position plus one once it is filled
+        std::atomic<uint64_t> seq;
+        // ring position of the current waiter
+        uint64_t ticket;
 
         ConcurrencyRequests()
             : tag(nullptr),
               content(nullptr),
-              is_done(false),
+              expected(nullptr),
               succeed(false),
-              retry(false) {}
+              retry(false),
+              state(RequestState::Pending),
+              seq(0),
+              ticket(0) {}
+
+        // called by the winner, the slot belongs to the waiter again afterwards
+        auto finish() noexcept -> void;
+        // spin for WAIT_SPINS pauses, then park until finish
+        auto wait() noexcept -> void;
+    };
+
+    /*
+     * Bounded MPSC ring of requests. A waiter claims a slot, fills and publishes it,
+     * waits until the owner of the ring finishes it, then releases the slot after
+     * reading the result. A claim of a slot still held by a waiter of the previous
+     * round spins until it is released. Only the owner pops
+     */
+    class RequestRing {
+    public:
+        RequestRing();
+
+        auto claim() noexcept -> ConcurrencyRequests *;
+        auto publish(ConcurrencyRequests *req) noexcept -> void;
+        auto release(ConcurrencyRequests *req) noexcept -> void;
+
+        // wait for a claimed request to be published
+        auto try_pop(ConcurrencyRequests *&req) noexcept -> bool;
+        // put the request just popped back to the front
+        auto unpop() noexcept -> void;
+
+        // requests claimed but not popped
+        inline auto size() const noexcept -> size_t {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed);
+        }
+
+        RequestRing(const RequestRing &) = delete;
+        RequestRing(RequestRing &&) = delete;
+        auto operator=(const RequestRing &) = delete;
+        auto operator=(RequestRing &&) = delete;
+    private:
+        alignas(64) std::atomic<uint64_t> tail;
+        alignas(64) std::atomic<uint64_t> head;
+        ConcurrencyRequests slots[Constants::REQUEST_RING_SIZE];
     };
 
+    /*
+     * max_depth is the number of requests waiters may still submit. A winner opens it
+     * with granted, the combining depth of the node it locks, and closes it with -1
+     * before serving, after which waiters spin until it drops to 0 and retry
+     */
     struct ConcurrencyContext {
         ConcurrencyContextType type;
         void *user_context;
         std::atomic<int> max_depth;
-        tbb::concurrent_queue<ConcurrencyRequests *> requests;
+        int granted;
+        RequestRing requests;
 
         ConcurrencyContext() {
             type = ConcurrencyContextType::Insert;
-            max_depth = 4;
+            max_depth = 0;
+            granted = 0;
         }
     };
 }
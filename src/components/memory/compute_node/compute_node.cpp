@@ -4,7 +4,8 @@
 namespace DiStore::Memory {
     auto PageMirror::allocate() -> RemotePointer {
         auto base = page_base;
-        --desc.empty_slots;
+        // other threads may free chunks of this page meanwhile
+        __atomic_sub_fetch(&desc.empty_slots, 1, __ATOMIC_RELAXED);
         return base.offset((desc.offset++) * allocation_class_size_map[desc.allocation_class]);
     }
 
@@ -20,157 +21,239 @@ namespace DiStore::Memory {
         if (page_base != ptr.page())
             return false;
 
-        // TODO: add reclaimation update to memory node
-        // Alternatively, we can trigger gloabl GC on memory node to recycle
-        return ++desc.empty_slots;
+        // the chunk is reused by the freeing thread, pages are never returned to the
+        // memory node
+        __atomic_add_fetch(&desc.empty_slots, 1, __ATOMIC_RELAXED);
+        return true;
     }
 
-    auto PageGroup::allocate(AllocationClass ac) -> RemotePointer {
-        for (auto &p : pages) {
-            if (p->desc.allocation_class == ac && p->available()) {
-                return p->allocate();
-            } else if (p->desc.allocation_class == AllocationClass::ChunkUnknown) {
-                p->desc.initialize(ac);
-                return p->allocate();
-            }
+    auto PageMirror::reuse() -> void {
+        __atomic_sub_fetch(&desc.empty_slots, 1, __ATOMIC_RELAXED);
+    }
+
+    Segment::Segment(RemotePointer seg, RemotePointer base)
+        : seg(seg), base_addr(base), total_pages(Constants::SEGMENT_SIZE / Constants::MEMORY_PAGE_SIZE),
+          cursor(1), mirrors(std::make_unique<PageMirror[]>(total_pages)) {}
+
+    auto Segment::mirror_of(RemotePointer chunk) const noexcept -> PageMirror * {
+        auto off = chunk - seg;
+        if (off >= Constants::SEGMENT_SIZE)
+            return nullptr;
+        return &mirrors[off / Constants::MEMORY_PAGE_SIZE];
+    }
+
+    auto PagePool::publish(RemotePointer seg, RemotePointer base) -> bool {
+        auto slot = published.load();
+        if (slot == Constants::MAX_SEGMENTS_PER_NODE) {
+            Debug::error("Too many segments are fetched from memory node %d\n", seg.get_node());
+            return false;
         }
 
-        return nullptr;
+        segments[slot].store(new Segment(seg, base), std::memory_order_release);
+        published.store(slot + 1, std::memory_order_release);
+        return true;
     }
 
-    auto PageGroup::available(AllocationClass ac) -> Enums::MemoryAllocationStatus {
-        bool have_ac = false;
-        for (size_t i = 0; i < Constants::PAGEGROUP_NO; i++) {
-            auto p = pages[i];
-            if (p->desc.allocation_class == AllocationClass::ChunkUnknown) {
-                return Enums::MemoryAllocationStatus::Ok;
+    auto PagePool::take(PageMirror **pages, size_t count) -> size_t {
+        while (true) {
+            auto c = current.load(std::memory_order_acquire);
+            if (c >= published.load(std::memory_order_acquire))
+                return 0;
+
+            auto segment = segments[c].load(std::memory_order_acquire);
+            auto start = segment->cursor.fetch_add(count);
+            if (start >= segment->total_pages) {
+                // used up, the first to notice moves on to the next segment
+                current.compare_exchange_strong(c, c + 1);
+                continue;
             }
 
-            if (p->desc.allocation_class == ac) {
-                if (p->available()) {
-                    return Enums::MemoryAllocationStatus::Ok;
-                } else {
-                    have_ac = true;
-                }
+            auto taken = std::min(count, segment->total_pages - start);
+            for (size_t i = 0; i < taken; i++) {
+                auto mirror = &segment->mirrors[start + i];
+                auto page = segment->seg.offset_by((start + i) * Constants::MEMORY_PAGE_SIZE);
+                mirror->page_id = (page - segment->base_addr) / Constants::MEMORY_PAGE_SIZE - 1;
+                mirror->page_base = page;
+                pages[i] = mirror;
             }
+            return taken;
         }
-
-        if (have_ac)
-            return Enums::MemoryAllocationStatus::EmptyPage;
-        return Enums::MemoryAllocationStatus::EmptyPageGroup;
     }
 
-    auto SegmentTracker::offer_page() -> PageMirror * {
-        auto ret = new PageMirror;
-        ret->desc.clear();
-        auto page = current->seg.offset_by(current->offset * Constants::MEMORY_PAGE_SIZE);
-        auto off = page - current->base_addr;
-        ret->page_id = (off / Constants::MEMORY_PAGE_SIZE) - 1;
-        ret->page_base = page;
-
-        current->mirrors.insert({page, ret});
-
-        --current->available_pages;
-        ++current->offset;
-        return ret;
+    auto PagePool::spare_pages() const noexcept -> size_t {
+        auto spare = 0UL;
+        for (auto i = current.load(); i < published.load(); i++) {
+            spare += segments[i].load()->spare_pages();
+        }
+        return spare;
     }
 
-    auto SegmentTracker::offer_page_group() -> PageGroup * {
-        auto group = new PageGroup;
-
-        for (size_t i = 0; i < Constants::PAGEGROUP_NO; i++) {
-            group->pages[i] = offer_page();
+    auto PagePool::mirror_of(RemotePointer chunk) const noexcept -> PageMirror * {
+        auto count = published.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            if (auto m = segments[i].load(std::memory_order_acquire)->mirror_of(chunk); m)
+                return m;
         }
-        return group;
+        return nullptr;
     }
 
-    auto ComputeNodeAllocator::allocate(size_t sz) -> RemotePointer {
-        if (sz == 0) {
-            throw new std::runtime_error("Received 0 size in " + std::string(__FUNCTION__) + "\n");
+    PagePool::~PagePool() {
+        for (size_t i = 0; i < published.load(); i++) {
+            delete segments[i].load();
         }
+    }
 
-        if (sz > Constants::MEMORY_PAGE_SIZE) {
-            throw new std::runtime_error("Size is larger than a page in " + std::string(__FUNCTION__) + "\n");
+    auto SlabCache::allocate(AllocationClass ac, PagePool &pool) -> RemotePointer {
+        if (!recycled[ac].empty()) {
+            auto [mirror, chunk] = recycled[ac].back();
+            recycled[ac].pop_back();
+            mirror->reuse();
+            return chunk;
         }
 
-        auto id = std::this_thread::get_id();
-
-        auto group = thread_info.find(id);
-        if (group == thread_info.end()) {
-            if (refill(id) == false) {
-                return nullptr;
+        auto page = active[ac];
+        if (page == nullptr || !page->available()) {
+            if (stashed == 0) {
+                stashed = pool.take(stash, Constants::PAGEGROUP_NO);
+                if (stashed == 0)
+                    return nullptr;
             }
 
-            group = thread_info.find(id);
+            page = stash[--stashed];
+            page->desc.initialize(ac);
+            active[ac] = page;
         }
 
-        auto ac = get_class(sz);
-        switch(group->second->available(ac)) {
-        case Enums::MemoryAllocationStatus::Ok:
-            break;
-        case Enums::MemoryAllocationStatus::EmptyPage:
-            if (refill_single_page(id, ac) == false)
-                return nullptr;
-            break;
-        case Enums::MemoryAllocationStatus::EmptyPageGroup:
-            if (refill(id) == false)
-                return nullptr;
-            break;
-        default:
-            return nullptr;
+        return page->allocate();
+    }
+
+    ComputeNodeAllocator::ComputeNodeAllocator()
+        : source_nodes(0), spare_segments(0), stop(false), wake(false)
+    {
+        static std::atomic<uint64_t> next_id = 1;
+        id = next_id.fetch_add(1);
+        for (auto &d : depleted) {
+            d = false;
         }
+    }
 
-        return group->second->allocate(ac);
+    ComputeNodeAllocator::~ComputeNodeAllocator() {
+        stop_prefetch();
     }
 
-    auto ComputeNodeAllocator::free(RemotePointer chunk) -> void {
-        auto page = chunk.page();
+    auto ComputeNodeAllocator::start_prefetch(int nodes, SegmentSource s, size_t spare) -> void {
+        source = std::move(s);
+        source_nodes = nodes;
+        spare_segments = spare;
 
-        auto current = tracker.current;
-        if (auto p = current->mirrors.find(page); p != current->mirrors.end()) {
-            p->second->free(chunk);
+        if (spare != 0) {
+            prefetcher = std::thread([this]() { prefetch(); });
         }
+    }
+
+    auto ComputeNodeAllocator::stop_prefetch() -> void {
+        if (!prefetcher.joinable())
+            return;
+
+        stop = true;
+        wake_cv.notify_one();
+        prefetcher.join();
+    }
 
-        for (auto &k : tracker.segments) {
-            auto &mirror = k.second->mirrors;
-            if (auto p = mirror.find(page); p != mirror.end()) {
-                p->second->free(page);
+    auto ComputeNodeAllocator::prefetch() -> void {
+        while (!stop) {
+            for (int n = 0; n < source_nodes && !stop; n++) {
+                while (!stop && !depleted[n] && pools[n].ready_segments() <= spare_segments) {
+                    std::scoped_lock<std::mutex> _(fetch_mutex);
+                    fetch_segment(n);
+                }
             }
+
+            // allocating threads wake us up once a segment is used up, the timeout
+            // covers a wake-up sent before we wait
+            std::unique_lock<std::mutex> l(wake_mutex);
+            wake_cv.wait_for(l, std::chrono::milliseconds(10), [&]() { return stop || wake.exchange(false); });
         }
     }
 
-    auto ComputeNodeAllocator::refill(const std::thread::id &id) -> bool {
-        std::scoped_lock<std::mutex> _(mutex);
-        if (!tracker.available(Constants::PAGEGROUP_NO)) {
+    auto ComputeNodeAllocator::fetch_segment(int node) -> bool {
+        if (depleted[node])
+            return false;
+
+        auto [seg, base] = source(node);
+        if (seg.is_nullptr()) {
+            depleted[node] = true;
             return false;
         }
 
-        auto group = thread_info.find(id);
+        return pools[node].publish(seg, base);
+    }
 
-        if (group == thread_info.end()) {
-            thread_info.insert({id, new PageGroup});
-            group = thread_info.find(id);
+    auto ComputeNodeAllocator::refill(int node) -> bool {
+        if (!source) {
+            return false;
         }
 
-        group->second = tracker.offer_page_group();
-        return true;
+        std::scoped_lock<std::mutex> _(fetch_mutex);
+        if (pools[node].spare_pages() > 0) {
+            return true;
+        }
+        return fetch_segment(node);
     }
 
-    auto ComputeNodeAllocator::refill_single_page(const std::thread::id &id, AllocationClass ac) -> bool {
+    auto ComputeNodeAllocator::thread_caches() -> SlabCache * {
         std::scoped_lock<std::mutex> _(mutex);
-        if (!tracker.available(Constants::PAGEGROUP_NO)) {
-            return false;
+        caches.push_back(std::make_unique<SlabCache[]>(Constants::MAX_MEMORY_NODES));
+        return caches.back().get();
+    }
+
+    auto ComputeNodeAllocator::local_caches() -> SlabCache * {
+        thread_local uint64_t owner = 0;
+        thread_local SlabCache *local = nullptr;
+
+        if (owner != id) {
+            local = thread_caches();
+            owner = id;
         }
+        return local;
+    }
 
-        auto group = thread_info.find(id);
-        for (auto &p : group->second->pages) {
-            if (p->desc.allocation_class == ac && !p->available()) {
-                p = tracker.offer_page();
-                p->desc.initialize(ac);
-            }
+    auto ComputeNodeAllocator::allocate(size_t sz, int node) -> RemotePointer {
+        return allocate(local_caches(), sz, node);
+    }
+
+    auto ComputeNodeAllocator::allocate(SlabCache *slabs, size_t sz, int node) -> RemotePointer {
+        if (sz == 0) {
+            throw new std::runtime_error("Received 0 size in " + std::string(__FUNCTION__) + "\n");
         }
 
-        return true;
+        if (sz > Constants::MEMORY_PAGE_SIZE) {
+            throw new std::runtime_error("Size is larger than a page in " + std::string(__FUNCTION__) + "\n");
+        }
+
+        auto &pool = pools[node];
+        auto ret = slabs[node].allocate(get_class(sz), pool);
+        if (ret.is_nullptr() || pool.ready_segments() <= spare_segments) {
+            wake = true;
+            wake_cv.notify_one();
+        }
+        return ret;
+    }
+
+    auto ComputeNodeAllocator::free(RemotePointer chunk) -> void {
+        free(local_caches(), chunk);
+    }
+
+    auto ComputeNodeAllocator::free(SlabCache *slabs, RemotePointer chunk) -> void {
+        auto node = chunk.get_node();
+        auto mirror = pools[node].mirror_of(chunk);
+        if (mirror == nullptr || !mirror->free(chunk)) {
+            Debug::error("Chunk %p is not allocated by this allocator\n", chunk.void_ptr());
+            return;
+        }
+
+        // the class of a page never changes once it is cut
+        slabs[node].recycled[mirror->desc.allocation_class].push_back({mirror, chunk});
     }
 
     auto ComputeNodeAllocator::return_memory() -> bool {
@@ -179,6 +262,11 @@ namespace DiStore::Memory {
     }
 
 
+    RemoteMemoryManager::RemoteMemoryManager() : current(0), rpc_ctx(nullptr), loopback_latency(0) {
+        static std::atomic<uint64_t> next_id = 1;
+        id = next_id.fetch_add(1);
+    }
+
     auto RemoteMemoryManager::parse_config_file(const std::string &config) -> bool {
         std::ifstream file(config);
         if (!file.is_open()) {
@@ -263,90 +351,369 @@ namespace DiStore::Memory {
         return true;
     }
 
-    auto RemoteMemoryManager::setup_rdma_per_thread(RDMADevice *device) -> bool {
-        auto id = std::this_thread::get_id();
-        auto p = rdma_ctxs.find(id);
-        if (p != rdma_ctxs.end())
-            return true;
-
-        std::vector<std::unique_ptr<RDMAContext>> rdma;
-        std::vector<std::unique_ptr<RDMAContext>> parallel_rdma;
+    auto RemoteMemoryManager::setup_loopback(size_t mem_cap, uint64_t latency, int nodes) -> bool {
+        auto off = Constants::MEMORY_PAGE_SIZE;
+        if (mem_cap < Constants::SEGMENT_SIZE + off) {
+            Debug::error("Loopback memory should hold at least one segment\n");
+            return false;
+        }
 
-        auto common_buffer = new byte_t[8192];
-        for (const auto &n : memory_nodes) {
-            auto socket = Misc::socket_connect(false, n->roce_port, n->roce_addr.to_string().c_str());
-            auto [rdma_ctx, status] = device->open(common_buffer, 8192, 5,
-                                                   RDMADevice::get_default_mr_access(),
-                                                   *RDMADevice::get_default_qp_init_attr());
+        if (nodes < 1 || nodes > (int)Constants::MAX_MEMORY_NODES) {
+            Debug::error("Can not emulate %d memory nodes\n", nodes);
+            return false;
+        }
 
+        for (int i = 0; i < nodes; i++) {
+            auto [region, status] = LoopbackRegion::make_loopback_region(mem_cap);
             if (status != RDMAUtil::Enums::Status::Ok) {
-                Debug::error(">> Failed to open device due to %s\n",
+                Debug::error("Failed to map loopback memory due to %s\n",
                              RDMAUtil::decode_rdma_status(status).c_str());
                 return false;
             }
 
-            if (rdma_ctx->default_connect(socket) != 0) {
-                Debug::error("Failed to establish RDMA with node %d\n", n->node_id);
-                return false;
+            // same layout as a memory node: allocator metadata in the first page
+            auto mem_node = std::make_unique<Cluster::MemoryNodeInfo>();
+            mem_node->node_id = i;
+            mem_node->cap = mem_cap - off;
+            mem_node->base_addr = RemotePointer::make_remote_pointer(i, region->base + off);
+            loopback_allocators.push_back(MemoryNodeAllocator::make_allocator(region->base, mem_cap));
+
+            memory_nodes.push_back(std::move(mem_node));
+            loopback.push_back(std::move(region));
+        }
+        loopback_mutex = std::make_shared<std::mutex>();
+        loopback_latency = latency;
+
+        Debug::info("%d loopback memory nodes with capacity %lu and latency %luns are set up\n",
+                    nodes, mem_cap, latency);
+        return true;
+    }
+
+    auto RemoteMemoryManager::attach_loopback(const RemoteMemoryManager &other) -> bool {
+        if (!other.is_loopback() || is_loopback() || !memory_nodes.empty()) {
+            Debug::error("Only a fresh manager attaches to loopback memory nodes\n");
+            return false;
+        }
+
+        for (const auto &node : other.memory_nodes) {
+            auto mem_node = std::make_unique<Cluster::MemoryNodeInfo>();
+            mem_node->node_id = node->node_id;
+            mem_node->cap = node->cap;
+            mem_node->base_addr = node->base_addr;
+            memory_nodes.push_back(std::move(mem_node));
+        }
+        loopback = other.loopback;
+        loopback_allocators = other.loopback_allocators;
+        loopback_mutex = other.loopback_mutex;
+        loopback_latency = other.loopback_latency;
+        return true;
+    }
+
+    auto RemoteMemoryManager::pick_memory_node() const noexcept -> int {
+        thread_local size_t cursor = 0;
+        return (cursor++) % memory_nodes.size();
+    }
+
+    auto RemoteMemoryManager::open_context(RDMADevice *device, const Cluster::MemoryNodeInfo &node,
+                                           byte_ptr_t buffer, size_t size, size_t cqe)
+        -> std::unique_ptr<RDMAContext>
+    {
+        if (is_loopback()) {
+            return RDMAContext::make_loopback_context(buffer, size, node.base_addr.get_as<byte_ptr_t>(),
+                                                      node.cap, loopback_latency);
+        }
+
+        auto socket = Misc::socket_connect(false, node.roce_port, node.roce_addr.to_string().c_str());
+        auto [rdma_ctx, status] = device->open(buffer, size, cqe,
+                                               RDMADevice::get_default_mr_access(),
+                                               *RDMADevice::get_default_qp_init_attr());
+
+        if (status != RDMAUtil::Enums::Status::Ok) {
+            Debug::error(">> Failed to open device due to %s\n",
+                         RDMAUtil::decode_rdma_status(status).c_str());
+            return nullptr;
+        }
+
+        if (rdma_ctx->default_connect(socket) != 0) {
+            Debug::error("Failed to establish RDMA with node %d\n", node.node_id);
+            return nullptr;
+        }
+
+        close(socket);
+        return std::move(rdma_ctx);
+    }
+
+    auto RemoteMemoryManager::setup_rdma_per_thread(RDMADevice *device) -> ThreadRDMA * {
+        if (auto local = local_rdma(); local)
+            return local;
+
+        auto contexts = std::make_unique<ThreadRDMA>();
+
+        auto common_buffer = new byte_t[Constants::RDMA_BUFFER_SIZE];
+        auto async_buffer = new byte_t[Constants::ASYNC_RDMA_BUFFER_SIZE];
+        auto scan_buffer = new byte_t[Constants::SCAN_RDMA_BUFFER_SIZE];
+        for (const auto &n : memory_nodes) {
+            auto rdma_ctx = open_context(device, *n, common_buffer, Constants::RDMA_BUFFER_SIZE, 5);
+            if (rdma_ctx == nullptr) {
+                return nullptr;
             }
             Debug::info("RDMA with node %d established\n", n->node_id);
 
-            auto psocket = Misc::socket_connect(false, n->roce_port, n->roce_addr.to_string().c_str());
-            auto [prdma_ctx, pstatus] = device->open(common_buffer, 8192, 5,
-                                                     RDMADevice::get_default_mr_access(),
-                                                     *RDMADevice::get_default_qp_init_attr());
-            if (pstatus != RDMAUtil::Enums::Status::Ok) {
-                Debug::error(">> Failed to open device for parallel context due to %s\n",
-                             RDMAUtil::decode_rdma_status(status).c_str());
-                return false;
-            }
-            
-            if (prdma_ctx->default_connect(psocket) != 0) {
+            auto prdma_ctx = open_context(device, *n, common_buffer, Constants::RDMA_BUFFER_SIZE, 5);
+            if (prdma_ctx == nullptr) {
                 Debug::error("Failed to establish parallel RDMA with node %d\n", n->node_id);
-                return false;
+                return nullptr;
             }
             Debug::info("parallel RDMA with node %d established\n", n->node_id);
-            rdma.push_back(std::move(rdma_ctx));
-            parallel_rdma.push_back(std::move(prdma_ctx));
-            
-            close(socket);
-            close(psocket);
+
+            // every slot of the async window may have a signaled request outstanding
+            auto ardma_ctx = open_context(device, *n, async_buffer, Constants::ASYNC_RDMA_BUFFER_SIZE,
+                                          Constants::ASYNC_WINDOW);
+            if (ardma_ctx == nullptr) {
+                Debug::error("Failed to establish async RDMA with node %d\n", n->node_id);
+                return nullptr;
+            }
+            Debug::info("async RDMA with node %d established\n", n->node_id);
+
+            // a scan has one batch outstanding, signaled once per memory node
+            auto srdma_ctx = open_context(device, *n, scan_buffer, Constants::SCAN_RDMA_BUFFER_SIZE, 5);
+            if (srdma_ctx == nullptr) {
+                Debug::error("Failed to establish scan RDMA with node %d\n", n->node_id);
+                return nullptr;
+            }
+            Debug::info("scan RDMA with node %d established\n", n->node_id);
+
+            contexts->rdma.push_back(std::move(rdma_ctx));
+            contexts->parallel.push_back(std::move(prdma_ctx));
+            contexts->async.push_back(std::move(ardma_ctx));
+            contexts->scan.push_back(std::move(srdma_ctx));
         }
 
         std::scoped_lock<std::mutex> _(init_mutex);
-        rdma_ctxs.insert({id, std::move(rdma)});
-        parallel_rdma_ctxs.insert({id, std::move(parallel_rdma)});
-        return true;
+        auto local = contexts.get();
+        thread_rdmas.insert({std::this_thread::get_id(), std::move(contexts)});
+        bound = {id, local};
+        return local;
+    }
+
+    auto RemoteMemoryManager::bind_local_rdma() -> ThreadRDMA * {
+        std::scoped_lock<std::mutex> _(init_mutex);
+        auto p = thread_rdmas.find(std::this_thread::get_id());
+        if (p == thread_rdmas.end())
+            return nullptr;
+
+        bound = {id, p->second.get()};
+        return bound.rdma;
     }
 
     auto RemoteMemoryManager::get_rdma(RemotePointer remote) -> RDMAContext * {
-        auto rdma = rdma_ctxs.find(std::this_thread::get_id());
-        if (rdma == rdma_ctxs.end()) {
+        auto local = local_rdma();
+        if (!local) {
             Debug::warn("Do remember to setup_rdma_per_thread before running\n");
             return nullptr;
         }
 
-        return rdma->second[remote.get_node()].get();
+        return local->rdma[remote.get_node()].get();
     }
 
     auto RemoteMemoryManager::get_parallel_rdma(RemotePointer remote) -> RDMAContext * {
-        auto rdma = parallel_rdma_ctxs.find(std::this_thread::get_id());
-        if (rdma == parallel_rdma_ctxs.end()) {
+        auto local = local_rdma();
+        if (!local) {
             Debug::warn("Do remember to setup_rdma_per_thread before running\n");
             return nullptr;
         }
 
-        return rdma->second[remote.get_node()].get();
+        return local->parallel[remote.get_node()].get();
+    }
+
+
+    auto RemoteMemoryManager::get_async_rdmas() -> std::vector<RDMAContext *> {
+        auto local = local_rdma();
+        if (!local) {
+            Debug::warn("Do remember to setup_rdma_per_thread before running\n");
+            return {};
+        }
+
+        std::vector<RDMAContext *> ret;
+        for (const auto &ctx : local->async) {
+            ret.push_back(ctx.get());
+        }
+        return ret;
+    }
+
+    auto ThreadRDMA::batch_capacity(size_t size) noexcept -> size_t {
+        return std::min<size_t>(Constants::RDMA_BUFFER_SIZE / size, RDMAUtil::Constants::MAX_QP_DEPTH);
     }
 
+    auto ThreadRDMA::fetch_batch(const RemotePointer *ptrs, size_t count, size_t size)
+        -> byte_ptr_t
+    {
+        if (count > batch_capacity(size)) {
+            Debug::error("Batch of %lu reads exceeds capacity %lu\n", count, batch_capacity(size));
+            return nullptr;
+        }
+
+        // one wr chain per memory node, taken from the wr ring of its context
+        struct ibv_send_wr *heads[Constants::MAX_MEMORY_NODES] = {nullptr};
+        struct ibv_send_wr *tails[Constants::MAX_MEMORY_NODES] = {nullptr};
+        for (size_t i = 0; i < count; i++) {
+            auto node = ptrs[i].get_node();
+            auto wr = rdma[node]->next_send_wr(i, size, i * size, ptrs[i].get_as<byte_ptr_t>(),
+                                               IBV_WR_RDMA_READ);
+            wr->send_flags = 0;
+
+            if (tails[node]) {
+                tails[node]->next = wr;
+            } else {
+                heads[node] = wr;
+            }
+            tails[node] = wr;
+        }
+
+        // an RC qp completes in order, so the last completion covers the whole chain
+        auto ok = true;
+        std::vector<RDMAContext *> posted;
+        for (size_t n = 0; n < rdma.size(); n++) {
+            if (heads[n] == nullptr)
+                continue;
+
+            tails[n]->send_flags = IBV_SEND_SIGNALED;
+            auto [status, _] = rdma[n]->post_batch_read(heads[n]);
+            if (status != RDMAUtil::Enums::Status::Ok) {
+                ok = false;
+                break;
+            }
+            posted.push_back(rdma[n].get());
+        }
+
+        for (auto ctx : posted) {
+            if (auto [wc, _] = ctx->poll_one_completion(); wc) {
+                Debug::error("Batch read failed with %s\n", ibv_wc_status_str(wc->status));
+                ok = false;
+            }
+        }
+
+        if (!ok)
+            return nullptr;
+
+        return reinterpret_cast<byte_ptr_t>(rdma.front()->get_edible_buf());
+    }
+
+    auto ThreadRDMA::post_chains(std::vector<std::unique_ptr<RDMAContext>> &ctxs,
+                                 enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+        -> PostedBatch
+    {
+        PostedBatch batch;
+        batch.count = 0;
+        batch.ok = false;
+
+        struct ibv_send_wr *heads[Constants::MAX_MEMORY_NODES] = {nullptr};
+        struct ibv_send_wr *tails[Constants::MAX_MEMORY_NODES] = {nullptr};
+        for (size_t i = 0; i < count; i++) {
+            auto node = transfers[i].remote.get_node();
+            auto wr = ctxs[node]->next_send_wr(i, transfers[i].size, transfers[i].local_offset,
+                                               transfers[i].remote.get_as<byte_ptr_t>(), opcode);
+            wr->send_flags = 0;
+
+            if (tails[node]) {
+                tails[node]->next = wr;
+            } else {
+                heads[node] = wr;
+            }
+            tails[node] = wr;
+        }
+
+        batch.ok = true;
+        for (size_t n = 0; n < ctxs.size(); n++) {
+            if (heads[n] == nullptr)
+                continue;
+
+            tails[n]->send_flags = IBV_SEND_SIGNALED;
+            auto [status, _] = opcode == IBV_WR_RDMA_READ ?
+                ctxs[n]->post_batch_read(heads[n]) : ctxs[n]->post_batch_write(heads[n]);
+            if (status != RDMAUtil::Enums::Status::Ok) {
+                batch.ok = false;
+                break;
+            }
+            batch.ctxs[batch.count++] = ctxs[n].get();
+        }
+
+        return batch;
+    }
+
+    auto ThreadRDMA::wait_batch(const PostedBatch &batch) -> bool {
+        auto ok = batch.ok;
+        for (size_t i = 0; i < batch.count; i++) {
+            if (auto [wc, _] = batch.ctxs[i]->poll_one_completion(); wc) {
+                Debug::error("Batch transfer failed with %s\n", ibv_wc_status_str(wc->status));
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    auto RemoteMemoryManager::fetch_batch(const RemotePointer *ptrs, size_t count, size_t size)
+        -> byte_ptr_t
+    {
+        auto local = local_rdma();
+        if (!local) {
+            Debug::warn("Do remember to setup_rdma_per_thread before running\n");
+            return nullptr;
+        }
+
+        return local->fetch_batch(ptrs, count, size);
+    }
+
+    auto RemoteMemoryManager::post_batch(enum ibv_wr_opcode opcode, const Transfer *transfers,
+                                         size_t count)
+        -> PostedBatch
+    {
+        auto local = local_rdma();
+        if (!local) {
+            Debug::warn("Do remember to setup_rdma_per_thread before running\n");
+            return {{}, 0, false};
+        }
+
+        return local->post_batch(opcode, transfers, count);
+    }
+
+    auto RemoteMemoryManager::post_scan_batch(const Transfer *transfers, size_t count) -> PostedBatch {
+        auto local = local_rdma();
+        if (!local) {
+            Debug::warn("Do remember to setup_rdma_per_thread before running\n");
+            return {{}, 0, false};
+        }
+
+        return local->post_scan_batch(transfers, count);
+    }
+
+    auto RemoteMemoryManager::get_scan_buffer() -> const_byte_ptr_t {
+        auto local = local_rdma();
+        return local ? local->scan_buffer() : nullptr;
+    }
+
+    auto RemoteMemoryManager::get_rdma_buffer() -> byte_ptr_t {
+        auto local = local_rdma();
+        return local ? local->rdma_buffer() : nullptr;
+    }
 
     auto RemoteMemoryManager::get_base_addr(int node_id) -> RemotePointer {
         return memory_nodes[node_id]->base_addr;
     }
 
-    auto RemoteMemoryManager::offer_remote_segment() -> RemotePointer {
-        auto &mem_node = memory_nodes[(current++) % memory_nodes.size()];
-        auto id = mem_node->node_id;
+    auto RemoteMemoryManager::offer_remote_segment(int node_id) -> RemotePointer {
+        if (is_loopback()) {
+            std::scoped_lock<std::mutex> _(*loopback_mutex);
+            auto seg = loopback_allocators[node_id]->allocate();
+            if (seg == nullptr) {
+                Debug::warn("Loopback memory node %d is depleted\n", node_id);
+                return nullptr;
+            }
+            return RemotePointer::make_remote_pointer(node_id, seg);
+        }
+
+        current = node_id;
+        auto id = memory_nodes[node_id]->node_id;
         auto info = rpc_ctx->select_first_info(id);
 
         info->done = false;
@@ -359,14 +726,8 @@ namespace DiStore::Memory {
             info->rpc->run_event_loop_once();
         }
 
-        auto remote = *reinterpret_cast<RemotePointer *>(info->resp_buf.buf);
-        if (remote.is_nullptr()) {
-            // try another memory node until success
-            Debug::info("Nested call of %s to get remote memory\n", __FUNCTION__);
-            offer_remote_segment();
-        }
-
-        return remote;
+        // the caller tries another memory node
+        return *reinterpret_cast<RemotePointer *>(info->resp_buf.buf);
     }
 
     auto RemoteMemoryManager::recycle_remote_segment(RemotePointer segment) -> bool {
@@ -376,8 +737,10 @@ namespace DiStore::Memory {
     }
 
     // For debug
-    auto PageGroup::dump() const noexcept -> void {
-        for (const auto &m : pages) {
+    auto SlabCache::dump() const noexcept -> void {
+        for (const auto &m : active) {
+            if (m == nullptr)
+                continue;
             std::cout << "---->> page id: " << m->page_id << "\n";
             std::cout << "---->> page base: " << m->page_base.void_ptr() << "\n";
             auto ac = allocation_class_map[m->desc.allocation_class];
@@ -385,25 +748,39 @@ namespace DiStore::Memory {
             std::cout << "---->> empty slots: " << (int)m->desc.empty_slots << "\n";
             std::cout << "---->> offset: " << (int)m->desc.offset << "\n";
         }
+        std::cout << "---->> stashed pages: " << stashed << "\n";
+        for (size_t ac = 0; ac < ChunkUnknown; ac++) {
+            if (!recycled[ac].empty()) {
+                std::cout << "---->> recycled " << dump_allocation_class(allocation_class_map[ac])
+                          << " chunks: " << recycled[ac].size() << "\n";
+            }
+        }
     }
 
     auto Segment::dump() const noexcept -> void {
         std::cout << ">> Segment pointer: " << seg.void_ptr() << "\n";
-        std::cout << "---->> offset: " << offset << "\n";
-        std::cout << "---->> available pages: " << available_pages << "\n";
+        std::cout << "---->> cursor: " << cursor.load() << "\n";
+        std::cout << "---->> available pages: " << spare_pages() << "\n";
     }
 
-    auto SegmentTracker::dump() const noexcept -> void {
-        std::cout << ">> Current used segment: \n";
-        current->dump();
+    auto PagePool::dump() const noexcept -> void {
+        std::cout << ">> Ready segments: \n";
+        for (auto i = current.load(); i < published.load(); i++) {
+            segments[i].load()->dump();
+        }
     }
 
     auto ComputeNodeAllocator::dump() const noexcept -> void {
-        tracker.dump();
-
-        for (const auto &t : thread_info) {
-            std::cout << ">> Thread " << t.first << " occupies following page group\n";
-            t.second->dump();
+        for (size_t n = 0; n < Constants::MAX_MEMORY_NODES; n++) {
+            if (pools[n].published == 0)
+                continue;
+
+            std::cout << ">> Memory node " << n << "\n";
+            pools[n].dump();
+            for (size_t t = 0; t < caches.size(); t++) {
+                std::cout << ">> Thread " << t << " occupies following pages\n";
+                caches[t][n].dump();
+            }
         }
         std::cout << "\n";
     }
@@ -13,6 +13,9 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <fstream>
 
 namespace DiStore::Memory {
@@ -27,6 +30,24 @@ namespace DiStore::Memory {
 
     using namespace RDMAUtil;
 
+    namespace Constants {
+        // per-thread RDMA buffer shared by the contexts to all memory nodes
+        static constexpr size_t RDMA_BUFFER_SIZE = 64 * 1024;
+        // operations a thread keeps in flight through its async contexts, each owns one
+        // slot of the async buffer large enough for a split
+        static constexpr size_t ASYNC_WINDOW = 16;
+        static constexpr size_t ASYNC_SLOT_SIZE = 3 * sizeof(DataLayer::LinkedNode16);
+        static constexpr size_t ASYNC_RDMA_BUFFER_SIZE = ASYNC_WINDOW * ASYNC_SLOT_SIZE;
+        // segments a compute node may fetch from one memory node
+        static constexpr size_t MAX_SEGMENTS_PER_NODE = 1024;
+        // segments the prefetcher keeps ready besides the one being handed out
+        static constexpr size_t SPARE_SEGMENTS = 1;
+        // data nodes a range scan reads with one batch at most, each into its own slot of
+        // the per-thread scan buffer
+        static constexpr size_t MAX_SCAN_DEPTH = 32;
+        static constexpr size_t SCAN_RDMA_BUFFER_SIZE = MAX_SCAN_DEPTH * sizeof(DataLayer::LinkedNode16);
+    }
+
     enum AllocationClass {
         Chunk16,
         Chunk32,
@@ -125,89 +146,140 @@ namespace DiStore::Memory {
         auto allocate() -> RemotePointer;
         auto available() -> bool;
         auto free(RemotePointer ptr) -> bool;
+        // a freed chunk of this page is handed out again
+        auto reuse() -> void;
     } __attribute__((packed));
 
-    struct PageGroup {
-        PageMirror *pages[Constants::PAGEGROUP_NO];
-
-        PageGroup() {
-            memset(pages, 0, sizeof(pages));
-        }
-
-        // caller will use available() to ensure page group offers sufficient memory
-        auto allocate(AllocationClass ac) -> RemotePointer;
-        auto available(AllocationClass ac) -> Enums::MemoryAllocationStatus;
-        auto free(RemotePointer) -> bool;
-
-        auto dump() const noexcept -> void;
-    };
-
+    // a segment fetched from a memory node, whose pages are handed out in order
     struct Segment {
         RemotePointer seg;
 
         // the global base address, not the one of this segment
         RemotePointer base_addr;
-        size_t offset;
-        size_t available_pages;
-        /*
-         * this map trakcs all pages in current segment
-         * if a page is empty, we pop it out from this map
-         */
-        std::unordered_map<RemotePointer, PageMirror *, RemotePointer::RemotePointerHasher> mirrors;
+        size_t total_pages;
+        // the next page to hand out, the first page is not used
+        std::atomic<size_t> cursor;
+        // mirrors of all pages, indexed by their offsets in the segment
+        std::unique_ptr<PageMirror[]> mirrors;
+
+        Segment(RemotePointer seg, RemotePointer base);
 
-        Segment(RemotePointer seg, RemotePointer base) : seg(seg), base_addr(base), offset(1) {
-            // the first page is not used
-            available_pages = Constants::SEGMENT_SIZE / Constants::MEMORY_PAGE_SIZE - 1;
+        inline auto spare_pages() const noexcept -> size_t {
+            auto c = cursor.load(std::memory_order_relaxed);
+            return c < total_pages ? total_pages - c : 0;
         }
 
+        // nullptr if chunk is not in this segment
+        auto mirror_of(RemotePointer chunk) const noexcept -> PageMirror *;
+
         auto dump() const noexcept -> void;
     };
 
-    struct SegmentTracker {
-        Segment *current;
+    /*
+     * Pages of the segments fetched from one memory node. Segments are only appended,
+     * by one fetcher at a time, and a batch of pages is taken from the current segment
+     * with a single fetch_add, so neither allocating nor freeing takes a lock
+     */
+    struct PagePool {
+        std::atomic<Segment *> segments[Constants::MAX_SEGMENTS_PER_NODE];
+        // segments in [current, published) may still have pages to hand out
+        std::atomic<size_t> published;
+        std::atomic<size_t> current;
 
-        std::unordered_map<RemotePointer, std::unique_ptr<Segment>,
-                           RemotePointer::RemotePointerHasher> segments;
+        auto publish(RemotePointer seg, RemotePointer base) -> bool;
 
-        auto assign_new_seg(RemotePointer seg, RemotePointer base) -> void {
-            auto segment = std::make_unique<Segment>(seg, base);
-            current = segment.get();
-            segments.insert({seg, std::move(segment)});
-        }
+        // take at most count pages, return how many are taken
+        auto take(PageMirror **pages, size_t count) -> size_t;
 
-        auto available(size_t request = 1) -> bool {
-            return current != nullptr && current->available_pages >= request;
+        inline auto ready_segments() const noexcept -> size_t {
+            return published.load() - current.load();
         }
 
-        auto offer_page() -> PageMirror *;
-        auto offer_page_group() -> PageGroup *;
+        auto spare_pages() const noexcept -> size_t;
+
+        auto mirror_of(RemotePointer chunk) const noexcept -> PageMirror *;
 
         auto dump() const noexcept -> void;
 
-        SegmentTracker() : current(nullptr) {};
-        SegmentTracker(const SegmentTracker &) = delete;
-        SegmentTracker(SegmentTracker &&) = delete;
-        auto operator=(const SegmentTracker &) = delete;
-        auto operator=(SegmentTracker &&) = delete;
+        PagePool() : published(0), current(0) {};
+        ~PagePool();
+        PagePool(const PagePool &) = delete;
+        PagePool(PagePool &&) = delete;
+        auto operator=(const PagePool &) = delete;
+        auto operator=(PagePool &&) = delete;
+    };
+
+    // pages a thread cuts chunks of one memory node from, only touched by that thread
+    struct SlabCache {
+        PageMirror *active[ChunkUnknown];
+        // fresh pages taken from the pool in a batch
+        PageMirror *stash[Constants::PAGEGROUP_NO];
+        size_t stashed;
+        // chunks freed by this thread, reused before cutting new ones
+        std::vector<std::pair<PageMirror *, RemotePointer>> recycled[ChunkUnknown];
+
+        SlabCache() : stashed(0) {
+            memset(active, 0, sizeof(active));
+        }
+
+        // nullptr if the pool runs dry
+        auto allocate(AllocationClass ac, PagePool &pool) -> RemotePointer;
+
+        auto dump() const noexcept -> void;
     };
 
 
     // class ComputeNodeAllocator and RemoteMemoryManager are used by
     // class Node::ComputeNode
+    /*
+     * Each thread allocates chunks from its own slab caches, one per memory node, and
+     * refills them with a batch of pages from the lock-free page pool of that memory
+     * node. A background prefetcher keeps spare segments in every pool, so that the
+     * allocation path waits neither on a lock nor on an RPC
+     */
     class ComputeNodeAllocator {
     public:
+        // returns a new segment of a memory node and the node's base address, nullptr
+        // if the memory node is depleted
+        using SegmentSource = std::function<std::pair<RemotePointer, RemotePointer>(int node)>;
+
         auto apply_for_memory(RemotePointer seg, RemotePointer base) -> void {
-            tracker.assign_new_seg(seg, base);
+            pools[seg.get_node()].publish(seg, base);
         }
 
+        /*
+         * fetch segments of the first nodes memory nodes from source, keeping spare
+         * segments besides the current one of each node ready in the background. No
+         * background thread is started if spare is 0
+         */
+        auto start_prefetch(int nodes, SegmentSource source, size_t spare = Constants::SPARE_SEGMENTS)
+            -> void;
+        auto stop_prefetch() -> void;
+
+        // fetch a segment of node synchronously unless its pool is refilled meanwhile
+        auto refill(int node) -> bool;
+
         auto return_memory() -> bool;
 
-        // allocate will NOT fetch a new segment if current segment is used up
-        // ComputeNode should fetch
-        auto allocate(size_t sz) -> RemotePointer;
+        // allocate will NOT fetch a new segment if the pool of node runs dry
+        // ComputeNode should refill
+        auto allocate(size_t sz, int node) -> RemotePointer;
 
         auto free(RemotePointer ptr) -> void;
 
+        // new slab caches for a thread, one per memory node. They live as long as this
+        // allocator and only that thread may pass them to the overloads below
+        auto thread_caches() -> SlabCache *;
+        // the same as above, but cut from and recycle into slabs instead of the ones
+        // found for the calling thread
+        auto allocate(SlabCache *slabs, size_t sz, int node) -> RemotePointer;
+        auto free(SlabCache *slabs, RemotePointer ptr) -> void;
+
+        // whether chunk lies in a segment fetched by this allocator
+        inline auto owns(RemotePointer chunk) const noexcept -> bool {
+            return pools[chunk.get_node()].mirror_of(chunk) != nullptr;
+        }
+
         auto dump() const noexcept -> void;
 
         inline auto get_class(size_t sz) -> AllocationClass {
@@ -227,34 +299,161 @@ namespace DiStore::Memory {
         }
 
 
-        ComputeNodeAllocator() = default;
+        ComputeNodeAllocator();
+        ~ComputeNodeAllocator();
         ComputeNodeAllocator(const ComputeNodeAllocator &) = delete;
         ComputeNodeAllocator(ComputeNodeAllocator &&) = delete;
         auto operator=(const ComputeNodeAllocator &) = delete;
         auto operator=(ComputeNodeAllocator &&) = delete;
     private:
-        SegmentTracker tracker;
-        std::unordered_map<std::thread::id, PageGroup *> thread_info;
+        // tells allocators apart in the thread-local lookup of caches
+        uint64_t id;
+        PagePool pools[Constants::MAX_MEMORY_NODES];
+
+        // slab caches of every thread, one per memory node
+        std::vector<std::unique_ptr<SlabCache[]>> caches;
+        // only taken when caches are made for a thread
         std::mutex mutex;
 
-        auto refill(const std::thread::id &id) -> bool;
+        SegmentSource source;
+        int source_nodes;
+        size_t spare_segments;
+        std::atomic<bool> depleted[Constants::MAX_MEMORY_NODES];
+        // serializes fetching segments
+        std::mutex fetch_mutex;
+
+        std::thread prefetcher;
+        std::atomic<bool> stop;
+        std::atomic<bool> wake;
+        std::mutex wake_mutex;
+        std::condition_variable wake_cv;
+
+        // caches of the calling thread, a thread is expected to stick to one allocator
+        auto local_caches() -> SlabCache *;
+        // the caller holds fetch_mutex
+        auto fetch_segment(int node) -> bool;
+        auto prefetch() -> void;
+    };
+
 
-        auto refill_single_page(const std::thread::id &id, AllocationClass ac) -> bool;
+
+    // a remote range and where it is in the thread's RDMA buffer
+    struct Transfer {
+        RemotePointer remote;
+        size_t size;
+        size_t local_offset;
     };
 
+    // contexts a batch of transfers is posted to, one per memory node
+    struct PostedBatch {
+        RDMAContext *ctxs[Constants::MAX_MEMORY_NODES];
+        size_t count;
+        bool ok;
+    };
+
+    /*
+     * RDMA contexts of a thread, one of each kind per memory node. A thread holding its
+     * ThreadRDMA transfers over it directly, and the methods of the same names in
+     * RemoteMemoryManager look up the calling thread's one first
+     */
+    struct alignas(64) ThreadRDMA {
+        std::vector<std::unique_ptr<RDMAContext>> rdma;
+        std::vector<std::unique_ptr<RDMAContext>> parallel;
+        // reserved for the async API of ComputeNode so that sync operations never share a CQ with it
+        std::vector<std::unique_ptr<RDMAContext>> async;
+        // reserved for range scans, whose reads stay outstanding between sync operations
+        std::vector<std::unique_ptr<RDMAContext>> scan;
+
+        // max number of size-byte objects a single fetch_batch can read
+        static auto batch_capacity(size_t size) noexcept -> size_t;
+
+        template<typename T,
+                 typename = typename std::enable_if<std::is_pointer_v<T>>>
+        auto fetch_as(const RemotePointer &p, size_t size, size_t local_offset = 0) -> T {
+            auto ctx = rdma[p.get_node()].get();
+
+            ctx->post_read(p.get_as<byte_ptr_t>(), size, local_offset);
+            ctx->poll_one_completion();
+
+            return reinterpret_cast<T>(ctx->buf);
+        }
+
+        auto write_to(const RemotePointer &p, size_t size, byte_ptr_t content = nullptr) -> bool {
+            auto ctx = rdma[p.get_node()].get();
+
+            ctx->post_write(p.get_as<byte_ptr_t>(), content, size);
+            auto [wc, _] = ctx->poll_one_completion();
+            return wc == nullptr;
+        }
+
+        auto write_back_current(const RemotePointer &p, size_t size) -> bool {
+            auto ctx = rdma[p.get_node()].get();
+
+            ctx->post_write(p.get_as<byte_ptr_t>(), nullptr, size, sizeof(DataLayer::LinkedNode16));
+            auto [wc, _] = ctx->poll_one_completion();
+            return wc == nullptr;
+        }
+
+        auto fetch_batch(const RemotePointer *ptrs, size_t count, size_t size) -> byte_ptr_t;
 
+        inline auto post_batch(enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+            -> PostedBatch
+        {
+            return post_chains(rdma, opcode, transfers, count);
+        }
+
+        inline auto post_scan_batch(const Transfer *transfers, size_t count) -> PostedBatch {
+            return post_chains(scan, IBV_WR_RDMA_READ, transfers, count);
+        }
+
+        static auto wait_batch(const PostedBatch &batch) -> bool;
+
+        inline auto transfer_batch(enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+            -> bool
+        {
+            return wait_batch(post_batch(opcode, transfers, count));
+        }
+
+        inline auto scan_buffer() -> const_byte_ptr_t {
+            return scan.empty() ? nullptr : scan.front()->get_byte_buf();
+        }
+
+        inline auto rdma_buffer() -> byte_ptr_t {
+            return rdma.empty() ? nullptr : reinterpret_cast<byte_ptr_t>(rdma.front()->get_edible_buf());
+        }
+
+        // chain transfers per memory node over the contexts in ctxs and post the chains
+        static auto post_chains(std::vector<std::unique_ptr<RDMAContext>> &ctxs,
+                                enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+            -> PostedBatch;
+    };
 
     // single-thread implementation since it's not frequently used
     struct RemoteMemoryManager {
         int current;
         std::vector<std::unique_ptr<Cluster::MemoryNodeInfo>> memory_nodes;
-        std::unordered_map<std::thread::id, std::vector<std::unique_ptr<RDMAContext>>> rdma_ctxs;
-        std::unordered_map<std::thread::id, std::vector<std::unique_ptr<RDMAContext>>> parallel_rdma_ctxs;
+        // contexts of every thread, only touched under init_mutex
+        std::unordered_map<std::thread::id, std::unique_ptr<ThreadRDMA>> thread_rdmas;
         RPCWrapper::ClientRPCContext *rpc_ctx;
 
         std::mutex init_mutex;
 
-        RemoteMemoryManager() = default;
+        // tells managers apart in the thread-local lookup of contexts
+        uint64_t id;
+        struct LocalRDMA {
+            uint64_t owner;
+            ThreadRDMA *rdma;
+        };
+        static inline thread_local LocalRDMA bound = {0, nullptr};
+
+        // in loopback mode, the emulated memory nodes live in this process and may be
+        // shared by managers attached to them, which serialize on loopback_mutex
+        std::vector<std::shared_ptr<LoopbackRegion>> loopback;
+        std::vector<MemoryNodeAllocator *> loopback_allocators;
+        std::shared_ptr<std::mutex> loopback_mutex;
+        uint64_t loopback_latency;
+
+        RemoteMemoryManager();
 
         /*
          * parse config file to find all memory nodes
@@ -269,78 +468,126 @@ namespace DiStore::Memory {
         // connect all memory nodes presented in the config file via socket
         auto connect_memory_nodes(RPCWrapper::ClientRPCContext &compute) -> bool;
 
-        // set up per-thread RDMA connection with memory nodes
-        auto setup_rdma_per_thread(RDMADevice *device) -> bool;
+        /*
+         * emulate nodes memory nodes of mem_cap bytes each in this process. RDMA contexts
+         * set up afterwards are loopback contexts injecting latency ns per completion
+         * and remote segments are offered without eRPC
+         */
+        auto setup_loopback(size_t mem_cap, uint64_t latency, int nodes = 1) -> bool;
+
+        // reach the emulated memory nodes of other as they are, e.g., to restart a
+        // compute node over them. They are kept until both managers are gone
+        auto attach_loopback(const RemoteMemoryManager &other) -> bool;
+
+        inline auto is_loopback() const noexcept -> bool {
+            return !loopback.empty();
+        }
+
+        // memory node of the next data node, round robin per thread
+        auto pick_memory_node() const noexcept -> int;
+
+        // set up per-thread RDMA connection with memory nodes, nullptr on failure
+        auto setup_rdma_per_thread(RDMADevice *device) -> ThreadRDMA *;
+
+        // contexts of current thread, nullptr if it has not set up RDMA
+        inline auto local_rdma() -> ThreadRDMA * {
+            if (bound.owner == id)
+                return bound.rdma;
+            return bind_local_rdma();
+        }
+        // look current thread up under init_mutex and remember its contexts
+        auto bind_local_rdma() -> ThreadRDMA *;
+        // a loopback or connected context to node over buffer
+        auto open_context(RDMADevice *device, const Cluster::MemoryNodeInfo &node,
+                          byte_ptr_t buffer, size_t size, size_t cqe)
+            -> std::unique_ptr<RDMAContext>;
 
         auto get_rdma(RemotePointer rem) -> RDMAContext *;
         auto get_parallel_rdma(RemotePointer rem) -> RDMAContext *;
+        // async contexts of current thread, indexed by memory node id
+        auto get_async_rdmas() -> std::vector<RDMAContext *>;
+
+        // max number of size-byte objects a single fetch_batch can read
+        inline auto batch_capacity(size_t size) const noexcept -> size_t {
+            return ThreadRDMA::batch_capacity(size);
+        }
+
+        /*
+         * Read ptrs[i] into the i-th size-byte slot of the thread's RDMA buffer. Reads to
+         * the same memory node are chained and posted with one doorbell, and only the
+         * last one is signaled. Return the buffer or nullptr if any read fails
+         */
+        auto fetch_batch(const RemotePointer *ptrs, size_t count, size_t size) -> byte_ptr_t;
+
+        /*
+         * Post transfers as one chain per memory node, each with a single doorbell and only
+         * its last request signaled, so that transfers to different memory nodes proceed in
+         * parallel. wait_batch polls every posted chain and tells whether all succeed
+         */
+        auto post_batch(enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+            -> PostedBatch;
+        inline auto wait_batch(const PostedBatch &batch) -> bool {
+            return ThreadRDMA::wait_batch(batch);
+        }
 
+        /*
+         * The same as post_batch with reads only, but over the scan contexts of current
+         * thread, so local offsets are into the scan buffer of SCAN_RDMA_BUFFER_SIZE bytes.
+         * Sync operations may run while the batch is outstanding
+         */
+        auto post_scan_batch(const Transfer *transfers, size_t count) -> PostedBatch;
+        // nullptr if current thread has no RDMA set up
+        auto get_scan_buffer() -> const_byte_ptr_t;
+        // the RDMA buffer of RDMA_BUFFER_SIZE bytes that fetch_batch and post_batch use,
+        // nullptr if current thread has no RDMA set up
+        auto get_rdma_buffer() -> byte_ptr_t;
+
+        inline auto transfer_batch(enum ibv_wr_opcode opcode, const Transfer *transfers, size_t count)
+            -> bool
+        {
+            return wait_batch(post_batch(opcode, transfers, count));
+        }
 
         // The underlying RDMA buffer is directly returned to user to avoid message copy
         template<typename T,
                  typename = typename std::enable_if<std::is_pointer_v<T>>>
         auto fetch_as(const RemotePointer &p, size_t size, size_t local_offset = 0) -> T {
-            auto node_id = p.get_node();
-            auto addr = p.get_as<byte_ptr_t>();
-
-            auto id = std::this_thread::get_id();
-
-            auto ctxs = rdma_ctxs.find(id);
-
-            if (ctxs == rdma_ctxs.end()) {
+            auto local = local_rdma();
+            if (!local) {
                 Debug::warn("Do remember to setup_rdma_per_thread before running\n");
                 return nullptr;
             }
 
-            auto ctx = ctxs->second[node_id].get();
-
-            ctx->post_read(addr, size, local_offset);
-            ctx->poll_one_completion();
-
-            return reinterpret_cast<T>(ctx->buf);
+            return local->fetch_as<T>(p, size, local_offset);
         }
 
         // if content == nullptr , then the content should already be prepared in the
         // buffer returned from fetch_as
         auto write_to(const RemotePointer &p, size_t size, byte_ptr_t content = nullptr) -> bool {
-            auto node_id = p.get_node();
-            auto addr = p.get_as<byte_ptr_t>();
-
-            auto id = std::this_thread::get_id();
-
-            auto ctxs = rdma_ctxs.find(id);
-
-            auto ctx = ctxs->second[node_id].get();
-
-            ctx->post_write(addr, content, size);
-            auto [wc, _] = ctx->poll_one_completion();
-            if (wc)
+            auto local = local_rdma();
+            if (!local) {
+                Debug::warn("Do remember to setup_rdma_per_thread before running\n");
                 return false;
-            return true;
+            }
+
+            return local->write_to(p, size, content);
         }
 
         // write a content in the buffer that is already filled by fetch_two
         auto write_back_current(const RemotePointer &p, size_t size) -> bool {
-            auto node_id = p.get_node();
-            auto addr = p.get_as<byte_ptr_t>();
-
-            auto id = std::this_thread::get_id();
-
-            auto ctxs = rdma_ctxs.find(id);
-
-            auto ctx = ctxs->second[node_id].get();
-
-            ctx->post_write(addr, nullptr, size, sizeof(DataLayer::LinkedNode16));
-            auto [wc, _] = ctx->poll_one_completion();
-            if (wc)
+            auto local = local_rdma();
+            if (!local) {
+                Debug::warn("Do remember to setup_rdma_per_thread before running\n");
                 return false;
-            return true;
-            
+            }
+
+            return local->write_back_current(p, size);
         }
 
         auto get_base_addr(int node_id) -> RemotePointer;
 
-        auto offer_remote_segment() -> RemotePointer;
+        // a segment of the given memory node, nullptr if it is depleted
+        auto offer_remote_segment(int node_id) -> RemotePointer;
         auto recycle_remote_segment(RemotePointer segment) -> bool;
 
         static auto memory_continuation(void *ctx, void *tag) -> void {
@@ -19,6 +19,8 @@ namespace DiStore {
             static constexpr uint64_t REMOTE_POINTER_MASK = ~0xffff000000000000UL;
             static constexpr uint64_t REMOTE_POINTER_BITS_MASK = 0xc000000000000000UL;
             static constexpr uint64_t REMOTE_POINTER_BITS = 0x2UL;
+            // a remote pointer encodes its memory node in 6 bits
+            static constexpr size_t MAX_MEMORY_NODES = 64;
 #ifndef __DEBUG__
             static constexpr size_t SEGMENT_SIZE = 1 << 30UL;
             static constexpr size_t PAGEGROUP_NO = 8;
@@ -39,6 +41,7 @@ namespace DiStore {
                 // always keep one byte
                 size_t num_bytes = count / 8 + 1;
                 bitmap->bytes = num_bytes;
+                bitmap->count = count;
                 for (size_t i = 0; i < num_bytes; i++) {
                     bitmap->map[i] = 0;
                 }
@@ -49,7 +52,7 @@ namespace DiStore {
             // find an empty slot and return its numbering
             auto find_empty() -> std::optional<size_t> {
                 for (size_t i = 0; i < bytes; i++) {
-                    for (int j = 0; j < 8; j++) {
+                    for (int j = 0; j < 8 && i * 8 + j < count; j++) {
                         if ((map[i] & Constants::byte_masks[j]) == 0) {
                             return i * 8 + j;
                         }
@@ -61,7 +64,7 @@ namespace DiStore {
 
             auto get_empty() -> std::optional<size_t> {
                 for (size_t i = 0; i < bytes; i++) {
-                    for (int j = 0; j < 8; j++) {
+                    for (int j = 0; j < 8 && i * 8 + j < count; j++) {
                         if ((map[i] & Constants::byte_masks[j]) == 0) {
                             map[i] = map[i] | Constants::byte_masks[j];
                             return i * 8 + j;
@@ -79,6 +82,8 @@ namespace DiStore {
             }
 
             size_t bytes;
+            // slots past count are never handed out
+            size_t count;
             byte_t map[];
         };
     }
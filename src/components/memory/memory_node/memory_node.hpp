@@ -9,7 +9,8 @@ namespace DiStore::Memory {
             auto allocator = reinterpret_cast<MemoryNodeAllocator *>(region);
             auto bitmap = reinterpret_cast<Bitmap *>(region);
                 
-            auto num_segments = memory_size / Constants::SEGMENT_SIZE;
+            // segments follow the page of the bitmap
+            auto num_segments = (memory_size - Constants::MEMORY_PAGE_SIZE) / Constants::SEGMENT_SIZE;
             bitmap = Bitmap::make_bitmap(region, num_segments);
             return allocator;
         }
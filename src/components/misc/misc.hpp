@@ -15,6 +15,7 @@
 #include <vector>
 #include <numeric>
 #include <cmath>
+#include <algorithm>
 
 #include <fcntl.h>
 
@@ -47,21 +48,23 @@ namespace DiStore::Misc {
 
     auto check_socket_read_write(ssize_t ret, bool is_read = true) -> void;
 
-    // input vector should be sorted if p90, p99 and p999 are needed
+    // nearest-rank percentile, the input vector should be sorted in ascending order
     template<typename T,
              typename = std::enable_if_t<std::is_arithmetic_v<T>>>
     auto percentile(const std::vector<T> &sorted, double percent) -> T {
         if (sorted.size() == 0)
             return 0;
-        auto partition = ceil(sorted.size() * (1 - percent / 100));
-        return std::accumulate(sorted.begin(), sorted.begin() + partition, 0.0) / partition;
+        auto rank = size_t(ceil(sorted.size() * percent / 100));
+        return sorted[rank == 0 ? 0 : std::min(rank, sorted.size()) - 1];
     }
 
     // input vector is not required to be sorted
     template<typename T,
              typename = std::enable_if_t<std::is_arithmetic_v<T>>>
     auto avg(const std::vector<T> &sorted) -> T {
-        return percentile(sorted, 0);
+        if (sorted.size() == 0)
+            return 0;
+        return std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
     }
 
     template<typename T,
@@ -3,10 +3,11 @@
 #include "memory/remote_memory/remote_memory.hpp"
 #include "search_layer/search_layer.hpp"
 #include <alloca.h>
+#include <immintrin.h>
 #include <stdexcept>
 namespace DiStore::Cluster {
     auto ComputeNode::initialize(const std::string &compute_config,
-                                 const std::string &memory_config)
+                                 const std::string &memory_config, bool recover)
         -> bool
     {
         std::ifstream file(compute_config);
@@ -34,278 +35,1684 @@ namespace DiStore::Cluster {
             return false;
         }
 
-        auto fake_head = allocate(DataLayer::sizeof_node(DataLayer::LinkedNodeType::TypeHead));
-        slist.fake_head(fake_head);
+        if (!initialize_layers(recover)) {
+            return false;
+        }
 
         auto self = self_info.tcp_addr.to_uri(self_info.tcp_port);
+        Debug::info("Compute node %s is intialized\n", self.c_str());
+        return true;
+    }
+
+    auto ComputeNode::initialize_loopback(size_t mem_cap, uint64_t latency, int nodes) -> bool {
+        if (!remote_memory_allocator.setup_loopback(mem_cap, latency, nodes)) {
+            return false;
+        }
+
+        if (!initialize_layers(false)) {
+            return false;
+        }
+
+        Debug::info("Loopback compute node is intialized\n");
+        return true;
+    }
+
+    auto ComputeNode::initialize_loopback(ComputeNode &crashed) -> bool {
+        if (!remote_memory_allocator.attach_loopback(crashed.remote_memory_allocator)) {
+            return false;
+        }
+
+        if (!initialize_layers(true)) {
+            return false;
+        }
+
+        Debug::info("Loopback compute node is recovered\n");
+        return true;
+    }
+
+    auto ComputeNode::initialize_layers(bool recover) -> bool {
+        allocator.start_prefetch(remote_memory_allocator.memory_nodes.size(), [this](int node) {
+            auto seg = remote_memory_allocator.offer_remote_segment(node);
+            return std::make_pair(seg, remote_memory_allocator.get_base_addr(node));
+        });
 
         remote_put = false;
         local_nodes[0] = new LinkedNode10;
         local_nodes[1] = new LinkedNode10;
 
-        Debug::info("Compute node %s is intialized\n", self.c_str());
+        // the head and the superblock are written by current thread
+        if (!register_thread()) {
+            return false;
+        }
+
+        if (recover) {
+            return this->recover();
+        }
+
+        auto fake_head = allocate(DataLayer::sizeof_node(DataLayer::LinkedNodeType::TypeHead));
+        slist.fake_head(fake_head);
+        return link_head(nullptr) && checkpoint();
+    }
+
+    auto ComputeNode::link_head(RemotePointer first) -> bool {
+        LinkedNodeHead head;
+        head.rlink = first;
+        head.crc = crc_validate(reinterpret_cast<LinkedNode16 *>(&head), LinkedNodeType::TypeHead);
+        head.seal();
+
+        if (!remote_memory_allocator.write_to(slist.iter()->data_node, sizeof(LinkedNodeHead),
+                                              reinterpret_cast<byte_ptr_t>(&head))) {
+            Debug::error("Failed to write the head of the data layer\n");
+            return false;
+        }
+        return true;
+    }
+
+    auto ComputeNode::checkpoint() -> bool {
+        auto sb = reinterpret_cast<Superblock *>(remote_memory_allocator.get_rdma_buffer());
+        if (!sb) {
+            Debug::error("Threads should always register before checkpointing\n");
+            return false;
+        }
+
+        Epoch::Guard guard;
+        size_t nodes = 0;
+        for (auto n = slist.iter()->next(); n; n = n->next()) {
+            ++nodes;
+        }
+
+        sb->magic = DataLayer::Constants::SUPERBLOCK_MAGIC;
+        sb->head = slist.iter()->data_node;
+        sb->sampled = 0;
+        auto stride = nodes / DataLayer::Constants::SUPERBLOCK_SAMPLES + 1;
+        size_t i = 0;
+        for (auto n = slist.iter()->next(); n && sb->sampled < DataLayer::Constants::SUPERBLOCK_SAMPLES;
+             n = n->next(), i++) {
+            if ((i + 1) % stride == 0) {
+                sb->samples[sb->sampled++] = n->data_node;
+            }
+        }
+        sb->crc = sb->samples_crc();
+
+        if (!remote_memory_allocator.write_to(remote_memory_allocator.get_base_addr(0), sizeof(Superblock))) {
+            Debug::error("Failed to write the superblock\n");
+            return false;
+        }
+        return true;
+    }
+
+    auto ComputeNode::recover() -> bool {
+        auto base = remote_memory_allocator.get_base_addr(0);
+        auto sb = remote_memory_allocator.fetch_as<const Superblock *>(base, sizeof(Superblock));
+        if (!sb || sb->magic != DataLayer::Constants::SUPERBLOCK_MAGIC) {
+            Debug::error("No superblock is found on memory node 0\n");
+            return false;
+        }
+        auto superblock = std::make_unique<Superblock>(*sb);
+
+        slist.fake_head(superblock->head);
+        auto head = remote_memory_allocator.fetch_as<const LinkedNode16 *>(superblock->head,
+                                                                            sizeof(LinkedNodeHead));
+        if (head->type != LinkedNodeType::TypeHead || !node_intact(head, LinkedNodeType::TypeHead)) {
+            Debug::error("The head of the data layer is torn\n");
+            return false;
+        }
+
+        auto first = head->rlink;
+        if (first.is_nullptr()) {
+            Debug::info("No data node is left to recover\n");
+            return true;
+        }
+
+        RecoveryWalk walk;
+        std::vector<RemotePointer> starts = {first};
+        walk.starts.emplace(first, 0);
+        if (superblock->sampled <= DataLayer::Constants::SUPERBLOCK_SAMPLES &&
+            superblock->crc == superblock->samples_crc()) {
+            for (uint32_t i = 0; i < superblock->sampled; i++) {
+                auto s = superblock->samples[i];
+                if (!s.is_nullptr() && walk.starts.emplace(s, starts.size()).second) {
+                    starts.push_back(s);
+                }
+            }
+        } else {
+            Debug::warn("Samples in the superblock are torn, the chain is walked from its head\n");
+        }
+
+        walk.count = starts.size();
+        walk.segments = std::make_unique<RecoverySegment[]>(walk.count);
+        for (size_t i = 0; i < walk.count; i++) {
+            walk.segments[i].start = starts[i];
+        }
+
+        auto threads = std::min(Constants::RECOVERY_THREADS, walk.count);
+        std::vector<std::thread> walkers;
+        for (size_t t = 0; t < threads; t++) {
+            walkers.emplace_back([&, t] { walk_segments(walk, t, threads); });
+        }
 
-        std::thread([&] {
-            while (true) {
-                CalibrateContext *cal;
-                if (update_queue.try_pop(cal)) {
-                    this->slist.calibrate(cal->new_node, cal->level);
+        // segments are appended in chain order, each reached from the one before
+        auto cursor = slist.begin_append();
+        std::vector<bool> visited(walk.count, false);
+        size_t recovered_nodes = 0;
+        auto ok = true;
+        for (int64_t s = 0; ok && s != -1; ) {
+            auto &seg = walk.segments[s];
+            if (visited[s]) {
+                Debug::error("The chain runs into itself at %p\n", seg.start.void_ptr());
+                ok = false;
+                break;
+            }
+            visited[s] = true;
+
+            while (!seg.done.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            if (seg.broken) {
+                Debug::error("A torn data node follows %p\n", seg.start.void_ptr());
+                ok = false;
+                break;
+            }
+
+            for (const auto &[anchor, remote, type] : seg.nodes) {
+                if (!slist.append(cursor, anchor, remote, type)) {
+                    Debug::error("Data node %p is out of order\n", remote.void_ptr());
+                    ok = false;
+                    break;
                 }
+                ++recovered_nodes;
             }
-        }).detach();
+            s = seg.next;
+        }
+
+        walk.stop = true;
+        for (auto &w : walkers) {
+            w.join();
+        }
+
+        if (!ok) {
+            return false;
+        }
+
+        recovered = true;
+        remote_put = recovered_nodes > 0;
+        Debug::info("%lu data nodes are recovered from %lu segments by %lu threads\n",
+                    recovered_nodes, walk.count, threads);
         return true;
     }
 
-    auto ComputeNode::register_thread() -> bool {
-        // we always use the this_thread::get_id() for thread id;
-        if (!remote_memory_allocator.setup_rdma_per_thread(rdma_dev.get())) {
+    auto ComputeNode::walk_segments(RecoveryWalk &walk, size_t first, size_t step) -> void {
+        const LinkedNode16 *images = nullptr;
+        if (register_thread()) {
+            images = reinterpret_cast<const LinkedNode16 *>(remote_memory_allocator.get_rdma_buffer());
+        }
+
+        if (!images) {
+            for (auto s = first; s < walk.count; s += step) {
+                walk.segments[s].broken = true;
+                walk.segments[s].done.store(true, std::memory_order_release);
+            }
+            return;
+        }
+
+        // a data node is read as the largest type, but never past the end of its segment
+        auto read_size = [this](RemotePointer p) {
+            auto off = (p - remote_memory_allocator.get_base_addr(p.get_node())) % Memory::Constants::SEGMENT_SIZE;
+            return std::min(sizeof(LinkedNode16), Memory::Constants::SEGMENT_SIZE - off);
+        };
+
+        Memory::Transfer transfers[Constants::RECOVERY_DEPTH];
+        RecoverySegment *walking[Constants::RECOVERY_DEPTH];
+        size_t active = 0;
+        auto pending = first;
+        while (!walk.stop.load(std::memory_order_relaxed)) {
+            // segments not started yet take the slots of those done in the last round
+            for (; active < Constants::RECOVERY_DEPTH && pending < walk.count; active++, pending += step) {
+                walking[active] = &walk.segments[pending];
+                auto start = walking[active]->start;
+                transfers[active] = {start, read_size(start), active * sizeof(LinkedNode16)};
+            }
+
+            if (active == 0) {
+                return;
+            }
+
+            auto ok = remote_memory_allocator.transfer_batch(IBV_WR_RDMA_READ, transfers, active);
+            size_t kept = 0;
+            for (size_t i = 0; i < active; i++) {
+                auto seg = walking[i];
+                RemotePointer next = nullptr;
+                if (ok) {
+                    next = recover_node(walk, *seg, transfers[i].remote, images + i);
+                } else {
+                    seg->broken = true;
+                }
+
+                if (next.is_nullptr()) {
+                    seg->done.store(true, std::memory_order_release);
+                    continue;
+                }
+
+                walking[kept] = seg;
+                transfers[kept] = {next, read_size(next), kept * sizeof(LinkedNode16)};
+                ++kept;
+            }
+            active = kept;
+        }
+    }
+
+    auto ComputeNode::recover_node(RecoveryWalk &walk, RecoverySegment &seg, RemotePointer addr,
+                                   const LinkedNode16 *n)
+        -> RemotePointer
+    {
+        auto capacity = capacity_of(n->type);
+        if (!capacity || !node_intact(n, n->type)) {
+            seg.broken = true;
+            return nullptr;
+        }
+
+        // empty data nodes get no anchor, they stay in the chain until a neighbour is rewritten
+        auto filled = std::min(n->next, capacity);
+        if (filled > 0) {
+            auto smallest = n->pairs[0].key;
+            for (uint32_t i = 1; i < filled; i++) {
+                if (memcmp(n->pairs[i].key, smallest, DataLayer::Constants::KEYLEN) < 0) {
+                    smallest = n->pairs[i].key;
+                }
+            }
+            auto key = std::string_view((const char *)smallest, DataLayer::Constants::KEYLEN);
+            seg.nodes.emplace_back(Anchor::make_anchor(key), addr, n->type);
+        }
+
+        auto next = n->rlink;
+        if (next.is_nullptr()) {
+            seg.next = -1;
+            return nullptr;
+        }
+
+        if (auto s = walk.starts.find(next); s != walk.starts.end()) {
+            seg.next = s->second;
+            return nullptr;
+        }
+
+        if (next.get_node() >= (int)remote_memory_allocator.memory_nodes.size()) {
+            seg.broken = true;
+            return nullptr;
+        }
+        return next;
+    }
+
+    auto ComputeNode::register_thread() -> WorkerHandle * {
+        if (auto handle = bind_worker(); handle)
+            return handle;
+
+        auto rdma = remote_memory_allocator.setup_rdma_per_thread(rdma_dev.get());
+        if (!rdma) {
             Debug::error("Failed to setup rdma for each thread\n");
-            return false;
+            return nullptr;
         }
 
+        auto handle = std::make_unique<WorkerHandle>();
+        handle->rdma = rdma;
+        handle->slabs = allocator.thread_caches();
+        handle->window.scheduler = std::make_unique<Coroutine::Scheduler>(remote_memory_allocator.get_async_rdmas(),
+                                                                          Memory::Constants::ASYNC_WINDOW,
+                                                                          Memory::Constants::ASYNC_SLOT_SIZE);
+
+        std::scoped_lock<std::mutex> _(local_mutex);
+        auto ret = handle.get();
+        workers.insert({std::this_thread::get_id(), std::move(handle)});
+        bound = {id, ret};
+        return ret;
+    }
+
+    auto ComputeNode::bind_worker() -> WorkerHandle * {
         std::scoped_lock<std::mutex> _(local_mutex);
-        cctx.insert({std::this_thread::get_id(),
-                std::make_unique<Concurrency::ConcurrencyContext>()});
+        auto p = workers.find(std::this_thread::get_id());
+        if (p == workers.end())
+            return nullptr;
+
+        bound = {id, p->second.get()};
+        return bound.handle;
+    }
+
+    auto ComputeNode::next_id() -> uint64_t {
+        static std::atomic<uint64_t> next = 1;
+        return next.fetch_add(1);
+    }
+
+    auto ComputeNode::put(std::string_view key, std::string_view value,
+                          Stats::Breakdown *breakdown)
+        -> bool
+    {
+        return put(*current_worker(), key, value, breakdown);
+    }
+
+    auto ComputeNode::put(WorkerHandle &worker, std::string_view key, std::string_view value) -> bool {
+        return put(worker, key, value, &worker.breakdown);
+    }
+
+    auto ComputeNode::put(WorkerHandle &worker, std::string_view key, std::string_view value,
+                          Stats::Breakdown *breakdown)
+        -> bool
+    {
+        // skip list nodes found below stay valid until the guard leaves
+        Epoch::Guard guard;
+
+        if (!remote_put) {
+            if (quick_put(key, value))
+                return true;
+            // allow remote put
+        }
+
+        SkipListNode *data_node = nullptr;
+        // Compiler will eliminate this branch if nullptr of breakdown is given
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+            data_node = slist.fuzzy_search(key);
+            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        } else {
+            data_node = slist.fuzzy_search(key);
+        }
+
+        if (!data_node) {
+            std::runtime_error("Impossible to get nullptr from"
+                               "slist since remote_put is enabled\n");
+        }
+
+        return put_dispatcher(worker, data_node, key, value, breakdown);
+    }
+
+    auto ComputeNode::get(std::string_view key, Stats::Breakdown *breakdown)
+        -> std::optional<std::string>
+    {
+        return get(*current_worker(), key, breakdown);
+    }
+
+    auto ComputeNode::get(WorkerHandle &worker, std::string_view key) -> std::optional<std::string> {
+        return get(worker, key, &worker.breakdown);
+    }
+
+    auto ComputeNode::get(WorkerHandle &worker, std::string_view key, Stats::Breakdown *breakdown)
+        -> std::optional<std::string>
+    {
+        byte_t value[DataLayer::Constants::VALLEN];
+        if (!get(worker, key, value, breakdown)) {
+            return {};
+        }
+
+        return std::string((char *)value, DataLayer::Constants::VALLEN);
+    }
+
+    auto ComputeNode::get(std::string_view key, byte_ptr_t value, Stats::Breakdown *breakdown) -> bool {
+        return get(*current_worker(), key, value, breakdown);
+    }
+
+    auto ComputeNode::get(WorkerHandle &worker, std::string_view key, byte_ptr_t value) -> bool {
+        return get(worker, key, value, &worker.breakdown);
+    }
+
+    auto ComputeNode::get(WorkerHandle &worker, std::string_view key, byte_ptr_t value,
+                          Stats::Breakdown *breakdown)
+        -> bool
+    {
+        Epoch::Guard guard;
+
+        if (!remote_put) {
+            std::scoped_lock<std::mutex> _(local_mutex);
+            if (!local_anchors[1].empty() && key >= local_anchors[1]) {
+                return local_nodes[1]->find(key, value);
+            } else {
+                return local_nodes[0]->find(key, value);
+            }
+        }
+
+        // drain pending requests that the last operation hasn't processed
+        drain_pending(worker);
+
+        while (true) {
+            SkipListNode *node = nullptr;
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+                node = slist.fuzzy_search(key);
+                breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+            } else {
+                node = slist.fuzzy_search(key);
+            }
+
+            // a split or morph may move the node meanwhile
+            auto ptr = node->data_node;
+#ifdef __NODE_CACHE__
+            if (bool found; cached_find(worker, ptr, key, value, found)) {
+                return found;
+            }
+            auto token = node_cache.prepare(ptr);
+#endif
+
+            // a split linking its right half meanwhile may have taken key away
+            auto buffer = read_node(worker, node, breakdown);
+            if (!buffer || !covers(node, key))
+                continue;
+
+#ifdef __NODE_CACHE__
+            node_cache.fill(ptr, token, buffer);
+#endif
+            return buffer->find(key, value);
+        }
+    }
+
+    auto ComputeNode::read_node(WorkerHandle &worker, SkipListNode *node, Stats::Breakdown *breakdown)
+        -> LinkedNode16 *
+    {
+        auto ptr = node->data_node;
+        auto pauses = Constants::READ_BACKOFF;
+
+        for (int torn = 0; torn < Constants::OPTIMISTIC_READS; torn++) {
+            // we don't have to find the corrent fetch_as type since remote memory is completely
+            // exposed to us
+            auto type = node->type;
+            LinkedNode16 *buffer = nullptr;
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
+                buffer = worker.rdma->fetch_as<LinkedNode16 *>(ptr, sizeof(LinkedNode16));
+                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
+            } else {
+                buffer = worker.rdma->fetch_as<LinkedNode16 *>(ptr, sizeof(LinkedNode16));
+            }
+
+            if (buffer && node_intact(buffer, type))
+                return buffer;
+
+            // the keys may have moved to other nodes
+            if (node->data_node != ptr || node->is_removed())
+                return nullptr;
+
+            // give the write back in flight time to land rather than reading it again at once
+            for (int i = 0; i < pauses; i++) {
+                _mm_pause();
+            }
+            pauses *= 2;
+        }
+
+        while (true) {
+            auto [win, shared_ctx] =
+                try_win_for_update<LinkedNode16>(worker, node, {}, Concurrency::ConcurrencyContextType::Read,
+                                                 breakdown);
+            if (win) {
+                // the window of a reader is never opened, see try_win_for_update
+                auto buffer = reinterpret_cast<LinkedNode16 *>(shared_ctx->user_context);
+                node->ctx = nullptr;
+                return node->data_node == ptr ? buffer : nullptr;
+            }
+
+            // merged meanwhile
+            if (!shared_ctx)
+                return nullptr;
+
+            // the writer holding the node may well be the one changing ptr
+            for (int i = 0; i < pauses; i++) {
+                _mm_pause();
+            }
+
+            if (node->data_node != ptr || node->is_removed())
+                return nullptr;
+        }
+    }
+
+    auto ComputeNode::cached_find(WorkerHandle &worker, const RemotePointer &p, std::string_view key,
+                                  byte_ptr_t value, bool &found)
+        -> bool
+    {
+        if (!node_cache.contains(p)) {
+            return false;
+        }
+
+#ifdef __CACHE_REVALIDATE__
+        // other compute nodes may have written the node, every write back bumps its version
+        auto header = worker.rdma->fetch_as<LinkedNode16 *>(p, offsetof(LinkedNode16, fingerprints));
+        auto version = header->version;
+#endif
+
+        return node_cache.read(p, [&](const LinkedNode16 &image) {
+#ifdef __CACHE_REVALIDATE__
+            if (image.version != version) {
+                return false;
+            }
+#endif
+            found = image.find(key, value);
+            return true;
+        });
+    }
+
+    auto ComputeNode::multi_get(std::span<const std::string> keys, Stats::Breakdown *breakdown)
+        -> std::vector<std::optional<std::string>>
+    {
+        return multi_get(*current_worker(), keys, breakdown);
+    }
+
+    auto ComputeNode::multi_get(WorkerHandle &worker, std::span<const std::string> keys)
+        -> std::vector<std::optional<std::string>>
+    {
+        return multi_get(worker, keys, &worker.breakdown);
+    }
+
+    auto ComputeNode::multi_get(WorkerHandle &worker, std::span<const std::string> keys,
+                                Stats::Breakdown *breakdown)
+        -> std::vector<std::optional<std::string>>
+    {
+        Epoch::Guard guard;
+
+        std::vector<std::optional<std::string>> ret(keys.size());
+        if (!remote_put) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                ret[i] = get(worker, keys[i], breakdown);
+            }
+            return ret;
+        }
+
+        drain_pending(worker);
+
+        // owner[i] is the index of keys[i]'s data node in nodes
+        std::vector<SkipListNode *> nodes;
+        std::vector<size_t> owner(keys.size());
+        std::unordered_map<SkipListNode *, size_t> distinct;
+
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto node = slist.fuzzy_search(keys[i]);
+            auto [it, fresh] = distinct.insert({node, nodes.size()});
+            if (fresh) {
+                nodes.push_back(node);
+            }
+            owner[i] = it->second;
+        }
+        if (breakdown) {
+            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        }
+
+        // torn or failed reads are retried one by one after all batches are consumed,
+        // because get reuses the same RDMA buffer
+        std::vector<size_t> retry;
+        std::vector<RemotePointer> ptrs;
+        auto step = remote_memory_allocator.batch_capacity(sizeof(LinkedNode16));
+        for (size_t base = 0; base < nodes.size(); base += step) {
+            auto count = std::min(step, nodes.size() - base);
+            ptrs.clear();
+            for (size_t j = 0; j < count; j++) {
+                ptrs.push_back(nodes[base + j]->data_node);
+            }
+
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
+            }
+            auto buffer = reinterpret_cast<LinkedNode16 *>(
+                worker.rdma->fetch_batch(ptrs.data(), count, sizeof(LinkedNode16)));
+            if (breakdown) {
+                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
+            }
+
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (owner[i] < base || owner[i] >= base + count)
+                    continue;
+
+                if (buffer == nullptr) {
+                    retry.push_back(i);
+                    continue;
+                }
+
+                auto n = buffer + (owner[i] - base);
+                if (!node_intact(n, nodes[owner[i]]->type)) {
+                    retry.push_back(i);
+                    continue;
+                }
+
+                ret[i] = n->find(keys[i]);
+            }
+        }
+
+        for (auto i : retry) {
+            ret[i] = get(worker, keys[i], breakdown);
+        }
+
+        return ret;
+    }
+
+    auto ComputeNode::update(std::string_view key, std::string_view value,
+                             Stats::Breakdown *breakdown)
+        -> bool
+    {
+        return update(*current_worker(), key, value, breakdown);
+    }
+
+    auto ComputeNode::update(WorkerHandle &worker, std::string_view key, std::string_view value) -> bool {
+        return update(worker, key, value, &worker.breakdown);
+    }
+
+    auto ComputeNode::update(WorkerHandle &worker, std::string_view key, std::string_view value,
+                             Stats::Breakdown *breakdown)
+        -> bool
+    {
+        Epoch::Guard guard;
+
+    retry:
+        if (!remote_put) {
+            std::scoped_lock<std::mutex> _(local_mutex);
+            if (key > local_anchors[1]) {
+                return local_nodes[1]->update(key, value);
+            } else {
+                return local_nodes[0]->update(key, value);
+            }
+        }
+
+        SkipListNode *node = nullptr;
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+            node = slist.fuzzy_search(key);
+            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        } else {
+            node = slist.fuzzy_search(key);
+        }
+
+        if (node == nullptr)
+            return false;
+
+        auto ret = true;
+
+        drain_pending(worker);
+        // we don't have to find the corrent fetch_as type since remote memory is completely
+        // exposed to us
+        auto [win, shared_ctx] =
+            try_win_for_update<LinkedNode16>(worker, node, key,
+                                             Concurrency::ConcurrencyContextType::Update,
+                                             breakdown);
+        if (win) {
+            close_combining(shared_ctx, node, breakdown);
+            LinkedNode16 *buffer = reinterpret_cast<LinkedNode16 *>(shared_ctx->user_context);
+            ret = buffer->update(key, value);
+
+            Concurrency::ConcurrencyRequests *req;
+            while ((req = next_request(shared_ctx, node))) {
+                req->succeed = buffer->update(*reinterpret_cast<const std::string_view *>(req->tag),
+                                              *reinterpret_cast<const std::string_view *>(req->content));
+                req->retry = false;
+                req->finish();
+            }
+
+            // crc is patched by update, and try_win_for_update fetches the node to the head
+            // of the RDMA buffer
+            buffer->seal();
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
+                worker.rdma->write_to(node->data_node, DataLayer::sizeof_node(buffer->type));
+                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
+            } else {
+                worker.rdma->write_to(node->data_node, DataLayer::sizeof_node(buffer->type));
+            }
+            invalidate_cached(node->data_node);
+
+            node->ctx = nullptr;
+            shared_ctx->max_depth = 0;
+        } else {
+            // the node is merged into its predecessor or is being read, search again
+            if (!shared_ctx || shared_ctx->type == Concurrency::ConcurrencyContextType::Read)
+                goto retry;
+
+            if (shared_ctx->type != Concurrency::ConcurrencyContextType::Update)
+                return false;
+
+            if (auto [stat, retry] = failed_write(shared_ctx, node, key, value, breakdown);
+                retry == true) {
+                goto retry;
+            } else {
+                return stat;
+            }
+        }
+
+        return ret;
+    }
+
+    auto ComputeNode::remove(std::string_view key, Stats::Breakdown *breakdown) -> bool {
+        return remove(*current_worker(), key, breakdown);
+    }
+
+    auto ComputeNode::remove(WorkerHandle &worker, std::string_view key) -> bool {
+        return remove(worker, key, &worker.breakdown);
+    }
+
+    auto ComputeNode::remove(WorkerHandle &worker, std::string_view key, Stats::Breakdown *breakdown)
+        -> bool
+    {
+        Epoch::Guard guard;
+
+    retry:
+        if (!remote_put) {
+            std::scoped_lock<std::mutex> _(local_mutex);
+            if (key > local_anchors[1]) {
+                return local_nodes[1]->remove(key);
+            } else {
+                return local_nodes[0]->remove(key);
+            }
+        }
+
+        SkipListNode *node = nullptr;
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+            node = slist.fuzzy_search(key);
+            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        } else {
+            node = slist.fuzzy_search(key);
+        }
+
+        if (node == nullptr)
+            return false;
+
+        drain_pending(worker);
+        auto [win, shared_ctx] =
+            try_win_for_update<LinkedNode16>(worker, node, key,
+                                             Concurrency::ConcurrencyContextType::Delete,
+                                             breakdown);
+        if (!win) {
+            // only removals are combined, wait for a merge or a put to finish otherwise
+            if (!shared_ctx || shared_ctx->type != Concurrency::ConcurrencyContextType::Delete)
+                goto retry;
+
+            if (auto [stat, retry] = failed_write(shared_ctx, node, key, {}, breakdown); retry == true) {
+                goto retry;
+            } else {
+                return stat;
+            }
+        }
+
+        close_combining(shared_ctx, node, breakdown);
+        auto buffer = reinterpret_cast<LinkedNode16 *>(shared_ctx->user_context);
+        auto ret = buffer->remove(key);
+        auto dirty = ret;
+
+        Concurrency::ConcurrencyRequests *req;
+        while ((req = next_request(shared_ctx, node))) {
+            // a request may be meant for the node this context locked before, the submitter
+            // looks again by itself if the key is not here
+            req->succeed = buffer->remove(*reinterpret_cast<const std::string_view *>(req->tag));
+            req->retry = !req->succeed;
+            dirty |= req->succeed;
+            req->finish();
+        }
+
+        if (dirty && (buffer->usage() >= Constants::MERGE_THRESHOLD ||
+                      !try_merge(worker, node, buffer, shared_ctx, breakdown))) {
+            // the removed slots are reused by later puts, and remove has patched crc
+            buffer->seal();
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
+                worker.rdma->write_to(node->data_node, DataLayer::sizeof_node(buffer->type));
+                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
+            } else {
+                worker.rdma->write_to(node->data_node, DataLayer::sizeof_node(buffer->type));
+            }
+            invalidate_cached(node->data_node);
+        }
+
+        // peers spinning in failed_write retry by themselves rather than waiting for the
+        // next operation of this thread to drain their requests
+        node->ctx = nullptr;
+        shared_ctx->max_depth = 0;
+        return ret;
+    }
+
+    auto ComputeNode::try_merge(WorkerHandle &worker, SkipListNode *node, LinkedNode16 *buffer,
+                                Concurrency::ConcurrencyContext *shared_ctx,
+                                Stats::Breakdown *breakdown)
+        -> bool
+    {
+        // nothing is folded into the head
+        auto pred = node->backward.load();
+        auto capacity = DataLayer::capacity_of(pred->type);
+        if (capacity < buffer->next || capacity == 0)
+            return false;
+
+        Concurrency::ConcurrencyContext *expect = nullptr;
+        if (!pred->ctx.compare_exchange_strong(expect, shared_ctx))
+            return false;
+
+        if (pred->next() != node || pred->is_removed()) {
+            pred->ctx = nullptr;
+            return false;
+        }
+
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerMerge);
+        }
+
+        // the predecessor goes right after node's image, where write_back_current takes it
+        auto merged = false;
+        auto target = worker.rdma->fetch_as<LinkedNode16 *>(pred->data_node,
+                                                            DataLayer::sizeof_node(pred->type),
+                                                            sizeof(LinkedNode16)) + 1;
+        if (target->next + buffer->next <= capacity) {
+            target->absorb(*buffer);
+            target->rlink = buffer->rlink;
+            target->crc = crc_validate(target, target->type);
+            target->seal();
+
+            // keys of node are reachable from the predecessor before node leaves the search layer
+            merged = worker.rdma->write_back_current(pred->data_node, DataLayer::sizeof_node(pred->type));
+            invalidate_cached(pred->data_node);
+            if (merged) {
+                slist.remove(node);
+                invalidate_cached(node->data_node);
+                retire(node->data_node);
+            } else {
+                Debug::error("Failed to write back the merged node\n");
+            }
+        }
+
+        if (breakdown) {
+            breakdown->end(Stats::DiStoreBreakdownOps::DataLayerMerge);
+        }
+
+        pred->ctx = nullptr;
+        return merged;
+    }
+
+    auto ComputeNode::scan(std::string_view key, size_t count, Stats::Breakdown *breakdown)
+        -> uint64_t
+    {
+        return scan(key, count, nullptr, breakdown);
+    }
+
+    auto ComputeNode::scan(std::string_view key, size_t count, byte_ptr_t values,
+                           Stats::Breakdown *breakdown)
+        -> uint64_t
+    {
+        return scan(*current_worker(), key, count, values, breakdown);
+    }
+
+    auto ComputeNode::scan(WorkerHandle &worker, std::string_view key, size_t count, byte_ptr_t values)
+        -> uint64_t
+    {
+        return scan(worker, key, count, values, &worker.breakdown);
+    }
+
+    auto ComputeNode::scan(WorkerHandle &worker, std::string_view key, size_t count, byte_ptr_t values,
+                           Stats::Breakdown *breakdown)
+        -> uint64_t
+    {
+        auto total = 0UL;
+        for (RangeIterator it(*this, worker, key, {}, Memory::Constants::MAX_SCAN_DEPTH, count, breakdown);
+             it.valid() && total < count; it.next()) {
+            if (values) {
+                memcpy(values + total * DataLayer::Constants::VALLEN, it.value().data(),
+                       DataLayer::Constants::VALLEN);
+            }
+            ++total;
+        }
+
+        return total;
+    }
+
+    auto ComputeNode::range(std::string_view start, std::string_view end, size_t depth, size_t limit)
+        -> RangeIterator
+    {
+        return RangeIterator(*this, *current_worker(), start, end, depth, limit);
+    }
+
+    auto ComputeNode::range(WorkerHandle &worker, std::string_view start, std::string_view end,
+                            size_t depth, size_t limit)
+        -> RangeIterator
+    {
+        return RangeIterator(*this, worker, start, end, depth, limit);
+    }
+
+    RangeIterator::RangeIterator(ComputeNode &node, WorkerHandle &worker, std::string_view start,
+                                 std::string_view end, size_t depth, size_t limit,
+                                 Stats::Breakdown *breakdown)
+        : owner(node), worker(worker), breakdown(breakdown), start(start), end(end), limit(limit), pos(0),
+          cursor(nullptr), in_flight(0)
+    {
+        this->depth = std::clamp<size_t>(depth, 1, Memory::Constants::MAX_SCAN_DEPTH);
+        if (!end.empty() && start >= end) {
+            return;
+        }
+
+        if (!owner.remote_put) {
+            std::scoped_lock<std::mutex> _(owner.local_mutex);
+            // the anchors tell the order of the local nodes
+            if (owner.local_anchors[1].empty() || owner.local_anchors[0] < owner.local_anchors[1]) {
+                collect(*owner.local_nodes[0]);
+                collect(*owner.local_nodes[1]);
+            } else {
+                collect(*owner.local_nodes[1]);
+                collect(*owner.local_nodes[0]);
+            }
+            return;
+        }
+
+        owner.drain_pending(worker);
+
+        seek(start);
+        post_window();
+        fill();
+    }
+
+    RangeIterator::~RangeIterator() {
+        // the scan contexts must be quiet for the next iterator of this thread
+        if (in_flight) {
+            worker.rdma->wait_batch(batch);
+        }
+    }
+
+    auto RangeIterator::next() -> void {
+        ++pos;
+        fill();
+    }
+
+    auto RangeIterator::fill() -> void {
+        while (pos == pairs.size() && in_flight) {
+            receive_window();
+            post_window();
+        }
+    }
+
+    auto RangeIterator::post_window() -> void {
+        Memory::Transfer transfers[Memory::Constants::MAX_SCAN_DEPTH];
+        auto bound = end.empty() ? Anchor{} : Anchor::make_anchor(end);
+
+        // nodes are mostly fuller than the smallest type, one more for the first node of
+        // the range, which is only partially in it
+        auto want = std::min(depth, limit / capacity_of(LinkedNodeType::Type10) + 1);
+
+        in_flight = 0;
+        if (limit == 0) {
+            cursor = nullptr;
+        }
+
+        while (cursor && in_flight < want) {
+            // no key of the node is in range
+            if (!end.empty() && cursor->anchor >= bound) {
+                cursor = nullptr;
+                break;
+            }
+
+            window[in_flight] = cursor;
+            types[in_flight] = cursor->type;
+            transfers[in_flight] = {cursor->data_node, sizeof_node(types[in_flight]),
+                                    in_flight * sizeof(LinkedNode16)};
+            ++in_flight;
+            cursor = cursor->next();
+        }
+
+        if (in_flight) {
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
+            }
+            batch = worker.rdma->post_scan_batch(transfers, in_flight);
+        }
+    }
+
+    auto RangeIterator::receive_window() -> void {
+        auto ok = worker.rdma->wait_batch(batch);
+        if (breakdown) {
+            breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
+        }
+        auto buffer = reinterpret_cast<const LinkedNode16 *>(worker.rdma->scan_buffer());
+
+        pairs.clear();
+        pos = 0;
+        for (size_t i = 0; i < in_flight; i++) {
+            auto node = window[i];
+            auto n = buffer + i;
+
+            // torn by a write back, or node was split or merged after the window was posted.
+            // The rest of the window is dropped and node is read again, or the node now
+            // holding the last key if node is merged into it
+            if (!ok || !node_intact(n, types[i]) || !ComputeNode::links_next(node, n)) {
+                if (node->is_removed()) {
+                    seek(last.empty() ? start : last);
+                } else {
+                    cursor = node;
+                }
+                break;
+            }
+            collect(*n);
+
+            // the right half of a node split meanwhile comes before the rest of the window
+            auto succ = i + 1 < in_flight ? window[i + 1] : cursor;
+            if (node->next() != succ) {
+                cursor = node->next();
+                break;
+            }
+        }
+        in_flight = 0;
+    }
+
+    auto RangeIterator::seek(std::string_view key) -> void {
+        if (breakdown) {
+            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        }
+        cursor = owner.slist.fuzzy_search(key);
+        if (breakdown) {
+            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
+        }
+
+        // the head holds no pairs
+        if (cursor == owner.slist.iter()) {
+            cursor = cursor->next();
+        }
+    }
+
+    auto ComputeNode::co_get(std::string key) -> Coroutine::Task<std::optional<std::string>> {
+        Epoch::Guard guard;
+
+        if (!remote_put) {
+            co_return get(key, nullptr);
+        }
+
+        auto worker = current_worker();
+        auto sched = worker->window.scheduler.get();
+        auto slot = co_await sched->acquire();
+        auto buffer = reinterpret_cast<LinkedNode16 *>(sched->slot_buffer(slot));
+
+        std::optional<std::string> ret;
+        while (true) {
+            auto node = slist.fuzzy_search(key);
+            auto ptr = node->data_node;
+#ifdef __NODE_CACHE__
+            byte_t value[DataLayer::Constants::VALLEN];
+            if (bool found; cached_find(*worker, ptr, key, value, found)) {
+                if (found) {
+                    ret = std::string((char *)value, DataLayer::Constants::VALLEN);
+                }
+                break;
+            }
+            auto token = node_cache.prepare(ptr);
+#endif
+            if (!co_await sched->read(slot, {ptr, sizeof(LinkedNode16), 0})) {
+                break;
+            }
+
+            // torn by a concurrent write back, or key is taken away by a split, read again
+            if (node_intact(buffer, node->type) && covers(node, key)) {
+#ifdef __NODE_CACHE__
+                node_cache.fill(ptr, token, buffer);
+#endif
+                ret = buffer->find(key);
+                break;
+            }
+
+            // other coroutines run while the write back lands
+            co_await sched->yield();
+        }
+
+        sched->release(slot);
+        co_return ret;
+    }
+
+    auto ComputeNode::co_update(std::string key, std::string value) -> Coroutine::Task<bool> {
+        Epoch::Guard guard;
+
+        if (!remote_put) {
+            co_return update(key, value, nullptr);
+        }
+
+        auto window = get_async_window();
+        auto sched = window->scheduler.get();
+        auto slot = co_await sched->acquire();
+        auto lock = &window->locks[slot];
+        auto buffer = reinterpret_cast<LinkedNode16 *>(sched->slot_buffer(slot));
+        lock->type = Concurrency::ConcurrencyContextType::Update;
+
+        SkipListNode *node = nullptr;
+        while (true) {
+            node = slist.fuzzy_search(key);
+            Concurrency::ConcurrencyContext *expect = nullptr;
+            if (node->ctx.compare_exchange_strong(expect, lock)) {
+                // merged into its predecessor, or split with key in the right half meanwhile
+                if (!node->is_removed() && covers(node, key)) {
+                    break;
+                }
+                node->ctx.store(nullptr);
+            }
+            co_await sched->yield();
+        }
+
+        auto ret = co_await sched->read(slot, {node->data_node, sizeof_node(node->type), 0});
+        if (ret) {
+            ret = buffer->update(key, value);
+        }
+
+        if (ret) {
+            buffer->seal();
+            ret = co_await sched->write(slot, {node->data_node, sizeof_node(buffer->type), 0});
+            invalidate_cached(node->data_node);
+        }
 
-        return true;
+        unlock_async(window, slot, node, nullptr);
+        sched->release(slot);
+        co_return ret;
     }
 
-    auto ComputeNode::put(const std::string &key, const std::string &value,
-                          Stats::Breakdown *breakdown)
-        -> bool
-    {
+    auto ComputeNode::co_put(std::string key, std::string value) -> Coroutine::Task<bool> {
+        Epoch::Guard guard;
+
         if (!remote_put) {
-            if (quick_put(key, value))
-                return true;
-            // allow remote put
+            co_return put(key, value, nullptr);
         }
 
-        SkipListNode *data_node = nullptr;
-        // Compiler will eliminate this branch if nullptr of breakdown is given
-        if (breakdown) {
-            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-            data_node = slist.fuzzy_search(key);
-            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-        } else {
-            data_node = slist.fuzzy_search(key);
+        auto worker = current_worker();
+        auto window = &worker->window;
+        auto sched = window->scheduler.get();
+        auto slot = co_await sched->acquire();
+        auto lock = &window->locks[slot];
+        lock->type = Concurrency::ConcurrencyContextType::Insert;
+
+        // same layout as the sync path: predecessor, node and the right half of a split
+        auto pred_buffer = reinterpret_cast<LinkedNode16 *>(sched->slot_buffer(slot));
+        auto real = pred_buffer + 1;
+
+        SkipListNode *node = nullptr, *pred = nullptr;
+        while (true) {
+            node = slist.fuzzy_search(key);
+            // a key smaller than every anchor falls to the head, which put_dispatcher rejects too
+            if (node == slist.iter()) {
+                Debug::error("Key %s is smaller than any existing key\n", key.c_str());
+                sched->release(slot);
+                co_return false;
+            }
+            pred = node->backward.load();
+
+            Concurrency::ConcurrencyContext *expect = nullptr;
+            if (node->ctx.compare_exchange_strong(expect, lock)) {
+                expect = nullptr;
+                if (pred->ctx.compare_exchange_strong(expect, lock)) {
+                    // a split of the old predecessor may have linked a node in between, a split
+                    // of node may have taken key away, and a merge may have unlinked either
+                    if (pred->next() == node && !pred->is_removed() && !node->is_removed() &&
+                        covers(node, key)) {
+                        break;
+                    }
+                    pred->ctx.store(nullptr);
+                }
+                node->ctx.store(nullptr);
+            }
+            co_await sched->yield();
         }
 
-        if (!data_node) {
-            std::runtime_error("Impossible to get nullptr from"
-                               "slist since remote_put is enabled\n");
+        auto ret = co_await sched->read(slot,
+                                     {pred->data_node, sizeof_node(pred->type), 0},
+                                     {node->data_node, sizeof_node(node->type), sizeof(LinkedNode16)});
+
+        if (!ret) {
+            // nothing to do
+        } else if (help_pred(real, key, value)) {
+            real->crc = crc_validate(real, real->type);
+            real->seal();
+            ret = co_await sched->write(slot, {node->data_node, sizeof_node(real->type),
+                                               sizeof(LinkedNode16)});
+            invalidate_cached(node->data_node);
+        } else if (real->type != LinkedNodeType::Type16) {
+            // morph to a larger node, see put10
+            real->store(key, value);
+            real->type = morph_node(real);
+            real->crc = crc_validate(real, real->type);
+
+            auto r = allocate(*worker, sizeof_node(real->type));
+            pred_buffer->rlink = r;
+            pred_buffer->seal();
+            real->seal();
+            ret = co_await sched->write(slot,
+                                      {pred->data_node, sizeof_node(pred_buffer->type), 0},
+                                      {r, sizeof_node(real->type), sizeof(LinkedNode16)});
+            invalidate_cached(pred->data_node);
+            invalidate_cached(node->data_node);
+
+            if (ret) {
+                retire(node->data_node);
+                node->data_node = r;
+                node->type = real->type;
+            }
+        } else {
+            // 16 + 1 -> 10 + 10, see put16
+            auto [left, right, ranchor] = out_of_place_split_node(node, pred_buffer, real, lock, 9,
+                                                                  key, value, false);
+            left->type = LinkedNodeType::Type10;
+            right->type = LinkedNodeType::Type10;
+            left->crc = crc_validate(left, left->type);
+            right->crc = crc_validate(right, right->type);
+
+            auto l = allocate(*worker, sizeof(LinkedNode10));
+            auto r = allocate(*worker, sizeof(LinkedNode10));
+            pred_buffer->rlink = l;
+            right->rlink = left->rlink;
+            left->rlink = r;
+            pred_buffer->seal();
+            left->seal();
+            right->seal();
+
+            ret = co_await sched->write(slot,
+                                      {pred->data_node, sizeof_node(pred_buffer->type), 0},
+                                      {l, sizeof(LinkedNode10), sizeof(LinkedNode16)},
+                                      {r, sizeof(LinkedNode10), 2 * sizeof(LinkedNode16)});
+            invalidate_cached(pred->data_node);
+            invalidate_cached(node->data_node);
+
+            if (ret) {
+                retire(node->data_node);
+                node->data_node = l;
+                node->type = left->type;
+                link_split_node(node, ranchor, right->type, r);
+            }
         }
 
-        return put_dispatcher(data_node, key, value, breakdown);
+        unlock_async(window, slot, node, pred);
+        sched->release(slot);
+        co_return ret;
     }
 
-    auto ComputeNode::get(const std::string &key, Stats::Breakdown *breakdown)
-        -> std::optional<std::string>
-    {
+    auto ComputeNode::co_scan(std::string key, size_t count) -> Coroutine::Task<uint64_t> {
+        Epoch::Guard guard;
+
         if (!remote_put) {
-            std::scoped_lock<std::mutex> _(local_mutex);
-            if (!local_anchors[1].empty() && key >= local_anchors[1]) {
-                return local_nodes[1]->find(key);
+            co_return scan(key, count, nullptr);
+        }
+
+        auto worker = current_worker();
+        auto sched = worker->window.scheduler.get();
+        auto slot = co_await sched->acquire();
+        auto buffer = reinterpret_cast<LinkedNode16 *>(sched->slot_buffer(slot));
+
+        // the head holds no pairs
+        auto seek = [this](std::string_view k) {
+            auto n = slist.fuzzy_search(k);
+            return n == slist.iter() ? n->next() : n;
+        };
+
+        uint64_t total = 0;
+        // the largest key counted, a node read again after a split or a merge repeats keys
+        std::string last;
+        auto node = seek(key);
+
+        // two data nodes per round trip, see RangeIterator::receive_window for the checks
+        while (node && total < count) {
+            SkipListNode *nodes[2] = {node, node->next()};
+            LinkedNodeType types[2] = {node->type, nodes[1] ? nodes[1]->type : node->type};
+            bool ok;
+            if (nodes[1]) {
+                ok = co_await sched->read(slot,
+                                          {nodes[0]->data_node, sizeof_node(types[0]), 0},
+                                          {nodes[1]->data_node, sizeof_node(types[1]), sizeof(LinkedNode16)});
             } else {
-                return local_nodes[0]->find(key);
+                ok = co_await sched->read(slot, {nodes[0]->data_node, sizeof_node(types[0]), 0});
             }
-        }
 
-    retry:
+            if (!ok) {
+                break;
+            }
 
-        // drain pending requests that the last operation hasn't processed
-        drain_pending();
+            node = nullptr;
+            for (int i = 0; i < 2 && nodes[i] && total < count; i++) {
+                auto n = buffer + i;
+                if (!node_intact(n, types[i]) || !links_next(nodes[i], n)) {
+                    node = nodes[i]->is_removed() ? seek(last.empty() ? key : last) : nodes[i];
+                    // other coroutines run while the write back lands
+                    co_await sched->yield();
+                    break;
+                }
 
-        SkipListNode *node = nullptr;
+                uint8_t perm[DataLayer::Constants::SORT_WIDTH];
+                auto filled = n->sorted_slots(perm);
+                for (uint32_t j = 0; j < filled && total < count; j++) {
+                    auto k = std::string_view((const char *)n->pairs[perm[j]].key, DataLayer::Constants::KEYLEN);
+                    if (k < key || (!last.empty() && k <= last)) {
+                        continue;
+                    }
+                    last = k;
+                    ++total;
+                }
 
-        if (breakdown) {
-            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-            node = slist.fuzzy_search(key);
-            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-        } else {
-            node = slist.fuzzy_search(key);
+                // the right half of a node split meanwhile comes before the other node read
+                node = nodes[i]->next();
+                if (i == 0 && node != nodes[1]) {
+                    break;
+                }
+            }
         }
 
-        // we don't have to find the corrent fetch_as type since remote memory is completely
-        // exposed to us
-        LinkedNode16 *buffer = nullptr;
-        if (breakdown) {
-            breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
-            buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(node->data_node,
-                                                                      sizeof(LinkedNode16));
-            breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
-        } else {
-            buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(node->data_node,
-                                                                      sizeof(LinkedNode16));
-        }
+        sched->release(slot);
+        co_return total;
+    }
 
-        auto crc = crc_validate(buffer, node->type);
-        if (crc != buffer->crc)
-            goto retry;
+    auto ComputeNode::spawn_async(Coroutine::Task<void> task) -> void {
+        get_async_window()->scheduler->spawn(std::move(task));
+    }
 
-        return buffer->find(key);
+    auto ComputeNode::async_get(const std::string &key, AsyncCallback callback) -> void {
+        spawn_async([](ComputeNode *self, std::string key, AsyncCallback callback) -> Coroutine::Task<void> {
+            auto v = co_await self->co_get(std::move(key));
+            callback(v.has_value(), std::move(v));
+        }(this, key, std::move(callback)));
     }
 
-    auto ComputeNode::update(const std::string &key, const std::string &value,
-                             Stats::Breakdown *breakdown)
-        -> bool
+    auto ComputeNode::async_put(const std::string &key, const std::string &value,
+                                AsyncCallback callback)
+        -> void
     {
-    retry:
-        if (!remote_put) {
-            std::scoped_lock<std::mutex> _(local_mutex);
-            if (key > local_anchors[1]) {
-                return local_nodes[1]->update(key, value);
-            } else {
-                return local_nodes[0]->update(key, value);
-            }
+        spawn_async([](ComputeNode *self, std::string key, std::string value,
+                       AsyncCallback callback) -> Coroutine::Task<void> {
+            callback(co_await self->co_put(std::move(key), std::move(value)), {});
+        }(this, key, value, std::move(callback)));
+    }
+
+    auto ComputeNode::async_update(const std::string &key, const std::string &value,
+                                   AsyncCallback callback)
+        -> void
+    {
+        spawn_async([](ComputeNode *self, std::string key, std::string value,
+                       AsyncCallback callback) -> Coroutine::Task<void> {
+            callback(co_await self->co_update(std::move(key), std::move(value)), {});
+        }(this, key, value, std::move(callback)));
+    }
+
+    auto ComputeNode::poll_async() -> size_t {
+        return get_async_window()->scheduler->poll();
+    }
+
+    auto ComputeNode::wait_async() -> void {
+        auto sched = get_async_window()->scheduler.get();
+        while (sched->alive() != 0) {
+            sched->poll();
         }
+    }
 
-        SkipListNode *node = nullptr;
-        if (breakdown) {
-            breakdown->begin(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-            node = slist.fuzzy_search(key);
-            breakdown->end(Stats::DiStoreBreakdownOps::SearchLayerSearch);
-        } else {
-            node = slist.fuzzy_search(key);
+    auto ComputeNode::unlock_async(AsyncWindow *window, int slot, SkipListNode *node,
+                                   SkipListNode *pred)
+        -> void
+    {
+        node->ctx.store(nullptr);
+        if (pred) {
+            pred->ctx.store(nullptr);
         }
+        // let peers spinning in failed_write retry
+        window->locks[slot].max_depth = 0;
+    }
 
-        if (node == nullptr)
+    auto ComputeNode::begin_bulk_load(BulkLoad &load, double fill) -> bool {
+        if (fill <= 0 || fill > 1) {
+            Debug::error("Fill factor %f is not in (0, 1]\n", fill);
             return false;
+        }
 
-        auto ret = true;
+        {
+            std::scoped_lock<std::mutex> _(local_mutex);
+            if (remote_put || !local_anchors[0].empty()) {
+                Debug::error("Bulk load only fills an empty compute node\n");
+                return false;
+            }
+        }
 
-        drain_pending();
-        // we don't have to find the corrent fetch_as type since remote memory is completely
-        // exposed to us
-        auto [win, shared_ctx] =
-            try_win_for_update<LinkedNode16>(node,
-                                             Concurrency::ConcurrencyContextType::Update,
-                                             breakdown);
-        if (win) {
-            LinkedNode16 *buffer = reinterpret_cast<LinkedNode16 *>(shared_ctx->user_context);
-            ret = buffer->update(key, value);
+        load.images = reinterpret_cast<LinkedNode16 *>(remote_memory_allocator.get_rdma_buffer());
+        if (!load.images) {
+            Debug::error("Threads should always register before bulk loading\n");
+            return false;
+        }
 
-            Concurrency::ConcurrencyRequests *req;
-            while(shared_ctx->requests.try_pop(req)) {
-                req->succeed = buffer->update(*reinterpret_cast<const std::string *>(req->tag),
-                                              *reinterpret_cast<const std::string *>(req->content));
-                req->retry = false;
-                req->is_done = true;
-            }
+        auto capacity = capacity_of(LinkedNodeType::Type16);
+        load.cursor = slist.begin_append();
+        load.count[0] = load.count[1] = 0;
+        load.outstanding[0] = load.outstanding[1] = false;
+        load.half = 0;
+        load.node = nullptr;
+        load.slots = std::clamp<uint32_t>(std::lround(fill * capacity), 1, capacity);
+        load.loaded = 0;
+        return true;
+    }
 
-            buffer->crc = crc_validate(buffer, buffer->type);
+    auto ComputeNode::bulk_load_pair(BulkLoad &load, std::string_view key, std::string_view value)
+        -> bool
+    {
+        if (key.size() > DataLayer::Constants::KEYLEN || value.size() > DataLayer::Constants::VALLEN) {
+            Debug::error("Pair of %.*s does not fit in a slot\n", (int)key.size(), key.data());
+            return false;
+        }
 
-            if (breakdown) {
-                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
-                remote_memory_allocator.write_back_current(node->data_node, DataLayer::sizeof_node(buffer->type));
-                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
-            } else {
-                remote_memory_allocator.write_back_current(node->data_node, DataLayer::sizeof_node(buffer->type));
-            }
+        auto anchor = Anchor::make_anchor(key);
+        if (load.node && load.last >= anchor) {
+            Debug::error("Bulk loaded key %.*s is not ascending\n", (int)key.size(), key.data());
+            return false;
+        }
 
-            node->ctx = nullptr;
-            shared_ctx->max_depth = 4;
-        } else {
-            if (shared_ctx->type != Concurrency::ConcurrencyContextType::Update)
+        if (!load.node || load.node->next == load.slots) {
+            auto r = allocate(sizeof(LinkedNode16));
+            if (r.is_nullptr()) {
                 return false;
+            }
 
-            if (auto [stat, retry] = failed_write(shared_ctx, key, value, breakdown);
-                retry == true) {
-                goto retry;
-            } else {
-                return stat;
+            if (load.node) {
+                auto ok = commit_bulk_node(load, r);
+                load.node = nullptr;
+                if (!ok) {
+                    return false;
+                }
             }
+
+            auto i = load.count[load.half];
+            load.node = new (&load.images[load.half * Constants::BULK_LOAD_BATCH + i]) LinkedNode16;
+            load.node->crc = 0;
+            load.remote = r;
+            load.anchors[load.half][i] = anchor;
         }
 
-        return ret;
+        load.last = anchor;
+        load.node->store(key, value);
+        return true;
     }
 
-    auto ComputeNode::scan(const std::string &key, size_t count, Stats::Breakdown *breakdown)
-        -> uint64_t
-    {
-        auto total = 0UL;
-        auto first = slist.fuzzy_search(key);
-        std::vector<std::string> ret;
+    auto ComputeNode::commit_bulk_node(BulkLoad &load, RemotePointer next) -> bool {
+        auto node = load.node;
+        node->rlink = next;
+        node->crc = crc_validate(node, LinkedNodeType::Type16);
+        node->seal();
+
+        auto half = load.half;
+        auto i = load.count[half]++;
+        load.transfers[half][i] = {load.remote, sizeof(LinkedNode16),
+                                   (half * Constants::BULK_LOAD_BATCH + i) * sizeof(LinkedNode16)};
+        if (load.count[half] == Constants::BULK_LOAD_BATCH) {
+            return flush_bulk_batch(load);
+        }
+        return true;
+    }
 
-        if (first == nullptr) {
-            return {};
+    auto ComputeNode::flush_bulk_batch(BulkLoad &load) -> bool {
+        auto half = load.half;
+        load.posted[half] = remote_memory_allocator.post_batch(IBV_WR_RDMA_WRITE, load.transfers[half],
+                                                               load.count[half]);
+        load.outstanding[half] = true;
+
+        // the other half was posted one batch ago and is packed next
+        load.half ^= 1;
+        return link_bulk_batch(load, load.half);
+    }
+
+    auto ComputeNode::link_bulk_batch(BulkLoad &load, int half) -> bool {
+        if (!load.outstanding[half]) {
+            return true;
         }
 
-        auto second = first->forwards[0];
-        LinkedNode16 l[2], r[2];
-        RDMAContext *rdma = nullptr;
-        uint8_t flip = 0;
-        if (second && key <= second->anchor) {
-            fetch_two_into_buffer(first, second, &l[flip], &r[flip]);
-        } else {
-            auto n = remote_memory_allocator.fetch_as<LinkedNode16 *>(first->data_node, sizeof(LinkedNode16));
-            total = n->scan(key, count, ret);
-            return total;
+        load.outstanding[half] = false;
+        auto ok = remote_memory_allocator.wait_batch(load.posted[half]);
+        for (size_t i = 0; ok && i < load.count[half]; i++) {
+            // data nodes become reachable only after they are written
+            slist.append(load.cursor, load.anchors[half][i], load.transfers[half][i].remote,
+                         LinkedNodeType::Type16);
+            ++load.loaded;
         }
 
-        do {
-            first = second->forwards[0];
-            if (first == nullptr) {
-                poll_fetch_two_async(rdma, r[flip], l[flip]);
-                total += r[flip].scan(key, count - total, ret);
-                total += l[flip].scan(key, count - total, ret);
-                return total;
-            }
+        load.count[half] = 0;
+        if (!ok) {
+            Debug::error("Failed to write bulk loaded data nodes\n");
+        }
+        return ok;
+    }
 
-            second = first->forwards[0];
-            if (second == nullptr) {
-                total += r[flip].scan(key, count - total, ret);
-                total += l[flip].scan(key, count - total, ret);
-                auto n = remote_memory_allocator.fetch_as<LinkedNode16 *>(first->data_node, sizeof(LinkedNode16));
-                n->scan(key, count, ret);
-                return total;
+    auto ComputeNode::end_bulk_load(BulkLoad &load) -> bool {
+        auto ok = true;
+        if (load.node) {
+            ok = commit_bulk_node(load, nullptr);
+            load.node = nullptr;
+            if (load.count[load.half] > 0) {
+                ok &= flush_bulk_batch(load);
             }
+            ok &= link_bulk_batch(load, load.half ^ 1);
+        }
 
-            rdma = fetch_two_async(first, second);
-            total += r[flip].scan(key, count - total, ret);
-            total += l[flip].scan(key, count - total, ret);
-            flip = (flip + 1) & 0x1;
-            poll_fetch_two_async(rdma, r[flip], l[flip]);
-        } while (total < count);
+        if (load.loaded > 0) {
+            // the first data node is linked after the head, whose skip list node is not
+            ok &= link_head(slist.iter()->next()->data_node) && checkpoint();
 
-        return total;
+            std::scoped_lock<std::mutex> _(local_mutex);
+            remote_put = true;
+        }
+
+        Debug::info("%lu data nodes are bulk loaded\n", load.loaded);
+        return ok;
     }
 
     auto ComputeNode::allocate(size_t size) -> RemotePointer {
-        auto remote = allocator.allocate(size);
-        if (remote.is_nullptr()) {
-            auto new_seg = remote_memory_allocator.offer_remote_segment();
-            auto base = remote_memory_allocator.get_base_addr(new_seg.get_node());
-            allocator.apply_for_memory(new_seg, base);
+        return allocate(*current_worker(), size);
+    }
+
+    auto ComputeNode::allocate(WorkerHandle &worker, size_t size) -> RemotePointer {
+        // start from the round-robin pick and fall back to other MNs once it runs dry
+        auto nodes = remote_memory_allocator.memory_nodes.size();
+        auto first = remote_memory_allocator.pick_memory_node();
+        for (size_t i = 0; i < nodes; i++) {
+            auto remote = allocator.allocate(worker.slabs, size, (first + i) % nodes);
+            if (!remote.is_nullptr()) {
+                return remote;
+            }
+        }
 
-            remote = allocator.allocate(size);
+        // every pool runs dry before the prefetcher catches up
+        for (size_t i = 0; i < nodes; i++) {
+            int node = (first + i) % nodes;
+            if (!allocator.refill(node)) {
+                continue;
+            }
+
+            auto remote = allocator.allocate(worker.slabs, size, node);
+            if (!remote.is_nullptr()) {
+                return remote;
+            }
         }
 
-        return remote;
+        Debug::error("All memory nodes are depleted\n");
+        return nullptr;
     }
 
     auto ComputeNode::preallocate() -> bool {
-        auto new_seg = remote_memory_allocator.offer_remote_segment();
-        auto base = remote_memory_allocator.get_base_addr(new_seg.get_node());
-        allocator.apply_for_memory(new_seg, base);
-        return true;
+        auto ok = true;
+        for (size_t node = 0; node < remote_memory_allocator.memory_nodes.size(); node++) {
+            ok &= allocator.refill(node);
+        }
+        return ok;
     }
 
     auto ComputeNode::free(RemotePointer p)  -> void {
         allocator.free(p);
     }
 
-    auto ComputeNode::drain_pending() -> void {
-        auto thread_cctx = cctx.find(std::this_thread::get_id());
-        auto shared_ctx = thread_cctx->second.get();
+    ComputeNode::~ComputeNode() {
+        // the epoch manager outlives the node, so its limbo lists must not keep pointing here
+        Epoch::EpochManager::instance().reclaim_all(this);
+    }
+
+    auto ComputeNode::retire(RemotePointer p) -> void {
+        Epoch::EpochManager::instance().retire(p.void_ptr(), reclaim_chunk, this);
+    }
+
+    auto ComputeNode::reclaim_chunk(void *chunk, void *self) -> void {
+        auto raw = reinterpret_cast<byte_ptr_t>(chunk);
+        auto p = RemotePointer(raw);
+        auto node = reinterpret_cast<ComputeNode *>(self);
+
+        // a reader may have cached the old image after it was written back
+        node->invalidate_cached(p);
+
+        // chunks written before a recovery are in segments of the crashed compute node
+        if (node->recovered && !node->allocator.owns(p)) {
+            return;
+        }
+        node->free(p);
+    }
+
+    auto ComputeNode::drain_pending(WorkerHandle &worker) -> void {
+        auto shared_ctx = &worker.cctx;
         Concurrency::ConcurrencyRequests *req;
         while (shared_ctx->requests.try_pop(req)) {
             req->succeed = false;
             req->retry = true;
-            req->is_done = true;
+            req->finish();
+        }
+    }
+
+    auto ComputeNode::close_combining(Concurrency::ConcurrencyContext *ctx, SkipListNode *node,
+                                      Stats::Breakdown *breakdown)
+        -> void
+    {
+        auto depth = node->combining.load(std::memory_order_relaxed);
+        if (ctx->granted > Concurrency::Constants::COMBINING_DEPTH) {
+            if (breakdown) {
+                breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerCombiningWindow);
+            }
+            for (int i = 0; i < Concurrency::Constants::COMBINING_WINDOW && ctx->max_depth > 0; i++) {
+                _mm_pause();
+            }
+            if (breakdown) {
+                breakdown->end(Stats::DiStoreBreakdownOps::DataLayerCombiningWindow);
+            }
+        }
+
+        // waiters may keep taking the counter below zero, those are turned away
+        auto left = ctx->max_depth.exchange(-1);
+        auto accepted = ctx->granted - std::max(left, 0);
+        while (ctx->requests.size() < (size_t)accepted) {
+            _mm_pause();
+        }
+
+        if (ctx->granted > 0 && left <= 0) {
+            depth = std::min(depth * 2, Concurrency::Constants::MAX_COMBINING_DEPTH);
+        } else if (accepted * 2 < depth) {
+            depth = std::max(depth - 1, Concurrency::Constants::COMBINING_DEPTH);
+        }
+        node->combining.store(depth, std::memory_order_relaxed);
+
+        if (breakdown) {
+            breakdown->record(Stats::DiStoreBreakdownOps::DataLayerCombined, accepted);
+        }
+    }
+
+    auto ComputeNode::next_request(Concurrency::ConcurrencyContext *ctx, SkipListNode *node)
+        -> Concurrency::ConcurrencyRequests *
+    {
+        Concurrency::ConcurrencyRequests *req;
+        while (ctx->requests.try_pop(req)) {
+            // node may have been split after the waiter found it
+            auto key = reinterpret_cast<const std::string_view *>(req->tag);
+            if (req->expected == node && covers(node, *key)) {
+                return req;
+            }
+
+            req->succeed = false;
+            req->retry = true;
+            req->finish();
         }
+        return nullptr;
     }
 
-    auto ComputeNode::quick_put(const std::string &key, const std::string &value) -> bool {
+    auto ComputeNode::quick_put(std::string_view key, std::string_view value) -> bool {
         RemotePointer larger, smaller;
         static LinkedNode12 remote;
         std::scoped_lock<std::mutex> _(local_mutex);
@@ -344,6 +1751,7 @@ namespace DiStore::Cluster {
 
 
         remote.crc = crc_validate(reinterpret_cast<LinkedNode16 *>(&remote), remote.type);
+        remote.seal();
         if (!remote_memory_allocator.write_to(larger, sizeof(LinkedNode12),
                                               reinterpret_cast<byte_ptr_t>(&remote))) {
             Debug::error("Failed to flush local nodes to remote at early stage\n");
@@ -351,12 +1759,18 @@ namespace DiStore::Cluster {
         }
 
         no_move->crc = crc_validate(reinterpret_cast<LinkedNode16 *>(no_move), no_move->type);
+        no_move->seal();
         if (!remote_memory_allocator.write_to(smaller, sizeof(LinkedNode10),
                                               reinterpret_cast<byte_ptr_t>(no_move))) {
             Debug::error("Failed to flush local nodes to remote at early stage\n");
             return false;
         }
 
+        // the head leads a recovery to the flushed nodes
+        if (!link_head(to_target == local_nodes[0] ? larger : smaller)) {
+            return false;
+        }
+
         // should only update search layer after local nodes being flushed to remote
         if (to_target == local_nodes[0]) {
             slist.insert(local_anchors[0], larger, LinkedNodeType::Type12);
@@ -371,7 +1785,7 @@ namespace DiStore::Cluster {
         return true;
     }
 
-    auto ComputeNode::quick_put_pick_node(const std::string &key) -> DataLayer::LinkedNode10 * {
+    auto ComputeNode::quick_put_pick_node(std::string_view key) -> DataLayer::LinkedNode10 * {
         if (local_anchors[0].empty()) {
             local_anchors[0] = key;
             return local_nodes[0];
@@ -403,32 +1817,37 @@ namespace DiStore::Cluster {
         return to_target;
     }
 
-    auto ComputeNode::put_dispatcher(SkipListNode *data_node, const std::string &key,
-                                     const std::string &value, Stats::Breakdown *breakdown)
+    auto ComputeNode::put_dispatcher(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                                     std::string_view value, Stats::Breakdown *breakdown)
         -> bool
     {
     retry:
+        // the node is merged into its predecessor, or split with key in the right half
+        if (data_node->is_removed() || !covers(data_node, key)) {
+            data_node = slist.fuzzy_search(key);
+        }
+
         switch (data_node->type){
         case LinkedNodeType::Type10:
-            if (auto [ret, retry] = put10(data_node, key, value, breakdown); retry == true) {
+            if (auto [ret, retry] = put10(worker, data_node, key, value, breakdown); retry == true) {
                 goto retry;
             } else {
                 return ret;
             }
         case LinkedNodeType::Type12:
-            if (auto [ret, retry] = put12(data_node, key, value, breakdown); retry == true) {
+            if (auto [ret, retry] = put12(worker, data_node, key, value, breakdown); retry == true) {
                 goto retry;
             } else {
                 return ret;
             }
         case LinkedNodeType::Type14:
-            if (auto [ret, retry] = put14(data_node, key, value, breakdown); retry == true) {
+            if (auto [ret, retry] = put14(worker, data_node, key, value, breakdown); retry == true) {
                 goto retry;
             } else {
                 return ret;
             }
         case LinkedNodeType::Type16:
-            if (auto [ret, retry] = put16(data_node, key, value, breakdown); retry == true) {
+            if (auto [ret, retry] = put16(worker, data_node, key, value, breakdown); retry == true) {
                 goto retry;
             } else {
                 return ret;
@@ -448,8 +1867,8 @@ namespace DiStore::Cluster {
     }
 
     // 10 + 5 -> 16
-    auto ComputeNode::put10(SkipListNode *data_node, const std::string &key, const std::string &value,
-                            Stats::Breakdown *breakdown)
+    auto ComputeNode::put10(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                            std::string_view value, Stats::Breakdown *breakdown)
         -> std::pair<bool, bool>
     {
         // std::string __name = __FUNCTION__;
@@ -459,19 +1878,19 @@ namespace DiStore::Cluster {
         // });
         
         bool ret = true;
-        drain_pending();
+        drain_pending(worker);
         auto [win, shared_ctx] =
-            try_win_for_insert<LinkedNode10>(data_node,
+            try_win_for_insert<LinkedNode10>(worker, data_node, key,
                                              Concurrency::ConcurrencyContextType::Insert,
                                              breakdown);
         if (!win) {
             if (!shared_ctx || shared_ctx->type != Concurrency::ConcurrencyContextType::Insert)
                 return {false, true};
 
-            return failed_write(shared_ctx, key, value, breakdown);
+            return failed_write(shared_ctx, data_node, key, value, breakdown);
         }
 
-        auto [done, pendings] = try_put_to_existing_node<LinkedNode10>(shared_ctx,
+        auto [done, pendings] = try_put_to_existing_node<LinkedNode10>(worker, shared_ctx,
                                                                        data_node,
                                                                        key, value,
                                                                        breakdown);
@@ -485,18 +1904,18 @@ namespace DiStore::Cluster {
                 real->store(key, value);
 
             Concurrency::ConcurrencyRequests *req = nullptr;
-            const std::string *k, *v;
-            while (shared_ctx->requests.try_pop(req)) {
+            const std::string_view *k, *v;
+            while ((req = next_request(shared_ctx, data_node))) {
                 // space is guaranteed to be sufficient
-                k = reinterpret_cast<const std::string *>(req->tag);
-                v = reinterpret_cast<const std::string *>(req->content);
-                if (*k >= data_node->anchor) {
+                k = reinterpret_cast<const std::string_view *>(req->tag);
+                v = reinterpret_cast<const std::string_view *>(req->content);
+                if (Anchor::make_anchor(*k) >= data_node->anchor) {
                     req->succeed = real->store(*k, *v);
                 } else {
                     req->succeed = help_pred(pred, *k, *v);
                 }
                 req->retry = !req->succeed;                
-                req->is_done = true;
+                req->finish();
             }
 
             if (breakdown) {
@@ -514,10 +1933,10 @@ namespace DiStore::Cluster {
             if (breakdown) {
                 breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteMorphed);
                 // sta = remote_memory_allocator.write_to(remote, lsize);
-                remote = write_back_morphed(data_node, pred, real);
+                remote = write_back_morphed(worker, data_node, pred, real);
                 breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteMorphed);
             } else {
-                remote = write_back_morphed(data_node, pred, real);
+                remote = write_back_morphed(worker, data_node, pred, real);
             }
 
             if (remote == nullptr) {
@@ -535,11 +1954,11 @@ namespace DiStore::Cluster {
         // then a requests is enqueued, but this winner will not process
         // it.
         data_node->ctx.store(nullptr);
-        data_node->backward->ctx.store(nullptr);
-        shared_ctx->max_depth = 4;
+        data_node->backward.load()->ctx.store(nullptr);
+        shared_ctx->max_depth = 0;
 
         if (!ret) {
-            auto msg = "Failed to put " + key + " in " + __FUNCTION__ + "\n";
+            auto msg = "Failed to put " + std::string(key) + " in " + __FUNCTION__ + "\n";
             throw std::runtime_error(msg);
         }
 
@@ -547,8 +1966,8 @@ namespace DiStore::Cluster {
     }
 
     // 12 + 5 -> 10 + 10
-    auto ComputeNode::put12(SkipListNode *data_node, const std::string &key, const std::string &value,
-                            Stats::Breakdown *breakdown)
+    auto ComputeNode::put12(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                            std::string_view value, Stats::Breakdown *breakdown)
         -> std::pair<bool, bool>
     {
         // std::string __name = __FUNCTION__;
@@ -559,9 +1978,9 @@ namespace DiStore::Cluster {
         
         
         bool ret = true;
-        drain_pending();
+        drain_pending(worker);
         auto [win, shared_ctx] =
-            try_win_for_insert<LinkedNode12>(data_node,
+            try_win_for_insert<LinkedNode12>(worker, data_node, key,
                                              Concurrency::ConcurrencyContextType::Insert,
                                              breakdown);
 
@@ -569,10 +1988,10 @@ namespace DiStore::Cluster {
             if (!shared_ctx || shared_ctx->type != Concurrency::ConcurrencyContextType::Insert)
                 return {false, true};
 
-            return failed_write(shared_ctx, key, value, breakdown);
+            return failed_write(shared_ctx, data_node, key, value, breakdown);
         }
 
-        auto [done, pendings] = try_put_to_existing_node<LinkedNode12>(shared_ctx, data_node, key,
+        auto [done, pendings] = try_put_to_existing_node<LinkedNode12>(worker, shared_ctx, data_node, key,
                                                                        value, breakdown);
         if (pendings == 0) {
             ret = true;
@@ -584,10 +2003,10 @@ namespace DiStore::Cluster {
             if (pendings <= 4) {
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerMorph);
-                    ret = eager_morph(data_node, real, shared_ctx, key, value, done);
+                    ret = eager_morph(worker, data_node, real, shared_ctx, key, value, done);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerMorph);
                 } else {
-                    ret = eager_morph(data_node, real, shared_ctx, key, value, done);
+                    ret = eager_morph(worker, data_node, real, shared_ctx, key, value, done);
                 }
             } else {
                 LinkedNode16 *left = nullptr, *right = nullptr;
@@ -605,8 +2024,8 @@ namespace DiStore::Cluster {
                                                                              key, value, done);
                 }
 
-                left->type = LinkedNodeType::Type10;
-                right->type = LinkedNodeType::Type10;
+                left->type = fit_type(LinkedNodeType::Type10, left->next);
+                right->type = fit_type(LinkedNodeType::Type10, right->next);
                 left->crc = crc_validate(left, left->type);
                 right->crc = crc_validate(right, right->type);
 
@@ -614,18 +2033,18 @@ namespace DiStore::Cluster {
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                     // r = write_back_two<LinkedNode10, LinkedNode10>(data_node, left, right);
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                 } else {
                     // r = write_back_two<LinkedNode10, LinkedNode10>(data_node, left, right);
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                 }
 
                 if (r.is_nullptr()) {
                     ret =  false;
                 } else {
                     // update_queue.push({ranchor, LinkedNodeType::Type10, r});
-                    async_update(data_node, ranchor, LinkedNodeType::Type10, r);
+                    link_split_node(data_node, ranchor, right->type, r);
                     ret = true;
                 }
 
@@ -633,11 +2052,14 @@ namespace DiStore::Cluster {
             }
         }
 
+        // requests the morphed or split node had no room for retry now rather than wait for
+        // this worker's next put
+        drain_pending(worker);
         data_node->ctx.store(nullptr);
-        data_node->backward->ctx.store(nullptr);
-        shared_ctx->max_depth = 4;
+        data_node->backward.load()->ctx.store(nullptr);
+        shared_ctx->max_depth = 0;
         if (!ret) {
-            auto msg = "Failed to put " + key + " in " + __FUNCTION__ + "\n";
+            auto msg = "Failed to put " + std::string(key) + " in " + __FUNCTION__ + "\n";
             throw std::runtime_error(msg);
         }
 
@@ -645,8 +2067,8 @@ namespace DiStore::Cluster {
     }
 
     // 14 + 5 -> 10 + 12
-    auto ComputeNode::put14(SkipListNode *data_node, const std::string &key, const std::string &value,
-                            Stats::Breakdown *breakdown)
+    auto ComputeNode::put14(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                            std::string_view value, Stats::Breakdown *breakdown)
         -> std::pair<bool, bool>
     {
         // std::string __name = __FUNCTION__;
@@ -657,9 +2079,9 @@ namespace DiStore::Cluster {
         
         
         bool ret = true;
-        drain_pending();
+        drain_pending(worker);
         auto [win, shared_ctx] =
-            try_win_for_insert<LinkedNode14>(data_node,
+            try_win_for_insert<LinkedNode14>(worker, data_node, key,
                                              Concurrency::ConcurrencyContextType::Insert,
                                              breakdown);
 
@@ -667,10 +2089,10 @@ namespace DiStore::Cluster {
             if (!shared_ctx || shared_ctx->type != Concurrency::ConcurrencyContextType::Insert)
                 return {false, true};
 
-            return failed_write(shared_ctx, key, value, breakdown);
+            return failed_write(shared_ctx, data_node, key, value, breakdown);
         }
 
-        auto [done, pendings] = try_put_to_existing_node<LinkedNode14>(shared_ctx,
+        auto [done, pendings] = try_put_to_existing_node<LinkedNode14>(worker, shared_ctx,
                                                                        data_node,
                                                                        key, value,
                                                                        breakdown);
@@ -683,10 +2105,10 @@ namespace DiStore::Cluster {
             if (pendings <= 2) {
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerMorph);
-                    ret = eager_morph(data_node, real, shared_ctx, key, value, done);
+                    ret = eager_morph(worker, data_node, real, shared_ctx, key, value, done);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerMorph);
                 } else {
-                    ret = eager_morph(data_node, real, shared_ctx, key, value, done);
+                    ret = eager_morph(worker, data_node, real, shared_ctx, key, value, done);
                 }
             } else {
                 LinkedNode16 *left = nullptr, *right = nullptr;
@@ -704,25 +2126,25 @@ namespace DiStore::Cluster {
                                                                              key, value, done);
                 }
 
-                left->type = LinkedNodeType::Type10;
-                right->type = LinkedNodeType::Type12;
+                left->type = fit_type(LinkedNodeType::Type10, left->next);
+                right->type = fit_type(LinkedNodeType::Type12, right->next);
                 left->crc = crc_validate(left, left->type);
                 right->crc = crc_validate(right, right->type);
 
                 RemotePointer r;
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                 } else {
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                 }
 
                 if (r.is_nullptr()) {
                     ret = false;
                 } else {
                     // update_queue.push({ranchor, LinkedNodeType::Type12, r});
-                    async_update(data_node, ranchor, LinkedNodeType::Type12, r);
+                    link_split_node(data_node, ranchor, right->type, r);
                     ret = true;
                 }
 
@@ -730,11 +2152,14 @@ namespace DiStore::Cluster {
             }
         }
 
+        // requests the morphed or split node had no room for retry now rather than wait for
+        // this worker's next put
+        drain_pending(worker);
         data_node->ctx.store(nullptr);
-        data_node->backward->ctx.store(nullptr);
-        shared_ctx->max_depth = 4;
+        data_node->backward.load()->ctx.store(nullptr);
+        shared_ctx->max_depth = 0;
         if (!ret) {
-            auto msg = "Failed to put " + key + " in " + __FUNCTION__ + "\n";
+            auto msg = "Failed to put " + std::string(key) + " in " + __FUNCTION__ + "\n";
             throw std::runtime_error(msg);
         }
         
@@ -742,8 +2167,8 @@ namespace DiStore::Cluster {
     }
 
     // 16 + 5 -> 12 + 12
-    auto ComputeNode::put16(SkipListNode *data_node, const std::string &key, const std::string &value,
-                            Stats::Breakdown *breakdown)
+    auto ComputeNode::put16(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                            std::string_view value, Stats::Breakdown *breakdown)
         -> std::pair<bool, bool>
     {
         // std::string __name = __FUNCTION__;
@@ -753,9 +2178,9 @@ namespace DiStore::Cluster {
         // });
         
         bool ret = true;
-        drain_pending();
+        drain_pending(worker);
         auto [win, shared_ctx] =
-            try_win_for_insert<LinkedNode16>(data_node,
+            try_win_for_insert<LinkedNode16>(worker, data_node, key,
                                              Concurrency::ConcurrencyContextType::Insert,
                                              breakdown);
 
@@ -763,10 +2188,10 @@ namespace DiStore::Cluster {
             if (!shared_ctx || shared_ctx->type != Concurrency::ConcurrencyContextType::Insert)
                 return {false, true};
 
-            return failed_write(shared_ctx, key, value, breakdown);
+            return failed_write(shared_ctx, data_node, key, value, breakdown);
         }
 
-        auto [done, pendings] = try_put_to_existing_node<LinkedNode16>(shared_ctx,
+        auto [done, pendings] = try_put_to_existing_node<LinkedNode16>(worker, shared_ctx,
                                                                        data_node,
                                                                        key, value,
                                                                        breakdown);
@@ -791,17 +2216,17 @@ namespace DiStore::Cluster {
                                                                              key, value, done);
                 }
 
-                left->type = LinkedNodeType::Type10;
-                right->type = LinkedNodeType::Type10;
+                left->type = fit_type(LinkedNodeType::Type10, left->next);
+                right->type = fit_type(LinkedNodeType::Type10, right->next);
                 left->crc = crc_validate(left, left->type);
                 right->crc = crc_validate(right, right->type);
 
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                 } else {
-                    r = write_back_splitted<LinkedNode10, LinkedNode10>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                 }
             } else if(pendings <= 4) {
                 if (breakdown) {
@@ -816,17 +2241,17 @@ namespace DiStore::Cluster {
                                                                              key, value, done);
                 }
 
-                left->type = LinkedNodeType::Type10;
-                right->type = LinkedNodeType::Type12;
+                left->type = fit_type(LinkedNodeType::Type10, left->next);
+                right->type = fit_type(LinkedNodeType::Type12, right->next);
                 left->crc = crc_validate(left, left->type);
                 right->crc = crc_validate(right, right->type);
 
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
-                    r = write_back_splitted<LinkedNode10, LinkedNode12>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                 } else {
-                    r = write_back_splitted<LinkedNode10, LinkedNode12>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                 }
             } else {
                 if (breakdown) {
@@ -841,17 +2266,17 @@ namespace DiStore::Cluster {
                                                                              key, value, done);
                 }
 
-                left->type = LinkedNodeType::Type12;
-                right->type = LinkedNodeType::Type12;
+                left->type = fit_type(LinkedNodeType::Type12, left->next);
+                right->type = fit_type(LinkedNodeType::Type12, right->next);
                 left->crc = crc_validate(left, left->type);
                 right->crc = crc_validate(right, right->type);
 
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
-                    r = write_back_splitted<LinkedNode12, LinkedNode12>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteSplitted);
                 } else {
-                    r = write_back_splitted<LinkedNode12, LinkedNode12>(data_node, pred, left, right);
+                    r = write_back_splitted(worker, data_node, pred, left, right);
                 }
             }
 
@@ -859,57 +2284,66 @@ namespace DiStore::Cluster {
                 ret =  false;
             else {
                 // update_queue.push({ranchor, right->type, r});
-                async_update(data_node, ranchor, right->type, r);
+                link_split_node(data_node, ranchor, right->type, r);
             }
 
             data_node->type = left->type;
         }
 
+        // requests the morphed or split node had no room for retry now rather than wait for
+        // this worker's next put
+        drain_pending(worker);
         data_node->ctx.store(nullptr);
-        data_node->backward->ctx.store(nullptr);
-        shared_ctx->max_depth = 4;
+        data_node->backward.load()->ctx.store(nullptr);
+        shared_ctx->max_depth = 0;
         if (!ret) {
-            auto msg = "Failed to put " + key + " in " + __FUNCTION__ + "\n";
+            auto msg = "Failed to put " + std::string(key) + " in " + __FUNCTION__ + "\n";
             throw std::runtime_error(msg);
         }
         
         return {ret, false};
     }
 
-    auto ComputeNode::failed_write(Concurrency::ConcurrencyContext *cctx,
-                                   const std::string &key, const std::string &value,
+    auto ComputeNode::failed_write(Concurrency::ConcurrencyContext *cctx, SkipListNode *data_node,
+                                   std::string_view key, std::string_view value,
                                    Stats::Breakdown *breakdown)
         -> std::pair<bool, bool>
     {
-        while (cctx->max_depth == -1)
-            ;
+        while (cctx->max_depth == -1) {
+            // the winner has left, and its context may stay closed for long
+            if (data_node->ctx.load() != cctx)
+                return {false, true};
+        }
 
         auto depth = cctx->max_depth.fetch_sub(1);
         if (depth > 0) {
             if (breakdown) {
                 breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerContention);
             }
-            auto req = new Concurrency::ConcurrencyRequests;
+            auto req = cctx->requests.claim();
             req->tag = &key;
             req->content = &value;
-            cctx->requests.emplace(req);
+            req->expected = data_node;
+            cctx->requests.publish(req);
 
-            while (!req->is_done)
-                ;
+            // the slot is ours again once the winner finishes it
+            req->wait();
+            std::pair<bool, bool> ret = {req->succeed, req->retry};
+            cctx->requests.release(req);
 
             if (breakdown) {
                 breakdown->end(Stats::DiStoreBreakdownOps::DataLayerContention);
             }
-            return {req->succeed, req->retry};
+            return ret;
         } else {
             // competition failed, should retry
             return {false, true};
         }
     }
 
-    auto ComputeNode::eager_morph(SkipListNode *data_node, LinkedNode16 *real,
+    auto ComputeNode::eager_morph(WorkerHandle &worker, SkipListNode *data_node, LinkedNode16 *real,
                                   Concurrency::ConcurrencyContext *shared_ctx,
-                                  const std::string &key, const std::string &value,
+                                  std::string_view key, std::string_view value,
                                   bool done)
         -> bool
     {
@@ -925,14 +2359,14 @@ namespace DiStore::Cluster {
         //     req->succeed = real->store(*reinterpret_cast<const std::string *>(req->tag),
         //                                *reinterpret_cast<const std::string *>(req->content));
         //     req->retry = false;
-        //     req->is_done = true;
+        //     req->finish();
         // }
 
         real->type = LinkedNodeType::Type16;
         real->crc = crc_validate(real, real->type);
 
         RemotePointer remote;
-        if (remote = write_back_morphed(data_node, pred, real); remote == nullptr) {
+        if (remote = write_back_morphed(worker, data_node, pred, real); remote == nullptr) {
             Debug::error("Failed to write back to remote after eager morphing\n");
             return false;
         }
@@ -944,59 +2378,48 @@ namespace DiStore::Cluster {
         return true;
     }
 
-    auto ComputeNode::inplace_split_node(LinkedNode16 *source_buffer, size_t left_cap)
-            -> std::tuple<LinkedNode16 *, LinkedNode16 *, std::string>
+    auto ComputeNode::split_sorted(const BufferNode &source, size_t left_cap,
+                                   LinkedNode16 *left, LinkedNode16 *right)
+        -> std::string
     {
-        auto total_records = source_buffer->next;
-        auto left = source_buffer;
-        // we have sufficient buffer
-        auto right = left + 1;
-
-        int reorder_map[16] = {-1};
-        bool picked[16] = {false};
-
-        construct_reorder_map(source_buffer, left_cap, reorder_map, picked);
-        auto right_anchor = std::string((char *)source_buffer->pairs[reorder_map[left_cap]].key,
+        uint8_t perm[DataLayer::Constants::SORT_WIDTH];
+        auto filled = source.sorted_slots(perm);
+        auto right_anchor = std::string((char *)source.pairs[perm[left_cap]].key,
                                         DataLayer::Constants::KEYLEN);
-        picked[reorder_map[left_cap]] = false;
 
-        // partially sorted, start migrating
+        left->next = 0;
         right->next = 0;
-        for (size_t i = 0; i < total_records; i++) {
-            if (picked[i])
-                continue;
-
-            right->store(left->pairs[i].key, DataLayer::Constants::KEYLEN,
-                         left->pairs[i].value, DataLayer::Constants::VALLEN);
+        for (uint32_t i = 0; i < filled; i++) {
+            auto target = i < left_cap ? left : right;
+            target->fingerprints[target->next] = source.fingerprints[perm[i]];
+            target->pairs[target->next] = source.pairs[perm[i]];
+            ++target->next;
         }
 
-        // compact the old node and calibrate metadata
-        for (size_t i = 0; i < total_records; i++) {
-            if (picked[i])
-                continue;
+        return right_anchor;
+    }
 
-            for (size_t j = i; j < total_records; j++) {
-                if (picked[j]) {
-                    source_buffer->fingerprints[i] = source_buffer->fingerprints[j];
-                    memcpy(source_buffer->pairs[i].key, source_buffer->pairs[j].key,
-                           DataLayer::Constants::KEYLEN);
-                    memcpy(source_buffer->pairs[i].value, source_buffer->pairs[j].value,
-                           DataLayer::Constants::KEYLEN);
-                    picked[i] = true;
-                    picked[j] = false;
-                }
-            }
-        }
-        left->next = left_cap;
+    auto ComputeNode::inplace_split_node(LinkedNode16 *source_buffer, size_t left_cap)
+            -> std::tuple<LinkedNode16 *, LinkedNode16 *, std::string>
+    {
+        BufferNode tmp_node;
+        tmp_node.next = source_buffer->next;
+        memcpy(tmp_node.fingerprints, source_buffer->fingerprints, sizeof(source_buffer->fingerprints));
+        memcpy(tmp_node.pairs, source_buffer->pairs, sizeof(source_buffer->pairs));
+
+        auto left = source_buffer;
+        // we have sufficient buffer
+        auto right = left + 1;
 
+        auto right_anchor = split_sorted(tmp_node, left_cap, left, right);
         return {left, right, right_anchor};
     }
 
     auto ComputeNode::out_of_place_split_node(SkipListNode *data_node, LinkedNode16 *pred,
                                               LinkedNode16 *source_buffer,
                                               Concurrency::ConcurrencyContext *shared_ctx,
-                                              size_t left_cap, const std::string &key,
-                                              const std::string &value, bool done)
+                                              size_t left_cap, std::string_view key,
+                                              std::string_view value, bool done)
         -> std::tuple<LinkedNode16 *, LinkedNode16 *, std::string>
     {
         BufferNode tmp_node;
@@ -1015,59 +2438,27 @@ namespace DiStore::Cluster {
         //     req->succeed = tmp_node.store(*reinterpret_cast<const std::string *>(req->tag),
         //                                   *reinterpret_cast<const std::string *>(req->content));
         //     req->retry = false;
-        //     req->is_done = true;
+        //     req->finish();
         // }
 
-        int reorder_map[32] = {-1};
-        bool picked[32] = {false};
-
-        // construct_reorder_map(source_buffer, left_cap, reorder_map, picked);
-        construct_reorder_map(&tmp_node, left_cap, reorder_map, picked);
-        auto right_anchor = std::string((char *)tmp_node.pairs[reorder_map[left_cap]].key,
-                                        DataLayer::Constants::KEYLEN);
-        // left node should not take the anchor key of right node
-        picked[reorder_map[left_cap]] = false;
-
         auto left = source_buffer;
         auto right = source_buffer + 1;
 
-        left->next = 0;
-        right->next = 0;
-
-        for (size_t i = 0; i < tmp_node.next; i++) {
-            if (picked[i]) {
-                left->fingerprints[left->next] = tmp_node.fingerprints[i];
-                memcpy(&left->pairs[left->next], &tmp_node.pairs[i], sizeof(DataLayer::KV));
-                ++left->next;
-            } else {
-                right->fingerprints[right->next] = tmp_node.fingerprints[i];
-                memcpy(&right->pairs[right->next], &tmp_node.pairs[i], sizeof(DataLayer::KV));
-                ++right->next;
-            }
-        }
+        // left node should not take the anchor key of right node
+        auto right_anchor = split_sorted(tmp_node, left_cap, left, right);
 
         return {left, right, right_anchor};
     }
 
-    auto ComputeNode::async_update(SkipListNode *data_node, const std::string &anchor,
-                                   LinkedNodeType t, RemotePointer r)
+    auto ComputeNode::link_split_node(SkipListNode *data_node, const std::string &anchor,
+                                      LinkedNodeType t, RemotePointer r)
         -> void
     {
-        auto [new_node, level] = SkipList::make_new_node(anchor, r, t);
-
-        new_node->forwards[0] = data_node->forwards[0];
-        data_node->forwards[0] = new_node;
-        new_node->backward = data_node;
-
-        if (level == 1) {
-            return;
+        // data_node is locked, so the new node goes right after it
+        UNUSED(data_node);
+        if (!slist.insert(anchor, r, t)) {
+            Debug::error("Anchor %s of a split node already exists\n", anchor.c_str());
         }
-
-        auto req = new CalibrateContext;
-        req->level = level;
-        req->new_node = new_node;
-
-        update_queue.push(req);
     }
 
 
@@ -1083,8 +2474,8 @@ namespace DiStore::Cluster {
 
         auto walker = slist.iter();
 
-        while (walker->forwards[0]) {
-            walker = walker->forwards[0];
+        while (walker->next()) {
+            walker = walker->next();
             auto buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(walker->data_node,
                                                                            sizeof(LinkedNode16));
 
@@ -1098,8 +2489,8 @@ namespace DiStore::Cluster {
 
         auto walker = slist.iter();
 
-        while (walker->forwards[0]) {
-            walker = walker->forwards[0];
+        while (walker->next()) {
+            walker = walker->next();
             auto buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(walker->data_node,
                                                                            sizeof(LinkedNode16));
 
@@ -1118,11 +2509,11 @@ namespace DiStore::Cluster {
         Debug::info("Collecting stats via network, which will take some time\n");
         auto iter = slist.iter();
 
-        while(iter->forwards[0]) {
-            auto buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(iter->forwards[0]->data_node,
+        while(iter->next()) {
+            iter = iter->next();
+            auto buffer = remote_memory_allocator.fetch_as<LinkedNode16 *>(iter->data_node,
                                                                            sizeof(LinkedNode16));
             data_layer_stats[buffer->type].push_back(buffer->usage());
-            iter = iter->forwards[0];
         }
 
         auto total = 0.0;
@@ -8,14 +8,19 @@
 #include "erpc_wrapper/erpc_wrapper.hpp"
 #include "debug/debug.hpp"
 #include "search_layer/search_layer.hpp"
+#include "epoch/epoch.hpp"
 #include "data_layer/data_layer.hpp"
 #include "handover_locktable/handover_locktable.hpp"
 #include "stats/stats.hpp"
 #include "stats/breakdown/breakdown.hpp"
 #include "stats/operation/operation.hpp"
+#include "coroutine/coroutine.hpp"
+#include "cache/cache.hpp"
 #include <chrono>
+#include <functional>
 #include <infiniband/verbs.h>
 #include <ratio>
+#include <span>
 
 namespace DiStore::Cluster {
     using namespace RPCWrapper;
@@ -25,26 +30,265 @@ namespace DiStore::Cluster {
     namespace Constants {
         // 2 local nodes will form a well-formed doubly-linked list
         static constexpr int LOCAL_MAX_NODES = 2;
+        // a data node is folded into its predecessor once a removal drops its usage below this
+        static constexpr double MERGE_THRESHOLD = 0.3;
+        // data nodes a range iterator reads ahead by default
+        static constexpr size_t SCAN_DEPTH = 8;
+        // torn reads of a data node before it is read under its lock
+        static constexpr int OPTIMISTIC_READS = 4;
+        // pauses after the first torn read, doubled after each following one
+        static constexpr int READ_BACKOFF = 16;
+        // share of the slots of a data node that bulk_load fills by default
+        static constexpr double BULK_LOAD_FILL = 0.75;
+        // data nodes a bulk load writes per batch, two batches share the RDMA buffer
+        static constexpr size_t BULK_LOAD_BATCH = 32;
+
+        // segments of the data layer chain a recovering thread walks at once, each read
+        // into its own LinkedNode16 of the RDMA buffer
+        static constexpr size_t RECOVERY_DEPTH = 32;
+        // threads walking the chain while a recovery rebuilds the search layer
+        static constexpr size_t RECOVERY_THREADS = 4;
+
+        static_assert(2 * BULK_LOAD_BATCH * sizeof(LinkedNode16) <= Memory::Constants::RDMA_BUFFER_SIZE);
+        static_assert(2 * BULK_LOAD_BATCH <= RDMAUtil::Constants::MAX_QP_DEPTH);
+        static_assert(RECOVERY_DEPTH * sizeof(LinkedNode16) <= Memory::Constants::RDMA_BUFFER_SIZE);
+        static_assert(RECOVERY_DEPTH <= RDMAUtil::Constants::MAX_QP_DEPTH);
     }
 
-    struct CalibrateContext {
-        int level;
-        SkipListNode *new_node;
+    // succeed and the value found by a get
+    using AsyncCallback = std::function<void(bool, std::optional<std::string>)>;
+
+    /*
+     * Per-thread state of the async API. Slot i of the scheduler owns three LinkedNode16
+     * (predecessor, node and the right half of a split) of the async RDMA buffer.
+     *
+     * A put or an update locks data nodes with the slot's ConcurrencyContext, whose
+     * max_depth stays 0 so synchronous threads retry instead of handing requests over
+     * to a coroutine that can not help them
+     */
+    struct AsyncWindow {
+        std::unique_ptr<Coroutine::Scheduler> scheduler;
+        Concurrency::ConcurrencyContext locks[Memory::Constants::ASYNC_WINDOW];
+
+        AsyncWindow() {
+            for (auto &c : locks) {
+                c.max_depth = 0;
+            }
+        }
+    };
+
+    /*
+     * What a thread registers with a compute node. Operations taking the handle use it
+     * as is, the others reach it through a thread-local pointer instead of looking the
+     * thread id up, and handles of different threads never share a cache line
+     */
+    struct alignas(64) WorkerHandle {
+        Concurrency::ConcurrencyContext cctx;
+        AsyncWindow window;
+        // RDMA contexts of the thread, one of each kind per memory node
+        Memory::ThreadRDMA *rdma;
+        // slab caches of the thread in the compute node's allocator, one per memory node
+        Memory::SlabCache *slabs;
+        // what operations taking the handle record into
+        Stats::Breakdown breakdown;
+    };
+
+    /*
+     * A bulk load in progress, see ComputeNode::bulk_load. While the data nodes of one half
+     * of the RDMA buffer are being written, those of the other half are packed
+     */
+    struct BulkLoad {
+        SearchLayer::SkipList::AppendCursor cursor;
+        LinkedNode16 *images;
+        Memory::Transfer transfers[2][Constants::BULK_LOAD_BATCH];
+        Anchor anchors[2][Constants::BULK_LOAD_BATCH];
+        Memory::PostedBatch posted[2];
+        size_t count[2];
+        bool outstanding[2];
+        int half;
+
+        // the data node being packed and its remote address, nullptr before the first pair
+        LinkedNode16 *node;
+        RemotePointer remote;
+        Anchor last;
+        uint32_t slots;
+        size_t loaded;
+    };
+
+    // a part of the data layer chain from one of its starts up to the next start
+    struct RecoverySegment {
+        RemotePointer start;
+        // data nodes holding pairs, each with the anchor of its smallest key
+        std::vector<std::tuple<Anchor, RemotePointer, LinkedNodeType>> nodes;
+        // index of the segment this one runs into, -1 at the end of the chain
+        int64_t next = -1;
+        // a torn or unknown data node is met
+        bool broken = false;
+        // nodes, next and broken are final once it is set
+        std::atomic<bool> done = false;
+    };
+
+    /*
+     * A recovery in progress, see ComputeNode::recover. Segment 0 starts at the first data
+     * node and the others at the samples of the last checkpoint
+     */
+    struct RecoveryWalk {
+        std::unique_ptr<RecoverySegment[]> segments;
+        size_t count;
+        std::unordered_map<RemotePointer, int64_t, RemotePointer::RemotePointerHasher> starts;
+        // segments not reached from the first one may be walked forever
+        std::atomic<bool> stop = false;
+    };
+
+    class ComputeNode;
+
+    /*
+     * Pairs of a compute node with keys in [start, end) in ascending key order, an empty
+     * end is unbounded.
+     *
+     * Data nodes are read along the bottom level of the skip list in windows of depth
+     * nodes, each window posted as one batch over the scan contexts of current thread.
+     * Once a window arrives, its nodes are sorted into pairs and the next window is posted
+     * right away, so depth reads are in flight while the caller consumes the pairs.
+     *
+     * An iterator belongs to the thread creating it, which stays inside an epoch until the
+     * iterator is destroyed, and a thread keeps at most one iterator at a time. Keys come
+     * out strictly increasing, while pairs written meanwhile may or may not be seen. A
+     * node split or merged after its window was posted is read again, so pairs present
+     * for the whole iteration are never skipped
+     */
+    class RangeIterator {
+    public:
+        RangeIterator(ComputeNode &node, WorkerHandle &worker, std::string_view start,
+                      std::string_view end, size_t depth, size_t limit,
+                      Stats::Breakdown *breakdown = nullptr);
+        RangeIterator(const RangeIterator &) = delete;
+        RangeIterator(RangeIterator &&) = delete;
+        auto operator=(const RangeIterator &) = delete;
+        auto operator=(RangeIterator &&) = delete;
+        ~RangeIterator();
+
+        // false once the range is exhausted
+        inline auto valid() const noexcept -> bool {
+            return pos < pairs.size();
+        }
+
+        inline auto key() const noexcept -> std::string_view {
+            return {(const char *)pairs[pos].key, DataLayer::Constants::KEYLEN};
+        }
+
+        inline auto value() const noexcept -> std::string_view {
+            return {(const char *)pairs[pos].value, DataLayer::Constants::VALLEN};
+        }
+
+        auto next() -> void;
+
+    private:
+        ComputeNode &owner;
+        WorkerHandle &worker;
+        Stats::Breakdown *breakdown;
+        Epoch::Guard guard;
+        std::string start;
+        std::string end;
+        size_t depth;
+        // pairs the caller still wants, windows are sized by it and no more are posted once
+        // it drops to zero
+        size_t limit;
+
+        // pairs of the last window that arrived
+        std::vector<KV> pairs;
+        size_t pos;
+        // the largest key so far, a stale read of a node split meanwhile repeats keys
+        std::string last;
+
+        // the first node of the next window, nullptr once the range is covered
+        SkipListNode *cursor;
+        // nodes of the outstanding window by buffer slot and the types they are read as
+        SkipListNode *window[Memory::Constants::MAX_SCAN_DEPTH];
+        LinkedNodeType types[Memory::Constants::MAX_SCAN_DEPTH];
+        size_t in_flight;
+        Memory::PostedBatch batch;
+
+        auto post_window() -> void;
+        // wait for the outstanding window and sort its nodes into pairs, up to the first
+        // node whose image is torn or stale, where the next window starts
+        auto receive_window() -> void;
+        // point cursor at the node holding key
+        auto seek(std::string_view key) -> void;
+        // keep advancing until a pair is available or the range is exhausted
+        auto fill() -> void;
+
+        template <typename Node>
+        auto collect(const Node &n) -> void {
+            uint8_t perm[DataLayer::Constants::SORT_WIDTH];
+            auto filled = n.sorted_slots(perm);
+
+            for (uint32_t i = 0; i < filled; i++) {
+                auto &p = n.pairs[perm[i]];
+                auto k = std::string_view((const char *)p.key, DataLayer::Constants::KEYLEN);
+                if (!end.empty() && k >= end)
+                    break;
+
+                if (k < start || (!last.empty() && k <= last))
+                    continue;
+
+                last = k;
+                pairs.push_back(p);
+                limit -= std::min<size_t>(limit, 1);
+            }
+        }
     };
 
     class ComputeNode {
+        friend class RangeIterator;
     public:
-        static auto make_compute_node(const std::string &compute_config, const std::string &memory_config)
+        // with recover, the search layer is rebuilt from the data layer left on the memory
+        // nodes instead of starting empty, see recover
+        static auto make_compute_node(const std::string &compute_config, const std::string &memory_config,
+                                      bool recover = false)
             -> std::unique_ptr<ComputeNode>
         {
             auto ret = std::make_unique<ComputeNode>();
-            if (!ret->initialize(compute_config, memory_config)) {
+            if (!ret->initialize(compute_config, memory_config, recover)) {
                 Debug::error("Failed to initialize compute node\n");
                 return nullptr;
             }
 
             return ret;
         }
+
+        /*
+         * A compute node whose memory nodes are emulated in-process, see
+         * RemoteMemoryManager::setup_loopback. No NIC, eRPC or config file is needed,
+         * which makes the store runnable on any machine for testing and profiling
+         * @mem_cap: bytes of each emulated memory node, at least one segment
+         * @latency: nanoseconds injected into each RDMA completion
+         * @nodes: number of emulated memory nodes
+         */
+        static auto make_loopback_compute_node(size_t mem_cap, uint64_t latency = 0, int nodes = 1)
+            -> std::unique_ptr<ComputeNode>
+        {
+            auto ret = std::make_unique<ComputeNode>();
+            if (!ret->initialize_loopback(mem_cap, latency, nodes)) {
+                Debug::error("Failed to initialize loopback compute node\n");
+                return nullptr;
+            }
+
+            return ret;
+        }
+
+        // a compute node recovered from the emulated memory nodes of crashed, which must
+        // not run any operation from now on
+        static auto recover_loopback_compute_node(ComputeNode &crashed) -> std::unique_ptr<ComputeNode> {
+            auto ret = std::make_unique<ComputeNode>();
+            if (!ret->initialize_loopback(crashed)) {
+                Debug::error("Failed to recover loopback compute node\n");
+                return nullptr;
+            }
+
+            return ret;
+        }
+
         /*
          * format of compute_config
          * #       tcp            roce         erpc
@@ -53,24 +297,124 @@ namespace DiStore::Cluster {
          * rdma_port: 1
          * gid_idx: 4
          */
-        auto initialize(const std::string &compute_config, const std::string &memory_config) -> bool;
+        auto initialize(const std::string &compute_config, const std::string &memory_config,
+                        bool recover = false) -> bool;
+        auto initialize_loopback(size_t mem_cap, uint64_t latency, int nodes = 1) -> bool;
+        auto initialize_loopback(ComputeNode &crashed) -> bool;
 
         auto connect_memory_nodes() -> bool;
 
-        // must call this register_thread before threads actually do some stuff
-        auto register_thread() -> bool;
+        // must call this register_thread before threads actually do some stuff, a thread
+        // registering again gets the same handle. nullptr on failure
+        auto register_thread() -> WorkerHandle *;
 
-        auto put(const std::string &key, const std::string &value, Stats::Breakdown *breakdown)
+        auto put(std::string_view key, std::string_view value, Stats::Breakdown *breakdown)
             -> bool;
-        auto get(const std::string &key, Stats::Breakdown *breakdown) -> std::optional<std::string>;
-        auto update(const std::string &key, const std::string &value, Stats::Breakdown *breakdown)
+        auto get(std::string_view key, Stats::Breakdown *breakdown) -> std::optional<std::string>;
+        // copy the value into a caller's buffer of VALLEN bytes instead, no allocation is made
+        auto get(std::string_view key, byte_ptr_t value, Stats::Breakdown *breakdown) -> bool;
+        // ret[i] is the value of keys[i]. Every distinct data node is read once and reads
+        // are batched with one doorbell per memory node
+        auto multi_get(std::span<const std::string> keys, Stats::Breakdown *breakdown)
+            -> std::vector<std::optional<std::string>>;
+        auto update(std::string_view key, std::string_view value, Stats::Breakdown *breakdown)
             -> bool;
-        auto remove(const std::string &key, Stats::Breakdown *breakdown) -> bool;
-        auto scan(const std::string &key, size_t count, Stats::Breakdown *breakdown) -> uint64_t;
+        auto remove(std::string_view key, Stats::Breakdown *breakdown) -> bool;
+        auto scan(std::string_view key, size_t count, Stats::Breakdown *breakdown) -> uint64_t;
+        // values are copied back to back into values, which holds count * VALLEN bytes
+        auto scan(std::string_view key, size_t count, byte_ptr_t values, Stats::Breakdown *breakdown)
+            -> uint64_t;
+        // see RangeIterator, depth is at most MAX_SCAN_DEPTH. No more data nodes are read
+        // once limit pairs have arrived, so at least limit pairs are yielded if there are
+        auto range(std::string_view start, std::string_view end = {},
+                   size_t depth = Constants::SCAN_DEPTH, size_t limit = SIZE_MAX)
+            -> RangeIterator;
+
+        /*
+         * The same operations over the handle register_thread returned to the calling
+         * thread, so nothing is looked up per operation. Stats go to worker.breakdown
+         */
+        auto put(WorkerHandle &worker, std::string_view key, std::string_view value) -> bool;
+        auto get(WorkerHandle &worker, std::string_view key) -> std::optional<std::string>;
+        auto get(WorkerHandle &worker, std::string_view key, byte_ptr_t value) -> bool;
+        auto multi_get(WorkerHandle &worker, std::span<const std::string> keys)
+            -> std::vector<std::optional<std::string>>;
+        auto update(WorkerHandle &worker, std::string_view key, std::string_view value) -> bool;
+        auto remove(WorkerHandle &worker, std::string_view key) -> bool;
+        auto scan(WorkerHandle &worker, std::string_view key, size_t count, byte_ptr_t values = nullptr)
+            -> uint64_t;
+        auto range(WorkerHandle &worker, std::string_view start, std::string_view end = {},
+                   size_t depth = Constants::SCAN_DEPTH, size_t limit = SIZE_MAX)
+            -> RangeIterator;
+
+        /*
+         * Coroutine versions of the operations above. They must be driven by the calling
+         * thread's scheduler, i.e., co_awaited by a task given to spawn_async or by another
+         * such coroutine. Combining with peers is not done, a busy data node is retried
+         * after yielding instead
+         */
+        auto co_get(std::string key) -> Coroutine::Task<std::optional<std::string>>;
+        auto co_put(std::string key, std::string value) -> Coroutine::Task<bool>;
+        auto co_update(std::string key, std::string value) -> Coroutine::Task<bool>;
+        auto co_scan(std::string key, size_t count) -> Coroutine::Task<uint64_t>;
+
+        // run task on current thread's scheduler, it progresses in poll_async
+        auto spawn_async(Coroutine::Task<void> task) -> void;
+
+        /*
+         * Callback-based operations on top of the coroutines. Each registered thread keeps
+         * up to ASYNC_WINDOW of them in flight, and callbacks are invoked by the submitting
+         * thread from poll_async (or right away if the data is still kept locally)
+         */
+        auto async_get(const std::string &key, AsyncCallback callback) -> void;
+        auto async_put(const std::string &key, const std::string &value, AsyncCallback callback)
+            -> void;
+        auto async_update(const std::string &key, const std::string &value, AsyncCallback callback)
+            -> void;
+        // progress in-flight operations, return the number of completed ones
+        auto poll_async() -> size_t;
+        // poll until all submitted operations complete
+        auto wait_async() -> void;
+
+        /*
+         * Load pairs in strictly ascending key order into a compute node that no pair has
+         * been put into, while no other operation runs. *first is a pair of a key and a
+         * value, both convertible to std::string_view.
+         *
+         * Pairs are packed into LinkedNode16 filled to fill of their slots, and the data
+         * nodes are written in batches of BULK_LOAD_BATCH with a doorbell per memory node
+         * while the next batch is packed. Each written batch is appended to the skip list
+         * bottom-up. On failure the pairs before the failing one stay loaded
+         */
+        template<typename Iter>
+        auto bulk_load(Iter first, Iter last, double fill = Constants::BULK_LOAD_FILL) -> bool {
+            BulkLoad load;
+            if (!begin_bulk_load(load, fill))
+                return false;
+
+            for (; first != last; ++first) {
+                const auto &[key, value] = *first;
+                if (!bulk_load_pair(load, key, value)) {
+                    end_bulk_load(load);
+                    return false;
+                }
+            }
+            return end_bulk_load(load);
+        }
+
+        /*
+         * Sample up to SUPERBLOCK_SAMPLES data nodes evenly along the bottom level of the
+         * skip list into the superblock. A recovery walks the chain between samples in
+         * parallel, and samples split, merged or freed since are skipped by it, so
+         * checkpointing now and then after the data layer grows is enough. Done at the
+         * end of bulk_load too
+         */
+        auto checkpoint() -> bool;
 
         // always return non-null pointer as long as remote memory is not depleted
         auto allocate(size_t size) -> RemotePointer;
-        // preallocate one segment;
+        auto allocate(WorkerHandle &worker, size_t size) -> RemotePointer;
+        // preallocate one segment of every memory node;
         auto preallocate() -> bool;
         auto free(RemotePointer p) -> void;
 
@@ -84,22 +428,35 @@ namespace DiStore::Cluster {
         auto report_data_layer_stats() -> void;
 
         ComputeNode() = default;
+        // chunks retired by the node are freed first, no thread may use it meanwhile
+        ~ComputeNode();
         ComputeNode(const ComputeNode &) = delete;
         ComputeNode(ComputeNode &&) = delete;
         auto operator=(const ComputeNode &) = delete;
         auto operator=(ComputeNode &&) = delete;
     private:
         SearchLayer::SkipList slist;
+        Cache::NodeCache node_cache;
 
         ComputeNodeInfo self_info;
         ClientRPCContext compute_ctx;
-        Memory::ComputeNodeAllocator allocator;
         Memory::RemoteMemoryManager remote_memory_allocator;
+        // its prefetcher fetches segments via remote_memory_allocator, destroy it first
+        Memory::ComputeNodeAllocator allocator;
         std::unique_ptr<RDMADevice> rdma_dev;
 
-        std::unordered_map<std::thread::id, std::unique_ptr<Concurrency::ConcurrencyContext>> cctx;
+        // handles of every registered thread, only touched under local_mutex
+        std::unordered_map<std::thread::id, std::unique_ptr<WorkerHandle>> workers;
+        // tells compute nodes apart in the thread-local lookup of handles
+        uint64_t id = next_id();
+        struct LocalWorker {
+            uint64_t owner;
+            WorkerHandle *handle;
+        };
+        static inline thread_local LocalWorker bound = {0, nullptr};
 
-        tbb::concurrent_queue<CalibrateContext *> update_queue;
+        // the data layer was left by a crashed compute node, whose chunks are not freed
+        bool recovered = false;
 
         // nodes are kept locally if total number of nodes is fewer than LOCAL_MAX_NODES
         bool remote_put;
@@ -165,43 +522,105 @@ namespace DiStore::Cluster {
             return true;
         }
 
-        auto drain_pending() -> void;
-        auto quick_put(const std::string &key, const std::string &value) -> bool;
-        auto quick_put_pick_node(const std::string &key) -> DataLayer::LinkedNode10 *;
+        // set up the search layer and local nodes once remote memory is reachable
+        auto initialize_layers(bool recover) -> bool;
+
+        // write the image of the head, whose rlink is first
+        auto link_head(RemotePointer first) -> bool;
 
-        auto put_dispatcher(SkipListNode *data_node, const std::string &key,
-                            const std::string &value, Stats::Breakdown *breakdown)
+        /*
+         * Rebuild the search layer from the superblock. The chain is cut at the samples into
+         * segments, which RECOVERY_THREADS walkers read RECOVERY_DEPTH at a time with one
+         * doorbell per memory node, while this thread appends the segments in chain order
+         * as they complete. Segments of samples no longer in the chain are never reached
+         * and thrown away
+         */
+        auto recover() -> bool;
+        // walk segments first, first + step, ... of walk until they are done or walk stops
+        auto walk_segments(RecoveryWalk &walk, size_t first, size_t step) -> void;
+        // record the data node image n read from addr into seg, the next address to read or
+        // nullptr once seg is done
+        auto recover_node(RecoveryWalk &walk, RecoverySegment &seg, RemotePointer addr,
+                          const LinkedNode16 *n) -> RemotePointer;
+
+        // the operations taking a handle, recording into a breakdown of the caller's choice
+        auto put(WorkerHandle &worker, std::string_view key, std::string_view value,
+                 Stats::Breakdown *breakdown)
+            -> bool;
+        auto get(WorkerHandle &worker, std::string_view key, Stats::Breakdown *breakdown)
+            -> std::optional<std::string>;
+        auto get(WorkerHandle &worker, std::string_view key, byte_ptr_t value,
+                 Stats::Breakdown *breakdown)
             -> bool;
-        auto put10(SkipListNode *data_node, const std::string &key, const std::string &value,
-                   Stats::Breakdown *breakdown)
+        auto multi_get(WorkerHandle &worker, std::span<const std::string> keys,
+                       Stats::Breakdown *breakdown)
+            -> std::vector<std::optional<std::string>>;
+        auto update(WorkerHandle &worker, std::string_view key, std::string_view value,
+                    Stats::Breakdown *breakdown)
+            -> bool;
+        auto remove(WorkerHandle &worker, std::string_view key, Stats::Breakdown *breakdown) -> bool;
+        auto scan(WorkerHandle &worker, std::string_view key, size_t count, byte_ptr_t values,
+                  Stats::Breakdown *breakdown)
+            -> uint64_t;
+
+        auto drain_pending(WorkerHandle &worker) -> void;
+
+        /*
+         * Fetch an intact image of the data node of node to the head of the RDMA buffer.
+         * A torn read is retried after an exponential backoff, and once
+         * Constants::OPTIMISTIC_READS of them fail the reader competes for the node's lock
+         * like a writer, and reads it while holding the lock. nullptr is returned if node
+         * is split, morphed or merged meanwhile, after which the caller searches again
+         */
+        auto read_node(WorkerHandle &worker, SkipListNode *node, Stats::Breakdown *breakdown)
+            -> LinkedNode16 *;
+        auto quick_put(std::string_view key, std::string_view value) -> bool;
+        auto quick_put_pick_node(std::string_view key) -> DataLayer::LinkedNode10 *;
+
+        auto put_dispatcher(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                            std::string_view value, Stats::Breakdown *breakdown)
+            -> bool;
+        auto put10(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                   std::string_view value, Stats::Breakdown *breakdown)
             -> std::pair<bool, bool>;
-        auto put12(SkipListNode *data_node, const std::string &key, const std::string &value,
-                   Stats::Breakdown *breakdown)
+        auto put12(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                   std::string_view value, Stats::Breakdown *breakdown)
             -> std::pair<bool, bool>;
-        auto put14(SkipListNode *data_node, const std::string &key, const std::string &value,
-                   Stats::Breakdown *breakdown)
+        auto put14(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                   std::string_view value, Stats::Breakdown *breakdown)
             -> std::pair<bool, bool>;
-        auto put16(SkipListNode *data_node, const std::string &key, const std::string &value,
-                   Stats::Breakdown *breakdown)
+        auto put16(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                   std::string_view value, Stats::Breakdown *breakdown)
             -> std::pair<bool, bool>;
 
 
+        // key is not moved to a node after node by a split, which holds until node is unlocked
+        // if it is locked
+        static inline auto covers(SkipListNode *node, std::string_view key) noexcept -> bool {
+            auto succ = node->next();
+            return !succ || Anchor::make_anchor(key) < succ->anchor;
+        }
+
+        // image n of node links to the data node now following node. It does not for an
+        // image read before node was split or merged, or before its successor changed, and
+        // briefly for one read after a split is written back but before it is linked
+        static inline auto links_next(SkipListNode *node, const LinkedNode16 *n) noexcept -> bool {
+            auto succ = node->next();
+            return !node->is_removed() && n->rlink == (succ ? succ->data_node : RemotePointer(nullptr));
+        }
+
         // try to win the put and fetch remote memory to local
         // pair[0], win the competition
-        // pair[1], pointer to winner's ConcurrencyContext
+        // pair[1], pointer to winner's ConcurrencyContext, nullptr if data_node no longer
+        //          holds key, which is not checked for an empty key
         template<typename NodeType>
-        auto try_win_for_update(SkipListNode *data_node, Concurrency::ConcurrencyContextType t,
-                                Stats::Breakdown *breakdown)
+        auto try_win_for_update(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                                Concurrency::ConcurrencyContextType t, Stats::Breakdown *breakdown)
             -> std::pair<bool, Concurrency::ConcurrencyContext *>
         {
 
-            auto thread_cctx = cctx.find(std::this_thread::get_id());
-            if (thread_cctx == cctx.end()) {
-                throw std::runtime_error("Threads should always register before running\n");
-            }
-
             Concurrency::ConcurrencyContext *expect = nullptr;
-            auto shared_ctx = thread_cctx->second.get();
+            auto shared_ctx = &worker.cctx;
 
             // context is not usable until the predecessor is also locked
             shared_ctx->type = t;
@@ -209,24 +628,29 @@ namespace DiStore::Cluster {
             auto r = data_node;
 
             if (r->ctx.compare_exchange_strong(expect, shared_ctx)) {
-                // the spinning threads can now submit requests
-                shared_ctx->max_depth = 4;
+                // a merged node is unlinked before being unlocked, its data is in the predecessor
+                if (r->is_removed() || (!key.empty() && !covers(r, key))) {
+                    shared_ctx->max_depth = 0;
+                    r->ctx = nullptr;
+                    return {false, nullptr};
+                }
+
+                // the spinning threads can now submit requests, readers take none
+                open_combining(shared_ctx, r, t == Concurrency::ConcurrencyContextType::Read);
 
                 // the only winner should remember to collect pending requests
                 // first process winner's own request
                 NodeType *buffer;
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
-                    buffer = remote_memory_allocator.fetch_as<NodeType *>(data_node->data_node,
-                                                                          sizeof(NodeType));
+                    buffer = worker.rdma->fetch_as<NodeType *>(data_node->data_node, sizeof(NodeType));
 
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
                 } else {
-                    buffer = remote_memory_allocator.fetch_as<NodeType *>(data_node->data_node,
-                                                                          sizeof(NodeType));
+                    buffer = worker.rdma->fetch_as<NodeType *>(data_node->data_node, sizeof(NodeType));
                 }
+                // requests keep coming until the winner closes the window to serve them
                 shared_ctx->user_context = buffer;
-                shared_ctx->max_depth = -1;
 
                 return {true, shared_ctx};
             }
@@ -235,24 +659,19 @@ namespace DiStore::Cluster {
         }
 
         template<typename NodeType>
-        auto try_win_for_insert(SkipListNode *data_node, Concurrency::ConcurrencyContextType t,
-                     Stats::Breakdown *breakdown)
+        auto try_win_for_insert(WorkerHandle &worker, SkipListNode *data_node, std::string_view key,
+                                Concurrency::ConcurrencyContextType t, Stats::Breakdown *breakdown)
             -> std::pair<bool, Concurrency::ConcurrencyContext *>
         {
-            auto thread_cctx = cctx.find(std::this_thread::get_id());
-            if (thread_cctx == cctx.end()) {
-                throw std::runtime_error("Threads should always register before running\n");
-            }
-
             Concurrency::ConcurrencyContext *expect = nullptr;
-            auto shared_ctx = thread_cctx->second.get();
+            auto shared_ctx = &worker.cctx;
 
             // context is not usable until the predecessor is also locked
             shared_ctx->max_depth = -1;
             shared_ctx->type = t;
 
             auto r = data_node;
-            auto l = data_node->backward;
+            auto l = data_node->backward.load();
 
             if (r->ctx.compare_exchange_strong(expect, shared_ctx)) {
                 if (!l->ctx.compare_exchange_strong(expect, shared_ctx)) {
@@ -260,8 +679,19 @@ namespace DiStore::Cluster {
                     r->ctx = nullptr;
                     return {false, nullptr};
                 }
+
+                // l is no longer the predecessor if it was split before being locked, and
+                // neither of them is usable once merged. A split of r may move key away too,
+                // and a morph or a split of r leaves it of another type than dispatched
+                if (l->next() != r || l->is_removed() || r->is_removed() || !covers(r, key) ||
+                    r->type != NodeType::node_type) {
+                    shared_ctx->max_depth = 0;
+                    l->ctx = nullptr;
+                    r->ctx = nullptr;
+                    return {false, nullptr};
+                }
                 // the spinning threads can now submit requests
-                shared_ctx->max_depth = 4;
+                open_combining(shared_ctx, r, false);
 
                 // the only winner should remember to collect pending requests
                 // first process winner's own request
@@ -270,32 +700,18 @@ namespace DiStore::Cluster {
                     // We stored the real node in the second LinkedNode16, the first is reserved for
                     // updating the predecessor's RLink after morphing or splitting
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerFetch);
-                    // buffer = remote_memory_allocator.fetch_as<NodeType *>(data_node->data_node,
-                    //                                                       sizeof(NodeType),
-                    //                                                       sizeof(LinkedNode16));
-                    // no idea why fetch_two is so slow
-                    // buffer = fetch_two(l, r).first;
-
-                    // we have only one MN, so the following code should work
-                    // Fuck Mellanox that I have to use TWO contexts for authentic parallel read
-                    auto rdma = remote_memory_allocator.get_rdma(l->data_node);
-                    auto prdma = remote_memory_allocator.get_parallel_rdma(l->data_node);
-                    rdma->post_read(r->data_node.get_as<byte_ptr_t>(), sizeof_node(r->type), sizeof(LinkedNode16));
-                    prdma->post_read(l->data_node.get_as<byte_ptr_t>(), sizeof_node(l->type));
-                    rdma->poll_one_completion();
-                    prdma->poll_one_completion();
-                    buffer = reinterpret_cast<LinkedNode16 *>(rdma->get_edible_buf());
+                    // l and r may live on different memory nodes, their reads proceed in parallel
+                    buffer = fetch_two(worker, l, r).first;
 
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerFetch);
                 } else {
                     // buffer = remote_memory_allocator.fetch_as<NodeType *>(data_node->data_node,
                     //                                                       sizeof(NodeType),
                     //                                                       sizeof(LinkedNode16));
-                    buffer = fetch_two(l, r).first;
+                    buffer = fetch_two(worker, l, r).first;
                 }
 
                 shared_ctx->user_context = buffer;
-                shared_ctx->max_depth = -1;
 
                 return {true, shared_ctx};
             }
@@ -303,8 +719,8 @@ namespace DiStore::Cluster {
             return {false, expect};
         }
 
-        auto help_pred(LinkedNode16 *buf, const std::string &k,
-                       const std::string &v)
+        auto help_pred(LinkedNode16 *buf, std::string_view k,
+                       std::string_view v)
             -> bool
         {
             switch (buf->type) {
@@ -331,57 +747,62 @@ namespace DiStore::Cluster {
             -> void
         {
             Concurrency::ConcurrencyRequests *req = nullptr;
-            const std::string *k = nullptr;
-            const std::string *v = nullptr;
+            const std::string_view *k = nullptr;
+            const std::string_view *v = nullptr;
             bool s = false;
-            while (shared_ctx->requests.try_pop(req)) {
-                k = reinterpret_cast<const std::string *>(req->tag);
-                v = reinterpret_cast<const std::string *>(req->content);
+            while ((req = next_request(shared_ctx, data_node))) {
+                k = reinterpret_cast<const std::string_view *>(req->tag);
+                v = reinterpret_cast<const std::string_view *>(req->content);
 
-                if (*k < data_node->anchor) {
+                if (Anchor::make_anchor(*k) < data_node->anchor) {
                     s = help_pred(pred_buffer, *k, *v);
                     req->succeed = s;
                     req->retry = !s;
-                    req->is_done = true;
+                    req->finish();
                 } else {
                     s = real_buffer->store(*k, *v);
                     if (!s) {
-                        shared_ctx->requests.push(req);
+                        shared_ctx->requests.unpop();
                         break;
                     }
                     req->succeed = s;
                     req->retry = false;
-                    req->is_done = true;
+                    req->finish();
                 }
             }
         }
         // pair[0], whether current key-value is put
         // pair[1], toal number of all pending requests including current key-value
         template<typename NodeType>
-        auto try_put_to_existing_node(Concurrency::ConcurrencyContext *shared_ctx, SkipListNode *data_node,
-                                      const std::string &key, const std::string &value,
-                                      Stats::Breakdown *breakdown)
+        auto try_put_to_existing_node(WorkerHandle &worker, Concurrency::ConcurrencyContext *shared_ctx,
+                                      SkipListNode *data_node, std::string_view key,
+                                      std::string_view value, Stats::Breakdown *breakdown)
             -> std::pair<bool, size_t>
         {
 
+            close_combining(shared_ctx, data_node, breakdown);
+
             auto pred_buffer = reinterpret_cast<LinkedNode16 *>(shared_ctx->user_context);
             auto real_buffer = reinterpret_cast<NodeType *>(pred_buffer + 1);
             if (!real_buffer->store(key, value)) {
                 // current key-value is not put
-                return {false, shared_ctx->requests.unsafe_size() + 1};
+                return {false, shared_ctx->requests.size() + 1};
             }
 
             help_others(shared_ctx, data_node, pred_buffer, real_buffer);
 
-            if (shared_ctx->requests.unsafe_size() == 0) {
+            if (shared_ctx->requests.size() == 0) {
+                // store has patched crc, readers retry on a stale one until the write lands
+                real_buffer->seal();
                 bool ret = false;
                 if (breakdown) {
                     breakdown->begin(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
-                    ret = remote_memory_allocator.write_back_current(data_node->data_node, sizeof(NodeType));
+                    ret = worker.rdma->write_back_current(data_node->data_node, sizeof(NodeType));
                     breakdown->end(Stats::DiStoreBreakdownOps::DataLayerWriteBack);
                 } else {
-                    ret = remote_memory_allocator.write_back_current(data_node->data_node, sizeof(NodeType));
+                    ret = worker.rdma->write_back_current(data_node->data_node, sizeof(NodeType));
                 }
+                invalidate_cached(data_node->data_node);
                 if(ret) {
                     return {true, 0};
                 } else {
@@ -389,20 +810,15 @@ namespace DiStore::Cluster {
                     return {false, 0};
                 }
             }
-            return {true, shared_ctx->requests.unsafe_size()};
+            return {true, shared_ctx->requests.size()};
 
         }
 
         // find out the true type of a LinkedNode
         template<typename NodeType>
         auto morph_node(NodeType *buffer) -> LinkedNodeType {
-            auto buf = reinterpret_cast<LinkedNode16 *>(buffer);
-            auto ct = 0;
-            for (int i = 0; i < 16; i++) {
-                if (buf->fingerprints[i] != 0) {
-                    ++ct;
-                }
-            }
+            // a key may well hash to a zero fingerprint, so empty slots are not told by it
+            auto ct = reinterpret_cast<LinkedNode16 *>(buffer)->next;
 
             if (ct <= 10) {
                 return LinkedNodeType::Type10;
@@ -417,45 +833,59 @@ namespace DiStore::Cluster {
             }
         }
 
-        auto failed_write(Concurrency::ConcurrencyContext *cctx, const std::string &key,
-                          const std::string &value, Stats::Breakdown *breakdown)
-            -> std::pair<bool, bool>;
+        // the type of a split half of count pairs, t unless t is too small. Requests combined
+        // beyond the default depth may leave up to 21 pairs to split, see BufferNode
+        static inline auto fit_type(LinkedNodeType t, uint32_t count) noexcept -> LinkedNodeType {
+            return capacity_of(t) >= count ? t : static_cast<LinkedNodeType>(count + count % 2);
+        }
 
-        auto eager_morph(SkipListNode *data_node, LinkedNode16 *real,
-                         Concurrency::ConcurrencyContext *shared_ctx,
-                         const std::string &key, const std::string &value, bool done)
-            -> bool;
+        // submit the request to the winner of data_node, whose context is cctx
+        auto failed_write(Concurrency::ConcurrencyContext *cctx, SkipListNode *data_node,
+                          std::string_view key, std::string_view value, Stats::Breakdown *breakdown)
+            -> std::pair<bool, bool>;
 
-        template<typename NodeType>
-        auto construct_reorder_map(NodeType *source_buffer, int left_cap,
-                                   int *reorder_map, bool *picked) -> void
+        inline auto open_combining(Concurrency::ConcurrencyContext *ctx, SkipListNode *node, bool closed)
+            noexcept -> void
         {
-            auto total_records = source_buffer->next;
-            // int result = 0;
-            // pick one more key as right's anchor key
-            int target = 0;
-            for (int i = 0; i < left_cap + 1; i++) {
-                for (int j = 0; j < total_records; j++) {
-                    if (!picked[j]) {
-                        target = j;
-                        break;
-                    }
-                }
+            ctx->granted = closed ? 0 : node->combining.load(std::memory_order_relaxed);
+            ctx->max_depth = ctx->granted;
+        }
 
-                for (int j = 0; j < total_records; j++) {
-                    if (picked[j])
-                        continue;
+        /*
+         * Stop taking requests for node and wait for those accepted to be queued, so that
+         * none is left behind once the winner leaves. A node whose waiters fill the window
+         * doubles its depth while one of few waiters shrinks it step by step, and a winner
+         * granting more than the default first waits up to
+         * Concurrency::Constants::COMBINING_WINDOW pauses for the window to fill
+         */
+        auto close_combining(Concurrency::ConcurrencyContext *ctx, SkipListNode *node,
+                             Stats::Breakdown *breakdown) -> void;
 
-                    if (memcmp(source_buffer->pairs[target].key, source_buffer->pairs[j].key,
-                               DataLayer::Constants::KEYLEN) > 0) {
-                        target = j;
-                    }
-                }
+        // the next queued request for node, those for a node the context locked earlier or
+        // for keys moved away by a split are told to retry
+        auto next_request(Concurrency::ConcurrencyContext *ctx, SkipListNode *node)
+            -> Concurrency::ConcurrencyRequests *;
 
-                picked[target] = true;
-                reorder_map[i] = target;
-            }
-        }
+        /*
+         * Fold the data node of node, whose image is in buffer, into the predecessor's.
+         * The predecessor is locked with shared_ctx only if it is free, and false is returned
+         * if it is busy, is the head or has no room left. On success the node is unlinked
+         * from the search layer and its remote chunk is freed, while the caller still holds
+         * its lock
+         */
+        auto try_merge(WorkerHandle &worker, SkipListNode *node, LinkedNode16 *buffer,
+                       Concurrency::ConcurrencyContext *shared_ctx, Stats::Breakdown *breakdown)
+            -> bool;
+
+        auto eager_morph(WorkerHandle &worker, SkipListNode *data_node, LinkedNode16 *real,
+                         Concurrency::ConcurrencyContext *shared_ctx,
+                         std::string_view key, std::string_view value, bool done)
+            -> bool;
+
+        // distribute the pairs of source in one pass over their sorted order, the smallest
+        // left_cap go to left and the rest to right, return the anchor of right
+        static auto split_sorted(const BufferNode &source, size_t left_cap,
+                                 LinkedNode16 *left, LinkedNode16 *right) -> std::string;
 
         // the splitted node is still large enough to hold the remaining pairs
         auto inplace_split_node(LinkedNode16 *source_buffer, size_t left_cap)
@@ -464,199 +894,145 @@ namespace DiStore::Cluster {
         auto out_of_place_split_node(SkipListNode *data_node, LinkedNode16 *pred,
                                      LinkedNode16 *source_buffer,
                                      Concurrency::ConcurrencyContext *shared_ctx,
-                                     size_t left_cap, const std::string &key,
-                                     const std::string &value, bool done)
+                                     size_t left_cap, std::string_view key,
+                                     std::string_view value, bool done)
             -> std::tuple<LinkedNode16 *, LinkedNode16 *, std::string>;
 
         // return the address of newly allocated right
-        auto write_back_morphed(SkipListNode *data_node, LinkedNode16 *pred,
-                                 LinkedNode16 *morphed)
+        auto write_back_morphed(WorkerHandle &worker, SkipListNode *data_node, LinkedNode16 *pred,
+                                LinkedNode16 *morphed)
             -> RemotePointer
         {
-            auto r = allocate(DataLayer::sizeof_node(morphed->type));
-            auto rdma = remote_memory_allocator.get_rdma(r);
+            auto r = allocate(worker, DataLayer::sizeof_node(morphed->type));
             pred->rlink = r;
-
-            auto p_sge = rdma->generate_sge(nullptr, DataLayer::sizeof_node(pred->type), 0);
-            auto r_sge = rdma->generate_sge(nullptr, DataLayer::sizeof_node(morphed->type),
-                                            sizeof(LinkedNode16));
-
-            auto wr_p = rdma->generate_send_wr(0, p_sge.get(), 1,
-                                               data_node->backward->data_node.get_as<byte_ptr_t>(),
-                                               nullptr);
-            auto wr_r = rdma->generate_send_wr(1, r_sge.get(), 1, r.get_as<byte_ptr_t>(), nullptr);
-            wr_p->send_flags = 0;
-            wr_p->next = wr_r.get();
-
-            rdma->post_batch_write(wr_p.get());
-
-            if (auto [wc, _] = rdma->poll_one_completion(); wc != nullptr) {
-                // data_node->data_node = l;
+            pred->seal();
+            morphed->seal();
+
+            // pred and the morphed node may live on different memory nodes
+            Transfer transfers[] = {
+                {data_node->backward.load()->data_node, DataLayer::sizeof_node(pred->type), 0},
+                {r, DataLayer::sizeof_node(morphed->type), sizeof(LinkedNode16)},
+            };
+
+            auto ok = worker.rdma->transfer_batch(IBV_WR_RDMA_WRITE, transfers, 2);
+            invalidate_cached(data_node->backward.load()->data_node);
+            invalidate_cached(data_node->data_node);
+            if (!ok) {
                 return nullptr;
             }
 
+            retire(data_node->data_node);
             data_node->data_node = r;
             return r;
         }
 
-        template<typename LNodeType, typename RNodeType>
-        auto write_back_splitted(SkipListNode *data_node, LinkedNode16 *pred,
+        // each half is written as large as its type, see fit_type
+        auto write_back_splitted(WorkerHandle &worker, SkipListNode *data_node, LinkedNode16 *pred,
                                  LinkedNode16 *left, LinkedNode16 *right)
             -> RemotePointer
         {
-            auto l = allocate(sizeof(LNodeType));
-            auto r = allocate(sizeof(RNodeType));
+            auto l = allocate(worker, DataLayer::sizeof_node(left->type));
+            auto r = allocate(worker, DataLayer::sizeof_node(right->type));
 
             // actually we do not need a doubly-linked strucutre, the data layer is just like a
             // level in the blink tree.
             pred->rlink = l;
             right->rlink = left->rlink;
             left->rlink = r;
-
-            // for implementation simplicity, we assume only one MN``
-            auto rdma = remote_memory_allocator.get_rdma(l);
-            auto p_sge = rdma->generate_sge(nullptr, DataLayer::sizeof_node(pred->type), 0);
-            auto l_sge = rdma->generate_sge(nullptr, sizeof(LNodeType), sizeof(LinkedNode16));
-            auto r_sge = rdma->generate_sge(nullptr, sizeof(RNodeType), 2 * sizeof(LinkedNode16));
-
-            auto wr_p = rdma->generate_send_wr(0, p_sge.get(), 1,
-                                               data_node->backward->data_node.get_as<byte_ptr_t>(),
-                                               nullptr);
-            auto wr_l = rdma->generate_send_wr(1, l_sge.get(), 1, l.get_as<byte_ptr_t>(), nullptr);
-            auto wr_r = rdma->generate_send_wr(2, r_sge.get(), 1, r.get_as<byte_ptr_t>(), nullptr);
-
-            wr_p->send_flags = 0;
-            wr_p->next = wr_l.get();
-            wr_l->send_flags = 0;
-            wr_l->next = wr_r.get();
-
-            rdma->post_batch_write(wr_p.get());
-
-            if (auto [wc, _] = rdma->poll_one_completion(); wc != nullptr) {
-                // data_node->data_node = l;
+            pred->seal();
+            left->seal();
+            right->seal();
+
+            // the halves are placed round robin, so the three writes fan out to up to three MNs
+            Transfer transfers[] = {
+                {data_node->backward.load()->data_node, DataLayer::sizeof_node(pred->type), 0},
+                {l, DataLayer::sizeof_node(left->type), sizeof(LinkedNode16)},
+                {r, DataLayer::sizeof_node(right->type), 2 * sizeof(LinkedNode16)},
+            };
+
+            auto ok = worker.rdma->transfer_batch(IBV_WR_RDMA_WRITE, transfers, 3);
+            invalidate_cached(data_node->backward.load()->data_node);
+            invalidate_cached(data_node->data_node);
+            if (!ok) {
                 return nullptr;
             }
 
+            retire(data_node->data_node);
             data_node->data_node = l;
             return r;
         }
 
-        auto fetch_two(SkipListNode *left, SkipListNode *right)
+        auto fetch_two(WorkerHandle &worker, SkipListNode *left, SkipListNode *right)
             -> std::pair<LinkedNode16 *, LinkedNode16 *>
         {
-            auto rdma = remote_memory_allocator.get_rdma(left->data_node);
-
-            // auto l_sge = rdma->generate_sge(nullptr, sizeof_node(left->type), 0);
-            // auto r_sge = rdma->generate_sge(nullptr, sizeof_node(right->type), sizeof(LinkedNode16));
-            //
-            // auto wr_l = rdma->generate_send_wr(0, l_sge.get(), 1, left->data_node.get_as<byte_ptr_t>(),
-            //                                    nullptr, IBV_WR_RDMA_READ);
-            // auto wr_r = rdma->generate_send_wr(0, r_sge.get(), 1, right->data_node.get_as<byte_ptr_t>(),
-            //                                    nullptr, IBV_WR_RDMA_READ);
-
-            // wr_l->send_flags = 0;
-            // wr_l->next = wr_r.get();
-            //
-            // rdma->post_batch_read(wr_l.get());
-            // if (auto [wc, _] = rdma->poll_one_completion(); wc != nullptr) {
-            //     return {nullptr, nullptr};
-            // }
-            //
-
-            auto bps = std::chrono::steady_clock::now();
-            rdma->post_read(right->data_node.get_as<byte_ptr_t>(), sizeof_node(right->type), sizeof(LinkedNode16));
-            rdma->post_read(left->data_node.get_as<byte_ptr_t>(), sizeof_node(left->type));
-            auto bpe = std::chrono::steady_clock::now();
-            std::cout << "batch post takes " << std::chrono::duration_cast<std::chrono::microseconds>(bpe - bps).count() << "\n";
-            
-            auto fs = std::chrono::steady_clock::now();
-            rdma->poll_one_completion();
-            auto fe = std::chrono::steady_clock::now();
-            auto ss = std::chrono::steady_clock::now();
-            rdma->poll_one_completion();
-            auto se = std::chrono::steady_clock::now();
-             
-            std::cout << "First poll takes " << std::chrono::duration_cast<std::chrono::microseconds>(fe - fs).count() << "\n";
-            std::cout << "Second poll takes " << std::chrono::duration_cast<std::chrono::microseconds>(se - ss).count() << "\n";
-
-            auto buf = reinterpret_cast<LinkedNode16 *>(rdma->get_edible_buf());
+            Transfer transfers[] = {
+                {left->data_node, sizeof_node(left->type), 0},
+                {right->data_node, sizeof_node(right->type), sizeof(LinkedNode16)},
+            };
+
+            auto batch = worker.rdma->post_batch(IBV_WR_RDMA_READ, transfers, 2);
+            if (!worker.rdma->wait_batch(batch)) {
+                return {nullptr, nullptr};
+            }
 
+            // every context of a thread shares the same RDMA buffer
+            auto buf = reinterpret_cast<LinkedNode16 *>(batch.ctxs[0]->get_edible_buf());
             return {buf, buf + 1};
         }
 
+        // hand p back to the allocator once no reader in an earlier epoch may fetch it
+        auto retire(RemotePointer p) -> void;
+        static auto reclaim_chunk(void *chunk, void *self) -> void;
 
-
-        auto fetch_two_into_buffer(SkipListNode *left, SkipListNode *right,
-                                   LinkedNode16 *l, LinkedNode16 *r)
-            -> bool
-        {
-            auto [lb, rb] = fetch_two(left, right);
-
-            if (!lb || !rb) {
-                return false;
-            }
-
-            if (l) {
-                memcpy(l, lb, sizeof(LinkedNode16));
-            }
-
-            if (r) {
-                memcpy(r, rb, sizeof(LinkedNode16));
-            }
-
-            return true;
+        // called after writing a data node back
+        inline auto invalidate_cached(const RemotePointer &p) noexcept -> void {
+#ifdef __NODE_CACHE__
+            node_cache.invalidate(p);
+#else
+            UNUSED(p);
+#endif
         }
 
-        /*
-         *
-         * This method tries to fetch two data node from remote memory with batched requests
-         * without waiting the completion
-         *
-         * The caller obtained the return value from this method own the RDMAContext and this
-         * context is reserved for the batched requests posted from this method. No more
-         * requests should be posted via this context before the polling, otherwise the RDMA
-         * buffer would corrupt
-         */
-        auto fetch_two_async(SkipListNode *left, SkipListNode *right) -> RDMAContext * {
-            auto rdma = remote_memory_allocator.get_rdma(left->data_node);
-
-            auto l_sge = rdma->generate_sge(nullptr, sizeof_node(left->type), 0);
-            auto r_sge = rdma->generate_sge(nullptr, sizeof_node(right->type), sizeof(LinkedNode16));
-
-            auto wr_l = rdma->generate_send_wr(0, l_sge.get(), 1, left->data_node.get_as<byte_ptr_t>(),
-                                               nullptr, IBV_WR_RDMA_READ);
-            auto wr_r = rdma->generate_send_wr(0, l_sge.get(), 1, right->data_node.get_as<byte_ptr_t>(),
-                                               nullptr, IBV_WR_RDMA_READ);
-
-            wr_l->send_flags = 0;
-            wr_l->next = wr_r.get();
-
-            rdma->post_batch_read(wr_l.get());
-
-            return rdma;
-        }
+        // look key up in the cached image of p, return false on a miss
+        auto cached_find(WorkerHandle &worker, const RemotePointer &p, std::string_view key,
+                         byte_ptr_t value, bool &found)
+            -> bool;
 
-        /*
-         * This method polls the RDMAContext obtained from fet_two_async. The return values are
-         * two pointers pointing the the underlying RDMA buffer of the RDMAContext. To reuse the
-         * RDMA buffer while reserving the content in the buffer, please copy the content to other
-         * places
-         */
-        auto poll_fetch_two_async(RDMAContext *rdma, LinkedNode16 &l, LinkedNode16 &r) -> bool {
-            if (auto [wc, _] = rdma->poll_one_completion(); wc != nullptr) {
-                return false;
+        // link the right half of a split node after data_node in the search layer
+        auto link_split_node(SkipListNode *data_node, const std::string &anchor,
+                             LinkedNodeType t, RemotePointer r) -> void;
+
+        auto begin_bulk_load(BulkLoad &load, double fill) -> bool;
+        auto bulk_load_pair(BulkLoad &load, std::string_view key, std::string_view value) -> bool;
+        // link and seal the data node being packed and queue it in the current batch
+        auto commit_bulk_node(BulkLoad &load, RemotePointer next) -> bool;
+        // post the current batch, then wait for the other one and append it to the skip list
+        auto flush_bulk_batch(BulkLoad &load) -> bool;
+        auto link_bulk_batch(BulkLoad &load, int half) -> bool;
+        auto end_bulk_load(BulkLoad &load) -> bool;
+
+        // handle of current thread, which must have registered
+        inline auto current_worker() -> WorkerHandle * {
+            if (bound.owner == id)
+                return bound.handle;
+
+            auto handle = bind_worker();
+            if (!handle) {
+                throw std::runtime_error("Threads should always register before running\n");
             }
-
-            auto buf = reinterpret_cast<const LinkedNode16 *>(rdma->get_buf());
-            memcpy(&l, buf, sizeof(LinkedNode16));
-            memcpy(&r, buf + 1, sizeof(LinkedNode16));
-
-            return true;
+            return handle;
         }
+        // look current thread up under local_mutex and remember its handle, nullptr if
+        // it has not registered
+        auto bind_worker() -> WorkerHandle *;
+        static auto next_id() -> uint64_t;
 
-
-        auto async_update(SkipListNode *data_node, const std::string &anchor,
-                          LinkedNodeType t, RemotePointer r) -> void;
+        inline auto get_async_window() -> AsyncWindow * {
+            return &current_worker()->window;
+        }
+        // release the locks of a put or an update taken with the slot's context
+        auto unlock_async(AsyncWindow *window, int slot, SkipListNode *node, SkipListNode *pred)
+            -> void;
     };
 }
 #endif
@@ -1,5 +1,7 @@
 #include "rdma_util.hpp"
+#include <algorithm>
 #include <chrono>
+#include <sys/mman.h>
 namespace DiStore::RDMAUtil {
     auto decode_rdma_status(const Enums::Status& status) -> std::string {
         switch(status){
@@ -41,6 +43,8 @@ namespace DiStore::RDMAUtil {
             return "ReadError";
         case Enums::Status::WriteError:
             return "WriteError";
+        case Enums::Status::CannotMapLoopback:
+            return "CannotMapLoopback";
         default:
             return "Unknown status";
         }
@@ -130,6 +134,11 @@ namespace DiStore::RDMAUtil {
             memcpy(byte_buf, msg, msg_len);
         }
 
+        if (is_loopback()) {
+            return loopback_transfer(0, opcode, reinterpret_cast<uint64_t>(byte_buf),
+                                     remote.addr + remote_offset, msg_len, true);
+        }
+
         memset(&sg, 0, sizeof(sg));
         sg.addr	  = reinterpret_cast<uint64_t>(byte_buf);
         sg.length = msg_len;
@@ -230,7 +239,8 @@ namespace DiStore::RDMAUtil {
         auto s = std::make_unique<struct ibv_sge>();
         s->addr = uint64_t(addr);
         s->length = msg_len;
-        s->lkey = mr->lkey;
+        // loopback contexts have no memory region registered
+        s->lkey = mr ? mr->lkey : 0;
         return s;
     }
 
@@ -251,9 +261,34 @@ namespace DiStore::RDMAUtil {
         return wr;
     }
 
+    auto RDMAContext::next_send_wr(uint64_t wr_id, size_t msg_len, size_t local_offset,
+                                   const byte_ptr_t remote_ptr, enum ibv_wr_opcode opcode) noexcept
+        -> struct ibv_send_wr *
+    {
+        auto slot = wr_pool_next++ % Constants::WR_POOL_SIZE;
+        auto &sge = sge_pool[slot];
+        auto &wr = wr_pool[slot];
+
+        sge.addr = reinterpret_cast<uint64_t>(buf) + local_offset;
+        sge.length = msg_len;
+        sge.lkey = mr ? mr->lkey : 0;
+
+        wr.wr_id = wr_id;
+        wr.next = nullptr;
+        wr.opcode = opcode;
+        wr.send_flags = IBV_SEND_SIGNALED;
+        wr.wr.rdma.remote_addr = reinterpret_cast<uint64_t>(remote_ptr);
+        wr.wr.rdma.rkey = remote.rkey;
+        return &wr;
+    }
+
     auto RDMAContext::post_batch_write(struct ibv_send_wr *wrs) -> StatusPair {
         struct ibv_send_wr *bad_wr;
 
+        if (is_loopback()) {
+            return loopback_post(wrs);
+        }
+
         if (auto ret = ibv_post_send(qp, wrs, &bad_wr); ret != 0) {
             Debug::error("posting wr %d failed, error code: %d\n", bad_wr->wr_id, ret);
             return std::make_pair(Enums::Status::WriteError, ret);
@@ -265,6 +300,10 @@ namespace DiStore::RDMAUtil {
     auto RDMAContext::post_batch_read(struct ibv_send_wr *wrs) -> StatusPair {
         struct ibv_send_wr *bad_wr;
 
+        if (is_loopback()) {
+            return loopback_post(wrs);
+        }
+
         if (auto ret = ibv_post_send(qp, wrs, &bad_wr); ret != 0) {
             Debug::error("posting wr %d failed, error code: %d\n", bad_wr->wr_id, ret);
             return std::make_pair(Enums::Status::ReadError, ret);
@@ -309,41 +348,53 @@ namespace DiStore::RDMAUtil {
 
     auto RDMAContext::poll_completion_once(bool send) noexcept -> int {
         struct ibv_wc wc;
-        auto cq = send ? out_cq : in_cq;
 
+        if (is_loopback()) {
+            return loopback_poll(&wc, 1, false);
+        }
+
+        auto cq = send ? out_cq : in_cq;
         return ibv_poll_cq(cq, 1, &wc);
     }
 
     auto RDMAContext::poll_one_completion(bool send) noexcept
-        -> std::pair<std::unique_ptr<struct ibv_wc>, int>
+        -> std::pair<struct ibv_wc *, int>
     {
-        auto wc = std::make_unique<struct ibv_wc>();
-        int ret;
-        auto cq = send ? out_cq : in_cq;
-        do {
-            ret = ibv_poll_cq(cq, 1, wc.get());
-        } while (ret == 0);
-
-        if (ret > 0)
-            return {nullptr, ret};
-
-        return {std::move(wc), ret};
+        return poll_multiple_completions(1, send);
     }
 
     auto RDMAContext::poll_multiple_completions(size_t no, bool send) noexcept
-        -> std::pair<std::unique_ptr<struct ibv_wc[]>, int>
+        -> std::pair<struct ibv_wc *, int>
     {
-        auto wc = std::make_unique<struct ibv_wc[]>(no);
+        auto wc = wc_pool;
         int ret;
+
+        no = std::min(no, Constants::WR_POOL_SIZE);
+        if (is_loopback()) {
+            ret = loopback_poll(wc, no, true);
+            if (ret > 0)
+                return {nullptr, ret};
+            return {wc, ret};
+        }
+
         auto cq = send ? out_cq : in_cq;
         do {
-            ret = ibv_poll_cq(cq, no, wc.get());
+            ret = ibv_poll_cq(cq, no, wc);
         } while (ret == 0);
 
         if (ret > 0)
             return {nullptr, ret};
 
-        return {std::move(wc), ret};
+        return {wc, ret};
+    }
+
+    auto RDMAContext::poll_completions(struct ibv_wc *wcs, size_t no, bool send) noexcept -> int {
+        if (is_loopback()) {
+            return loopback_poll(wcs, no, false);
+        }
+
+        auto cq = send ? out_cq : in_cq;
+        return ibv_poll_cq(cq, no, wcs);
     }
 
     auto RDMAContext::fill_buf(uint8_t *msg, size_t msg_len, size_t offset)
@@ -354,6 +405,154 @@ namespace DiStore::RDMAUtil {
         return (byte_ptr_t)buf + offset;
     }
 
+    auto RDMAContext::make_loopback_context(void *membuf, size_t memsize,
+                                            const_byte_ptr_t region_base, size_t region_size,
+                                            uint64_t latency)
+        -> std::unique_ptr<RDMAContext>
+    {
+        auto ctx = make_rdma_context();
+        ctx->transport = Transport::Loopback;
+        ctx->injected_latency = latency;
+        ctx->buf = membuf;
+        ctx->local.addr = reinterpret_cast<uint64_t>(membuf);
+        ctx->remote.addr = reinterpret_cast<uint64_t>(region_base);
+        ctx->loopback_local_end = ctx->local.addr + memsize;
+        ctx->loopback_remote_end = ctx->remote.addr + region_size;
+        ctx->loopback_head = ctx->loopback_tail = 0;
+        return ctx;
+    }
+
+    auto RDMAContext::loopback_transfer(uint64_t wr_id, enum ibv_wr_opcode opcode,
+                                        uint64_t local_addr, uint64_t remote_addr, size_t len,
+                                        bool signaled)
+        -> StatusPair
+    {
+        auto status = IBV_WC_SUCCESS;
+        auto wc_opcode = IBV_WC_RDMA_WRITE;
+        auto local_ptr = reinterpret_cast<byte_ptr_t>(local_addr);
+        auto remote_ptr = reinterpret_cast<byte_ptr_t>(remote_addr);
+
+        if (local_addr < local.addr || local_addr + len > loopback_local_end) {
+            Debug::error("Loopback access to local buffer out of range (%p, %lu)\n", local_ptr, len);
+            status = IBV_WC_LOC_PROT_ERR;
+        } else if (remote_addr < remote.addr || remote_addr + len > loopback_remote_end) {
+            Debug::error("Loopback access to remote region out of range (%p, %lu)\n", remote_ptr, len);
+            status = IBV_WC_REM_ACCESS_ERR;
+        } else {
+            switch (opcode) {
+            case IBV_WR_RDMA_READ:
+                memcpy(local_ptr, remote_ptr, len);
+                wc_opcode = IBV_WC_RDMA_READ;
+                break;
+            case IBV_WR_RDMA_WRITE:
+                memcpy(remote_ptr, local_ptr, len);
+                break;
+            default:
+                // two-sided verbs have no peer to talk to
+                return {Status::PostFailed, EINVAL};
+            }
+        }
+
+        if (!signaled && status == IBV_WC_SUCCESS) {
+            return {Status::Ok, 0};
+        }
+
+        if (loopback_tail - loopback_head == Constants::LOOPBACK_CQ_DEPTH) {
+            Debug::error("Loopback completion queue overflows\n");
+            return {Status::PostFailed, ENOMEM};
+        }
+
+        auto &c = loopback_cq[(loopback_tail++) % Constants::LOOPBACK_CQ_DEPTH];
+        memset(&c.wc, 0, sizeof(c.wc));
+        c.wc.wr_id = wr_id;
+        c.wc.status = status;
+        c.wc.opcode = wc_opcode;
+        c.wc.byte_len = len;
+        c.ready_at = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() + injected_latency;
+        return {Status::Ok, 0};
+    }
+
+    auto RDMAContext::loopback_post(struct ibv_send_wr *wrs) -> StatusPair {
+        for (auto wr = wrs; wr != nullptr; wr = wr->next) {
+            auto remote_addr = wr->wr.rdma.remote_addr;
+            for (int i = 0; i < wr->num_sge; i++) {
+                auto &sge = wr->sg_list[i];
+                // only the last scatter entry of a signaled wr generates a completion
+                auto signaled = (wr->send_flags & IBV_SEND_SIGNALED) && i == wr->num_sge - 1;
+                auto [status, err] = loopback_transfer(wr->wr_id, wr->opcode, sge.addr, remote_addr,
+                                                       sge.length, signaled);
+                if (status != Status::Ok) {
+                    Debug::error("posting wr %d failed, error code: %d\n", wr->wr_id, err);
+                    return {status, err};
+                }
+                remote_addr += sge.length;
+            }
+        }
+
+        return {Status::Ok, 0};
+    }
+
+    auto RDMAContext::loopback_poll(struct ibv_wc *wc, size_t no, bool block) -> int {
+        size_t polled = 0;
+
+        do {
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            // completions of an RC qp are delivered in order
+            while (polled < no && loopback_head != loopback_tail) {
+                auto &c = loopback_cq[loopback_head % Constants::LOOPBACK_CQ_DEPTH];
+                if (c.ready_at > uint64_t(now))
+                    break;
+
+                wc[polled++] = c.wc;
+                ++loopback_head;
+            }
+        } while (block && polled == 0 && loopback_head != loopback_tail);
+
+        if (block && polled == 0) {
+            // a real cq would spin forever here
+            Debug::error("Polling a loopback context without outstanding requests\n");
+            memset(wc, 0, sizeof(struct ibv_wc));
+            wc->status = IBV_WC_GENERAL_ERR;
+            return -1;
+        }
+
+        return polled;
+    }
+
+    auto LoopbackRegion::make_loopback_region(size_t size)
+        -> std::pair<std::unique_ptr<LoopbackRegion>, Status>
+    {
+        auto region = std::make_unique<LoopbackRegion>();
+
+        region->fd = memfd_create("distore-loopback", MFD_CLOEXEC);
+        if (region->fd == -1) {
+            return {nullptr, Status::CannotMapLoopback};
+        }
+
+        if (ftruncate(region->fd, size) != 0) {
+            return {nullptr, Status::CannotMapLoopback};
+        }
+
+        // pages are populated lazily, so a large sparse region is cheap
+        auto mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE,
+                        region->fd, 0);
+        if (mem == MAP_FAILED) {
+            return {nullptr, Status::CannotMapLoopback};
+        }
+
+        region->base = reinterpret_cast<byte_ptr_t>(mem);
+        region->size = size;
+        return {std::move(region), Status::Ok};
+    }
+
+    LoopbackRegion::~LoopbackRegion() {
+        if (base) munmap(base, size);
+        if (fd != -1) close(fd);
+    }
+
 
     auto RDMADevice::open(void *membuf, size_t memsize, size_t cqe, int mr_access,
                           struct ibv_qp_init_attr &attr)
@@ -452,7 +651,7 @@ namespace DiStore::RDMAUtil {
         attr->path_mtu = IBV_MTU_256;
         attr->dest_qp_num = remote.qp_num;
         attr->rq_psn = 0;
-        attr->max_dest_rd_atomic = 1;
+        attr->max_dest_rd_atomic = Constants::MAX_RD_ATOMIC;
         attr->min_rnr_timer = 0x12;
 
         attr->ah_attr.is_global = 0;
@@ -484,7 +683,7 @@ namespace DiStore::RDMAUtil {
         attr->retry_cnt = 6;
         attr->rnr_retry = 0;
         attr->sq_psn = 0;
-        attr->max_rd_atomic = 1;
+        attr->max_rd_atomic = Constants::MAX_RD_ATOMIC;
         return attr;
     }
 }
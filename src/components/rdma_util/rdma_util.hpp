@@ -8,6 +8,7 @@
 #include <functional>
 #include <iostream>
 #include <cstring>
+#include <chrono>
 
 #include <infiniband/verbs.h>
 #include <byteswap.h>
@@ -48,7 +49,14 @@ namespace DiStore::RDMAUtil {
     } __attribute__((packed));
 
     namespace Constants {
-        static constexpr uint32_t MAX_QP_DEPTH = 8;
+        // deep enough for a doorbell batch of reads, see RemoteMemoryManager::fetch_batch
+        static constexpr uint32_t MAX_QP_DEPTH = 64;
+        // outstanding RDMA reads per qp, 1 would serialize a batch into one RTT per read
+        static constexpr uint8_t MAX_RD_ATOMIC = 16;
+        // capacity of the emulated completion queue of a loopback context
+        static constexpr size_t LOOPBACK_CQ_DEPTH = 64;
+        // preformatted wrs of a context, no chain posted at once is longer than a qp
+        static constexpr size_t WR_POOL_SIZE = MAX_QP_DEPTH;
     }
 
     namespace Enums {
@@ -74,12 +82,46 @@ namespace DiStore::RDMAUtil {
             WriteError,
             PostFailed,
             RecvFailed,
+            CannotMapLoopback,
+        };
+
+        // how an RDMAContext moves bytes to and from the remote region
+        enum class Transport {
+            RDMA,
+            Loopback,
         };
     }
     using namespace Enums;
     using StatusPair = std::pair<Enums::Status, int>;
     auto decode_rdma_status(const Enums::Status& status) -> std::string;
 
+    /*
+     * In-process stand-in of a memory node's registered memory region. The region is
+     * backed by a memfd so that it stays shareable with a cooperating process, while
+     * RDMAContexts in loopback mode access it directly with memcpy. This allows the
+     * whole data layer to run on machines without an RDMA NIC.
+     */
+    struct LoopbackRegion {
+        int fd;
+        byte_ptr_t base;
+        size_t size;
+
+        static auto make_loopback_region(size_t size) -> std::pair<std::unique_ptr<LoopbackRegion>, Status>;
+
+        LoopbackRegion() : fd(-1), base(nullptr), size(0) {};
+        ~LoopbackRegion();
+        LoopbackRegion(const LoopbackRegion &) = delete;
+        LoopbackRegion(LoopbackRegion &&) = delete;
+        auto operator=(const LoopbackRegion &) = delete;
+        auto operator=(LoopbackRegion &&) = delete;
+    };
+
+    // a completion generated by a loopback context, visible once ready_at is reached
+    struct LoopbackCompletion {
+        struct ibv_wc wc;
+        uint64_t ready_at;
+    };
+
     class RDMADevice;
     // Aggregation of pointers to ibv_context, ibv_pd, ibv_cq, ibv_mr and ibv_qp, which are used for further operations
     struct RDMAContext {
@@ -93,6 +135,22 @@ namespace DiStore::RDMAUtil {
         void *buf;
         RDMADevice *device;
 
+        // loopback transport states, only valid if transport == Transport::Loopback
+        Transport transport;
+        uint64_t injected_latency;
+        uint64_t loopback_local_end;
+        uint64_t loopback_remote_end;
+        LoopbackCompletion loopback_cq[Constants::LOOPBACK_CQ_DEPTH];
+        size_t loopback_head;
+        size_t loopback_tail;
+
+        // ring of preformatted wrs handed out by next_send_wr, and completions returned by
+        // poll_one_completion and poll_multiple_completions, so no verb allocates
+        struct ibv_send_wr wr_pool[Constants::WR_POOL_SIZE];
+        struct ibv_sge sge_pool[Constants::WR_POOL_SIZE];
+        struct ibv_wc wc_pool[Constants::WR_POOL_SIZE];
+        size_t wr_pool_next;
+
         auto post_send_helper(const uint8_t *msg, size_t msg_len, enum ibv_wr_opcode opcode, size_t local_offset,
                               size_t remote_offset) -> StatusPair;
         auto post_send_helper(const byte_ptr_t &ptr, const uint8_t *msg, size_t msg_len, enum ibv_wr_opcode opcode,
@@ -108,9 +166,29 @@ namespace DiStore::RDMAUtil {
         inline static auto make_rdma_context() -> std::unique_ptr<RDMAContext> {
             auto ret = std::make_unique<RDMAContext>();
             memset(ret.get(), 0, sizeof(RDMAContext));
+            for (size_t i = 0; i < Constants::WR_POOL_SIZE; i++) {
+                ret->wr_pool[i].sg_list = &ret->sge_pool[i];
+                ret->wr_pool[i].num_sge = 1;
+            }
             return ret;
         }
 
+        /*
+         * Make a context that emulates one-sided verbs against an in-process region.
+         * @membuf: local buffer, the counterpart of the registered memory of a real context
+         * @memsize: local buffer size
+         * @region_base: start of the emulated remote memory, i.e., remote.addr
+         * @region_size: size of the emulated remote memory
+         * @latency: nanoseconds injected before a completion becomes visible
+         */
+        static auto make_loopback_context(void *membuf, size_t memsize, const_byte_ptr_t region_base,
+                                          size_t region_size, uint64_t latency = 0)
+            -> std::unique_ptr<RDMAContext>;
+
+        inline auto is_loopback() const noexcept -> bool {
+            return transport == Transport::Loopback;
+        }
+
         ~RDMAContext() {
             if (qp) ibv_destroy_qp(qp);
             if (mr) ibv_dereg_mr(mr);
@@ -162,6 +240,18 @@ namespace DiStore::RDMAUtil {
                               enum ibv_wr_opcode opcode = IBV_WR_RDMA_WRITE)
             -> std::unique_ptr<struct ibv_send_wr>;
 
+        /*
+         * Take the next wr of the ring, with its single sge covering msg_len bytes at
+         * local_offset of the buffer. As generate_send_wr, send_flag is IBV_SEND_SIGNALED and
+         * next is nullptr.
+         *
+         * A wr is free to reuse once posted, and the ring wraps after WR_POOL_SIZE wrs, so
+         * post a chain before taking more than WR_POOL_SIZE wrs since its head
+         */
+        auto next_send_wr(uint64_t wr_id, size_t msg_len, size_t local_offset, const byte_ptr_t remote,
+                          enum ibv_wr_opcode opcode = IBV_WR_RDMA_WRITE) noexcept
+            -> struct ibv_send_wr *;
+
         auto post_batch_write(struct ibv_send_wr *wrs) -> StatusPair;
         auto post_batch_read(struct ibv_send_wr *wrs) -> StatusPair;
         auto post_batch_write_test() -> void;
@@ -170,12 +260,17 @@ namespace DiStore::RDMAUtil {
          * A set of poll_completion functions.
          * poll_completion_once(): just to check if a completion is generated
          * poll_one_completion(): poll if one completion is generated and return a ibv_wc struct or an error
+         * poll_multiple_completions(): poll at most min(no, WR_POOL_SIZE) completions
+         *
+         * The returned ibv_wc lives in this context and is overwritten by the next poll
          */
         auto poll_completion_once(bool send = true) noexcept -> int;
         auto poll_one_completion(bool send = true) noexcept
-            -> std::pair<std::unique_ptr<struct ibv_wc>, int>;
+            -> std::pair<struct ibv_wc *, int>;
         auto poll_multiple_completions(size_t no, bool send = true) noexcept
-            -> std::pair<std::unique_ptr<struct ibv_wc[]>, int>;
+            -> std::pair<struct ibv_wc *, int>;
+        // non-blocking, fill at most no completions into wcs and return the number polled
+        auto poll_completions(struct ibv_wc *wcs, size_t no, bool send = true) noexcept -> int;
 
         // return the address of the start of the write location
         auto fill_buf(uint8_t *msg, size_t msg_len, size_t offset = 0) -> byte_ptr_t;
@@ -191,6 +286,13 @@ namespace DiStore::RDMAUtil {
         inline auto get_byte_buf() const noexcept -> const_byte_ptr_t {
             return reinterpret_cast<byte_ptr_t>(buf);
         }
+
+    private:
+        // copy between local buffer and emulated remote memory and queue a completion
+        auto loopback_transfer(uint64_t wr_id, enum ibv_wr_opcode opcode, uint64_t local_addr,
+                               uint64_t remote_addr, size_t len, bool signaled) -> StatusPair;
+        auto loopback_post(struct ibv_send_wr *wrs) -> StatusPair;
+        auto loopback_poll(struct ibv_wc *wc, size_t no, bool block) -> int;
     };
 
     /*
@@ -0,0 +1,69 @@
+#ifndef __DISTORE__SEARCH_LAYER__ANCHOR__ANCHOR__
+#define __DISTORE__SEARCH_LAYER__ANCHOR__ANCHOR__
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <endian.h>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace DiStore::SearchLayer {
+    namespace Constants {
+        static constexpr size_t ANCHOR_SIZE = 16;
+    }
+
+    /*
+     * An anchor key kept inline as two words in big-endian byte order, so comparing two
+     * anchors takes two integer comparisons instead of a string compare. Shorter keys are
+     * padded with zeros, which keeps the order of strings without NUL bytes
+     */
+    struct Anchor {
+        uint64_t hi;
+        uint64_t lo;
+
+        static auto make_anchor(std::string_view k) noexcept -> Anchor {
+            uint8_t bytes[Constants::ANCHOR_SIZE] = {0};
+            memcpy(bytes, k.data(), std::min(k.size(), Constants::ANCHOR_SIZE));
+
+            uint64_t h, l;
+            memcpy(&h, bytes, sizeof(h));
+            memcpy(&l, bytes + sizeof(h), sizeof(l));
+            return {be64toh(h), be64toh(l)};
+        }
+
+        static constexpr auto max() noexcept -> Anchor {
+            return {UINT64_MAX, UINT64_MAX};
+        }
+
+        // the key bytes without padding
+        auto to_string() const -> std::string {
+            uint64_t words[2] = {htobe64(hi), htobe64(lo)};
+            auto bytes = reinterpret_cast<const char *>(words);
+            return std::string(bytes, strnlen(bytes, Constants::ANCHOR_SIZE));
+        }
+
+        // the largest anchor smaller than this one, false if this is the smallest one
+        auto prev(Anchor &out) const noexcept -> bool {
+            if (lo != 0) {
+                out = {hi, lo - 1};
+                return true;
+            }
+
+            if (hi != 0) {
+                out = {hi - 1, UINT64_MAX};
+                return true;
+            }
+
+            return false;
+        }
+
+        auto operator<=>(const Anchor &rhs) const noexcept = default;
+    };
+
+    inline auto operator<<(std::ostream &os, const Anchor &anchor) -> std::ostream & {
+        return os << anchor.to_string();
+    }
+}
+#endif
@@ -0,0 +1,401 @@
+#include "btree.hpp"
+
+#include <algorithm>
+#include <immintrin.h>
+
+namespace DiStore::SearchLayer {
+    auto OptimisticLock::read_lock_or_restart(bool &restart) const noexcept -> uint64_t {
+        auto v = version.load(std::memory_order_acquire);
+        if (v & 0b11) {
+            _mm_pause();
+            restart = true;
+        }
+        return v;
+    }
+
+    auto OptimisticLock::upgrade_or_restart(uint64_t &v, bool &restart) noexcept -> void {
+        if (version.compare_exchange_strong(v, v + 0b10)) {
+            v += 0b10;
+        } else {
+            restart = true;
+        }
+    }
+
+    auto OptimisticLock::check_or_restart(uint64_t v, bool &restart) const noexcept -> void {
+        // keep the optimistic reads of the node before the validation
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (v != version.load(std::memory_order_relaxed)) {
+            restart = true;
+        }
+    }
+
+    BTreeNode::BTreeNode(BTreeNodeType t) : type(t), count(0) {
+        for (int i = 0; i < Constants::BTREE_FANOUT; i++) {
+            set_key(i, Anchor::max());
+        }
+    }
+
+    auto BTreeNode::rank(const Anchor &k, bool inclusive) const noexcept -> int {
+        // count may be torn under optimistic reads, the caller validates afterwards
+        auto c = std::clamp(count, 0, Constants::BTREE_FANOUT);
+        int n = 0;
+
+#if defined(__AVX2__)
+        // there is no unsigned 64-bit comparison, flip the sign bits instead
+        const auto sign = _mm256_set1_epi64x(INT64_MIN);
+        const auto qh = _mm256_xor_si256(_mm256_set1_epi64x(k.hi), sign);
+        const auto ql = _mm256_xor_si256(_mm256_set1_epi64x(k.lo), sign);
+        for (int i = 0; i < Constants::BTREE_FANOUT; i += 4) {
+            auto h = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(hi + i)), sign);
+            auto l = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(lo + i)), sign);
+            auto eq_hi = _mm256_cmpeq_epi64(h, qh);
+            auto before = _mm256_or_si256(_mm256_cmpgt_epi64(qh, h),
+                                          _mm256_and_si256(eq_hi, _mm256_cmpgt_epi64(ql, l)));
+            if (inclusive) {
+                before = _mm256_or_si256(before, _mm256_and_si256(eq_hi, _mm256_cmpeq_epi64(l, ql)));
+            }
+            n += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(before)));
+        }
+#elif defined(__SSE4_2__)
+        const auto sign = _mm_set1_epi64x(INT64_MIN);
+        const auto qh = _mm_xor_si128(_mm_set1_epi64x(k.hi), sign);
+        const auto ql = _mm_xor_si128(_mm_set1_epi64x(k.lo), sign);
+        for (int i = 0; i < Constants::BTREE_FANOUT; i += 2) {
+            auto h = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hi + i)), sign);
+            auto l = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lo + i)), sign);
+            auto eq_hi = _mm_cmpeq_epi64(h, qh);
+            auto before = _mm_or_si128(_mm_cmpgt_epi64(qh, h), _mm_and_si128(eq_hi, _mm_cmpgt_epi64(ql, l)));
+            if (inclusive) {
+                before = _mm_or_si128(before, _mm_and_si128(eq_hi, _mm_cmpeq_epi64(l, ql)));
+            }
+            n += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(before)));
+        }
+#else
+        for (int i = 0; i < c; i++) {
+            auto key = key_at(i);
+            if (key < k || (inclusive && key == k)) {
+                ++n;
+            } else {
+                break;
+            }
+        }
+#endif
+        // unused slots hold the max key, which only counts when k is the max key
+        return std::min(n, c);
+    }
+
+    auto BTreeInner::insert(const Anchor &sep, BTreeNode *right) noexcept -> void {
+        auto pos = rank(sep, false);
+        for (int i = count; i > pos; i--) {
+            set_key(i, key_at(i - 1));
+            children[i + 1] = children[i];
+        }
+
+        set_key(pos, sep);
+        children[pos + 1] = right;
+        ++count;
+    }
+
+    auto BTreeInner::split(Anchor &sep) -> BTreeInner * {
+        auto right = new BTreeInner;
+        auto half = count / 2;
+
+        // the middle key moves up
+        sep = key_at(half);
+        right->count = count - half - 1;
+        for (int i = 0; i < right->count; i++) {
+            right->set_key(i, key_at(half + 1 + i));
+            right->children[i] = children[half + 1 + i];
+        }
+        right->children[right->count] = children[count];
+
+        for (int i = half; i < count; i++) {
+            set_key(i, Anchor::max());
+        }
+        count = half;
+        return right;
+    }
+
+    auto BTreeLeaf::split(Anchor &sep) -> BTreeLeaf * {
+        auto right = new BTreeLeaf;
+        auto half = count / 2;
+
+        right->count = count - half;
+        for (int i = 0; i < right->count; i++) {
+            right->set_key(i, key_at(half + i));
+            right->values[i] = values[half + i];
+            set_key(half + i, Anchor::max());
+        }
+
+        count = half;
+        sep = right->key_at(0);
+        return right;
+    }
+
+    BTree::BTree() {
+        root = new BTreeLeaf;
+    }
+
+    BTree::~BTree() {
+        free_node(root.load());
+    }
+
+    auto BTree::free_node(BTreeNode *node) -> void {
+        if (node->type == BTreeNodeType::Inner) {
+            auto inner = static_cast<BTreeInner *>(node);
+            for (int i = 0; i <= inner->count; i++) {
+                free_node(inner->children[i]);
+            }
+            delete inner;
+        } else {
+            delete static_cast<BTreeLeaf *>(node);
+        }
+    }
+
+    auto BTree::make_root(const Anchor &sep, BTreeNode *left, BTreeNode *right) -> void {
+        auto inner = new BTreeInner;
+        inner->count = 1;
+        inner->set_key(0, sep);
+        inner->children[0] = left;
+        inner->children[1] = right;
+        root.store(inner);
+    }
+
+    auto BTree::lock_leaf(const Anchor &k, bool split) -> BTreeLeaf * {
+        while (true) {
+            auto restart = false;
+            auto node = root.load();
+            auto version = node->read_lock_or_restart(restart);
+            if (restart || node != root.load())
+                continue;
+
+            BTreeInner *parent = nullptr;
+            uint64_t parent_version = 0;
+
+            while (true) {
+                // split eagerly, so a split never propagates upwards
+                if (split && node->is_full()) {
+                    if (parent) {
+                        parent->upgrade_or_restart(parent_version, restart);
+                        if (restart)
+                            break;
+                    }
+
+                    node->upgrade_or_restart(version, restart);
+                    if (restart) {
+                        if (parent)
+                            parent->write_unlock();
+                        break;
+                    }
+
+                    // someone has grown the tree
+                    if (!parent && node != root.load()) {
+                        node->write_unlock();
+                        restart = true;
+                        break;
+                    }
+
+                    Anchor sep;
+                    BTreeNode *right;
+                    if (node->type == BTreeNodeType::Inner) {
+                        right = static_cast<BTreeInner *>(node)->split(sep);
+                    } else {
+                        right = static_cast<BTreeLeaf *>(node)->split(sep);
+                    }
+
+                    if (parent) {
+                        parent->insert(sep, right);
+                    } else {
+                        make_root(sep, node, right);
+                    }
+
+                    node->write_unlock();
+                    if (parent)
+                        parent->write_unlock();
+                    restart = true;
+                    break;
+                }
+
+                if (node->type == BTreeNodeType::Leaf)
+                    break;
+
+                if (parent) {
+                    parent->check_or_restart(parent_version, restart);
+                    if (restart)
+                        break;
+                }
+
+                auto inner = static_cast<BTreeInner *>(node);
+                parent = inner;
+                parent_version = version;
+
+                node = inner->children[inner->rank(k, true)];
+                inner->check_or_restart(version, restart);
+                if (restart)
+                    break;
+
+                version = node->read_lock_or_restart(restart);
+                if (restart)
+                    break;
+            }
+
+            if (restart)
+                continue;
+
+            node->upgrade_or_restart(version, restart);
+            if (restart)
+                continue;
+
+            if (parent) {
+                parent->check_or_restart(parent_version, restart);
+                if (restart) {
+                    node->write_unlock();
+                    continue;
+                }
+            }
+
+            return static_cast<BTreeLeaf *>(node);
+        }
+    }
+
+    auto BTree::insert(const Anchor &k, SkipListNode *v) -> bool {
+        auto leaf = lock_leaf(k, true);
+        auto pos = leaf->rank(k, false);
+        if (pos < leaf->count && leaf->key_at(pos) == k) {
+            leaf->write_unlock();
+            return false;
+        }
+
+        for (int i = leaf->count; i > pos; i--) {
+            leaf->set_key(i, leaf->key_at(i - 1));
+            leaf->values[i] = leaf->values[i - 1];
+        }
+
+        leaf->set_key(pos, k);
+        leaf->values[pos] = v;
+        ++leaf->count;
+        leaf->write_unlock();
+        return true;
+    }
+
+    auto BTree::replace(const Anchor &k, SkipListNode *expect, SkipListNode *v) -> bool {
+        auto leaf = lock_leaf(k, false);
+        auto pos = leaf->rank(k, false);
+        auto ret = pos < leaf->count && leaf->key_at(pos) == k && leaf->values[pos] == expect;
+        if (ret) {
+            leaf->values[pos] = v;
+        }
+
+        leaf->write_unlock();
+        return ret;
+    }
+
+    auto BTree::erase(const Anchor &k, SkipListNode *expect) -> bool {
+        auto leaf = lock_leaf(k, false);
+        auto pos = leaf->rank(k, false);
+        if (pos >= leaf->count || !(leaf->key_at(pos) == k) || leaf->values[pos] != expect) {
+            leaf->write_unlock();
+            return false;
+        }
+
+        for (int i = pos; i < leaf->count - 1; i++) {
+            leaf->set_key(i, leaf->key_at(i + 1));
+            leaf->values[i] = leaf->values[i + 1];
+        }
+
+        --leaf->count;
+        leaf->set_key(leaf->count, Anchor::max());
+        leaf->write_unlock();
+        return true;
+    }
+
+    auto BTree::floor(const Anchor &key) const noexcept -> SkipListNode * {
+        auto k = key;
+
+        while (true) {
+            auto restart = false;
+            auto has_fence = false;
+            Anchor fence;
+
+            auto node = root.load();
+            auto version = node->read_lock_or_restart(restart);
+            if (restart || node != root.load())
+                continue;
+
+            while (node->type == BTreeNodeType::Inner) {
+                auto inner = static_cast<const BTreeInner *>(node);
+                auto idx = inner->rank(k, true);
+                if (idx > 0) {
+                    fence = inner->key_at(idx - 1);
+                    has_fence = true;
+                }
+
+                node = inner->children[idx];
+                inner->check_or_restart(version, restart);
+                if (restart)
+                    break;
+
+                version = node->read_lock_or_restart(restart);
+                if (restart)
+                    break;
+            }
+
+            if (restart)
+                continue;
+
+            auto leaf = static_cast<const BTreeLeaf *>(node);
+            auto pos = leaf->rank(k, true);
+            auto value = pos > 0 ? leaf->values[pos - 1] : nullptr;
+            leaf->check_or_restart(version, restart);
+            if (restart)
+                continue;
+
+            if (value)
+                return value;
+
+            // keys before the lower fence of this leaf have been removed, look to the left
+            if (!has_fence || !fence.prev(k))
+                return nullptr;
+        }
+    }
+
+    auto BTree::lookup(const Anchor &k) const noexcept -> SkipListNode * {
+        while (true) {
+            auto restart = false;
+            auto node = root.load();
+            auto version = node->read_lock_or_restart(restart);
+            if (restart || node != root.load())
+                continue;
+
+            while (node->type == BTreeNodeType::Inner) {
+                auto inner = static_cast<const BTreeInner *>(node);
+                node = inner->children[inner->rank(k, true)];
+                inner->check_or_restart(version, restart);
+                if (restart)
+                    break;
+
+                version = node->read_lock_or_restart(restart);
+                if (restart)
+                    break;
+            }
+
+            if (restart)
+                continue;
+
+            auto leaf = static_cast<const BTreeLeaf *>(node);
+            auto pos = leaf->rank(k, false);
+            auto value = (pos < leaf->count && leaf->key_at(pos) == k) ? leaf->values[pos] : nullptr;
+            leaf->check_or_restart(version, restart);
+            if (!restart)
+                return value;
+        }
+    }
+
+    auto BTree::height() const noexcept -> int {
+        int h = 1;
+        for (auto node = root.load(); node->type == BTreeNodeType::Inner; ++h) {
+            node = static_cast<const BTreeInner *>(node)->children[0];
+        }
+        return h;
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef __DISTORE__SEARCH_LAYER__BTREE__BTREE__
+#define __DISTORE__SEARCH_LAYER__BTREE__BTREE__
+#include "memory/memory.hpp"
+#include "search_layer/anchor/anchor.hpp"
+
+#include <atomic>
+#include <string>
+
+namespace DiStore::SearchLayer {
+    struct SkipListNode;
+
+    namespace Constants {
+        // entries per b+-tree node, a multiple of 4 for the vectorized search
+        static constexpr int BTREE_FANOUT = 16;
+    }
+
+    /*
+     * Version lock for optimistic lock coupling. Readers remember the version and
+     * validate it afterwards, while writers bump it twice.
+     * bit 0: obsolete, bit 1: locked, others: version
+     */
+    class OptimisticLock {
+    public:
+        auto read_lock_or_restart(bool &restart) const noexcept -> uint64_t;
+        auto upgrade_or_restart(uint64_t &version, bool &restart) noexcept -> void;
+        auto check_or_restart(uint64_t version, bool &restart) const noexcept -> void;
+
+        inline auto write_lock_or_restart(bool &restart) noexcept -> void {
+            auto version = read_lock_or_restart(restart);
+            if (!restart)
+                upgrade_or_restart(version, restart);
+        }
+
+        inline auto write_unlock() noexcept -> void {
+            version.fetch_add(0b10);
+        }
+
+    private:
+        std::atomic<uint64_t> version = 0b100;
+    };
+
+    enum class BTreeNodeType : uint8_t {
+        Inner,
+        Leaf,
+    };
+
+    /*
+     * Keys of a node are kept in separated hi and lo arrays so that four of them are
+     * compared with a single AVX2 instruction. Unused slots hold the max key
+     */
+    struct BTreeNode : OptimisticLock {
+        BTreeNodeType type;
+        int count;
+        uint64_t hi[Constants::BTREE_FANOUT];
+        uint64_t lo[Constants::BTREE_FANOUT];
+
+        BTreeNode(BTreeNodeType t);
+
+        inline auto key_at(int i) const noexcept -> Anchor {
+            return {hi[i], lo[i]};
+        }
+
+        inline auto set_key(int i, const Anchor &k) noexcept -> void {
+            hi[i] = k.hi;
+            lo[i] = k.lo;
+        }
+
+        inline auto is_full() const noexcept -> bool {
+            return count == Constants::BTREE_FANOUT;
+        }
+
+        // number of keys smaller than k, or not larger than k if inclusive
+        auto rank(const Anchor &k, bool inclusive) const noexcept -> int;
+    };
+
+    // child i covers keys in [key[i - 1], key[i])
+    struct BTreeInner : BTreeNode {
+        BTreeNode *children[Constants::BTREE_FANOUT + 1];
+
+        BTreeInner() : BTreeNode(BTreeNodeType::Inner) {}
+
+        auto insert(const Anchor &sep, BTreeNode *right) noexcept -> void;
+        auto split(Anchor &sep) -> BTreeInner *;
+    };
+
+    struct BTreeLeaf : BTreeNode {
+        SkipListNode *values[Constants::BTREE_FANOUT];
+
+        BTreeLeaf() : BTreeNode(BTreeNodeType::Leaf) {}
+
+        auto split(Anchor &sep) -> BTreeLeaf *;
+    };
+
+    /*
+     * A B+-tree from anchors to skip list nodes with optimistic lock coupling
+     * (Leis et al., DaMoN'16). Readers never write shared memory and restart if a node
+     * they passed changes; writers lock at most a leaf and its parent, splitting full
+     * nodes on the way down. Nodes are never merged or freed, and an emptied leaf keeps
+     * its place in the tree.
+     */
+    class BTree {
+    public:
+        BTree();
+        BTree(const BTree &) = delete;
+        BTree(BTree &&) = delete;
+        auto operator=(const BTree &) = delete;
+        auto operator=(BTree &&) = delete;
+        ~BTree();
+
+        // return false if the key exists
+        auto insert(const Anchor &k, SkipListNode *v) -> bool;
+        // replace the value of k only if it is expect
+        auto replace(const Anchor &k, SkipListNode *expect, SkipListNode *v) -> bool;
+        // remove k only if its value is expect
+        auto erase(const Anchor &k, SkipListNode *expect) -> bool;
+
+        // the value of the largest key not larger than k
+        auto floor(const Anchor &k) const noexcept -> SkipListNode *;
+        auto lookup(const Anchor &k) const noexcept -> SkipListNode *;
+
+        auto height() const noexcept -> int;
+
+    private:
+        std::atomic<BTreeNode *> root;
+
+        auto make_root(const Anchor &sep, BTreeNode *left, BTreeNode *right) -> void;
+
+        // lock the leaf that should hold k, splitting full nodes on the way if split is set
+        auto lock_leaf(const Anchor &k, bool split) -> BTreeLeaf *;
+        static auto free_node(BTreeNode *node) -> void;
+    };
+}
+#endif
@@ -1,40 +1,106 @@
 #include "search_layer.hpp"
 namespace DiStore::SearchLayer {
-    auto SkipList::insert(const std::string &anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept -> bool {
-        SkipListNode *update[Constants::MAX_LEVEL] = {nullptr};
-        auto *walker = head;
+    auto SkipList::insert(std::string_view anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept -> bool {
+        SkipListNode *preds[Constants::MAX_LEVEL];
+        SkipListNode *succs[Constants::MAX_LEVEL];
+        auto [new_node, level] = SkipList::make_new_node(anchor, r, t);
 
-        for (int i = current_level - 1; i >= 0; i--) {
-            while (walker->forwards[i] && walker->forwards[i]->anchor < anchor) {
-                walker = walker->forwards[i];
+        while (true) {
+            if (find(new_node->anchor, preds, succs)) {
+                // never published
+                SkipListNode::free_skip_node(new_node);
+                return false;
+            }
+
+            for (int i = 0; i < level; i++) {
+                new_node->forwards[i].store(succs[i], std::memory_order_relaxed);
             }
+            new_node->backward.store(preds[0], std::memory_order_relaxed);
 
-            update[i] = walker;
+            auto expect = succs[0];
+            if (preds[0]->forwards[0].compare_exchange_strong(expect, new_node)) {
+                break;
+            }
         }
 
-        auto [new_node, level] = SkipList::make_new_node(anchor, r, t);
-        if (level > current_level) {
-            for (auto i = current_level; i < level; i++) {
-                update[i] = head;
+        // visible from now on
+        if (succs[0]) {
+            succs[0]->backward.store(new_node, std::memory_order_release);
+        }
+
+        auto cur = current_level.load();
+        while (level > cur && !current_level.compare_exchange_weak(cur, level));
+
+        for (int i = 1; i < level; i++) {
+            while (true) {
+                auto expect = succs[i];
+                if (preds[i]->forwards[i].compare_exchange_strong(expect, new_node)) {
+                    break;
+                }
+
+                find(new_node->anchor, preds, succs);
+
+                // stop building the tower of a node being removed
+                auto forward = new_node->forwards[i].load();
+                if (SkipListNode::is_marked(forward)) {
+                    goto done;
+                }
+
+                if (forward != succs[i] && !new_node->forwards[i].compare_exchange_strong(forward, succs[i])) {
+                    goto done;
+                }
             }
+        }
 
-            current_level = level;
+    done:
+#ifdef __BTREE_SEARCH_LAYER__
+        index_insert(new_node);
+#endif
+        try_retire(new_node, Constants::TOWER_BUILT);
+        return true;
+    }
+
+    auto SkipList::begin_append() noexcept -> AppendCursor {
+        AppendCursor cursor;
+        auto pred = head;
+        // a node of level i + 1 is also linked at level i, so each level goes on from there
+        for (int i = Constants::MAX_LEVEL - 1; i >= 0; i--) {
+            for (auto n = next_at(pred, i); n; n = next_at(n, i)) {
+                pred = n;
+            }
+            cursor.tails[i] = pred;
+        }
+        return cursor;
+    }
+
+    auto SkipList::append(AppendCursor &cursor, const Anchor &anchor, const RemotePointer &r,
+                          DataLayer::LinkedNodeType t) noexcept
+        -> SkipListNode *
+    {
+        auto tail = cursor.tails[0];
+        if (tail != head && tail->anchor >= anchor) {
+            return nullptr;
         }
 
+        auto level = new_node_level();
+        auto new_node = SkipListNode::make_skip_node(level, anchor, r, t, nullptr, tail);
         for (int i = 0; i < level; i++) {
-            new_node->forwards[i] = update[i]->forwards[i];
-            update[i]->forwards[i] = new_node;
+            cursor.tails[i]->forwards[i].store(new_node, std::memory_order_release);
+            cursor.tails[i] = new_node;
         }
 
-        // new_node->backward = (update[0] == head) ? nullptr : update[0];
-        new_node->backward = update[0];
-        if (new_node->forwards[0])
-            new_node->forwards[0]->backward = new_node;
-        return true;
+        auto cur = current_level.load();
+        while (level > cur && !current_level.compare_exchange_weak(cur, level));
+
+#ifdef __BTREE_SEARCH_LAYER__
+        index_insert(new_node);
+#endif
+        try_retire(new_node, Constants::TOWER_BUILT);
+        return new_node;
     }
 
-    auto SkipList::update(const std::string &anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept -> bool {
-        auto node = search_node(anchor);
+    auto SkipList::update(std::string_view anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept -> bool {
+        auto node = search(anchor);
         if (!node)
             return false;
 
@@ -43,102 +109,130 @@ namespace DiStore::SearchLayer {
         return true;
     }
 
-    auto SkipList::search(const std::string &anchor) const noexcept -> SkipListNode * {
-        auto node = search_node(anchor);
-        if (node)
+    auto SkipList::search(std::string_view anchor) const noexcept -> SkipListNode * {
+        auto a = Anchor::make_anchor(anchor);
+        auto node = search_node(a);
+        if (node != head && node->anchor == a)
             return node;
         return nullptr;
     }
 
-    auto SkipList::calibrate(SkipListNode *node, int level) -> void {
-        SkipListNode *update[Constants::MAX_LEVEL] = {nullptr};
-        auto *walker = head;
+    auto SkipList::fuzzy_search(std::string_view member) const noexcept -> SkipListNode * {
+        return search_node(Anchor::make_anchor(member));
+    }
 
-        for (int i = current_level - 1; i >= 1; i--) {
-            while (walker->forwards[i] && walker->forwards[i]->anchor < node->anchor) {
-                walker = walker->forwards[i];
-            }
+    auto SkipList::remove(std::string_view anchor) -> bool {
+        SkipListNode *preds[Constants::MAX_LEVEL];
+        SkipListNode *succs[Constants::MAX_LEVEL];
 
-            update[i] = walker;
-        }
+        if (!find(Anchor::make_anchor(anchor), preds, succs))
+            return false;
 
-        if (level > current_level) {
-            for (auto i = current_level; i < level; i++) {
-                update[i] = head;
-            }
+        return remove(succs[0]);
+    }
 
-            current_level = level;
+    auto SkipList::remove(SkipListNode *victim) -> bool {
+        for (int i = victim->level - 1; i >= 1; i--) {
+            auto succ = victim->forwards[i].load();
+            while (!SkipListNode::is_marked(succ) &&
+                   !victim->forwards[i].compare_exchange_weak(succ, SkipListNode::marked(succ)));
         }
 
-        for (int i = 1; i < level; i++) {
-            node->forwards[i] = update[i]->forwards[i];
-            update[i]->forwards[i] = node;
-        }
-    }
+        // whoever marks the bottom level removes the node
+        auto succ = victim->forwards[0].load();
+        while (true) {
+            if (SkipListNode::is_marked(succ))
+                return false;
 
-    auto SkipList::fuzzy_search(const std::string &member) -> SkipListNode * {
-        auto walker = head;
-
-        for (int i = current_level - 1; i >= 0; i--) {
-            while (walker->forwards[i] && walker->forwards[i]->anchor < member) {
-                walker = walker->forwards[i];
-            }
+            if (victim->forwards[0].compare_exchange_weak(succ, SkipListNode::marked(succ)))
+                break;
         }
 
-        if (walker->forwards[0] && walker->forwards[0]->anchor == member) {
-            return walker->forwards[0];
+        if (succ) {
+            succ->backward.store(victim->backward.load(), std::memory_order_release);
         }
 
-        if (walker->forwards[0] == nullptr ||
-            (walker->forwards[0]->anchor > member && walker->anchor <= member))
-            return walker;
-
-        return nullptr;
+        try_retire(victim, Constants::UNLINKING);
+        return true;
     }
 
-    auto SkipList::remove(const std::string &anchor) -> bool {
-        SkipListNode *update[Constants::MAX_LEVEL] = {nullptr};
-        auto *walker = head;
+    auto SkipList::try_retire(SkipListNode *node, int bit) noexcept -> void {
+        auto other = bit ^ (Constants::TOWER_BUILT | Constants::UNLINKING);
+
+        // the later one of the inserter and the remover retires the node
+        if (!(node->lifecycle.fetch_or(bit) & other))
+            return;
+
+#ifdef __BTREE_SEARCH_LAYER__
+        index.erase(node->anchor, node);
+#endif
+        // no one links the node again, a search unlinks it from all levels
+        SkipListNode *preds[Constants::MAX_LEVEL];
+        SkipListNode *succs[Constants::MAX_LEVEL];
+        find(node->anchor, preds, succs);
+        Epoch::EpochManager::instance().retire(node, SkipListNode::free_skip_node);
+    }
 
-        for (int i = current_level - 1; i >= 0; i--) {
-            while (walker->forwards[i] && walker->forwards[i]->anchor < anchor) {
-                walker = walker->forwards[i];
+    auto SkipList::find(const Anchor &anchor, SkipListNode **preds, SkipListNode **succs) noexcept
+        -> bool
+    {
+        SkipListNode *pred, *curr, *succ;
+
+    retry:
+        pred = head;
+        curr = nullptr;
+        auto top = Constants::MAX_LEVEL - 1;
+#ifdef __BTREE_SEARCH_LAYER__
+        // a hint removed meanwhile fails the CAS on its forward pointer and we come back
+        if (auto hint = index_floor(anchor, false); hint && !hint->is_removed())
+            pred = hint;
+        top = 0;
+#endif
+        for (int i = top; i >= 0; i--) {
+            curr = SkipListNode::unmarked(pred->forwards[i].load(std::memory_order_acquire));
+            while (curr) {
+                succ = curr->forwards[i].load(std::memory_order_acquire);
+                while (SkipListNode::is_marked(succ)) {
+                    auto expect = curr;
+                    if (!pred->forwards[i].compare_exchange_strong(expect, SkipListNode::unmarked(succ)))
+                        goto retry;
+
+                    curr = SkipListNode::unmarked(succ);
+                    if (!curr)
+                        break;
+                    succ = curr->forwards[i].load(std::memory_order_acquire);
+                }
+
+                if (!curr || curr->anchor >= anchor)
+                    break;
+
+                pred = curr;
+                curr = SkipListNode::unmarked(succ);
             }
 
-            update[i] = walker;
-        }
-
-        if (walker->forwards[0]->anchor != anchor)
-            return false;
-
-        walker = walker->forwards[0];
-        for (int i = 0; i < current_level; i++) {
-            if (update[i]->forwards[i] != walker)
-                break;
-
-            update[i]->forwards[i] = walker->forwards[i];
+            preds[i] = pred;
+            succs[i] = curr;
         }
 
-        if (walker->forwards[0])
-            walker->forwards[0]->backward = walker->backward;
+        return curr && curr->anchor == anchor;
+    }
 
-        while (current_level > 0 && head->forwards[current_level - 1] == nullptr) {
-            --current_level;
+    auto SkipList::next_at(const SkipListNode *node, int level) noexcept -> SkipListNode * {
+        auto n = SkipListNode::unmarked(node->forwards[level].load(std::memory_order_acquire));
+        while (n && SkipListNode::is_marked(n->forwards[level].load(std::memory_order_acquire))) {
+            n = SkipListNode::unmarked(n->forwards[level].load(std::memory_order_acquire));
         }
-
-        delete walker;
-
-        return true;
+        return n;
     }
 
     auto SkipList::dump() const noexcept -> void {
         for (int i = current_level - 1; i >= 0; i--) {
-            auto walker = head;
-            while (walker->forwards[i]) {
-                walker = walker->forwards[i];
+            auto walker = next_at(head, i);
+            while (walker) {
                 // std::cout << walker->backward << " <- " << walker << ": ";
                 // std::cout << walker->anchor << "\n";
                 std::cout << walker->anchor << " ";
+                walker = next_at(walker, i);
             }
             std::cout << "\n";
         }
@@ -147,43 +241,94 @@ namespace DiStore::SearchLayer {
     auto SkipList::show_levels() const noexcept -> void {
         size_t level_length[Constants::MAX_LEVEL];
         size_t total_nodes = 0;
+        size_t total_bytes = 0;
+        size_t saved_bytes = 0;
+        int levels = current_level;
 
-        for (int i = 0; i < current_level; i++) {
+        for (int i = 0; i < levels; i++) {
             level_length[i] = 0;
         }
 
-        for (int i = current_level - 1; i >= 0; i--) {
-            auto walker = head;
-            while(walker->forwards[i]) {
+        for (int i = levels - 1; i >= 0; i--) {
+            auto walker = next_at(head, i);
+            while(walker) {
                 ++level_length[i];
-                ++total_nodes;
-                walker = walker->forwards[i];
+                walker = next_at(walker, i);
             }
         }
 
+        for (auto walker = next_at(head, 0); walker; walker = next_at(walker, 0)) {
+            ++total_nodes;
+            total_bytes += SkipListNode::node_size(walker->level);
+
+            // what a std::string anchor would have taken, including its heap buffer
+            auto s = walker->anchor.to_string();
+            saved_bytes += sizeof(std::string) - sizeof(Anchor);
+            if (s.capacity() > 15)
+                saved_bytes += s.capacity() + 1;
+        }
+
         std::cout << ">> Total nodes " << total_nodes << ", "
-                  << "Comsuming " << total_nodes * sizeof(SkipListNode) / (1 << 20UL) << " MiB space\n";
-        for (int i = 0; i < current_level; i++) {
+                  << "Comsuming " << total_bytes / (1 << 10UL) << " KiB space, "
+                  << "inline anchors save " << saved_bytes / (1 << 10UL) << " KiB\n";
+#ifdef __BTREE_SEARCH_LAYER__
+        std::cout << ">> Index height is " << index.height() << "\n";
+#endif
+        for (int i = 0; i < levels; i++) {
             std::cout << ">> Level " << i << " length is " << level_length[i] << "\n";
         }
     }
 
-    auto SkipList::search_node(const std::string &anchor) const noexcept -> SkipListNode * {
-        auto walker = head;
+    auto SkipList::search_node(const Anchor &anchor) const noexcept -> SkipListNode * {
+#ifdef __BTREE_SEARCH_LAYER__
+        auto pred = index_floor(anchor, true);
+        if (!pred || pred->is_removed())
+            pred = head;
 
-        for (int i = current_level - 1; i >= 0; i--) {
-            while (walker->forwards[i] && walker->forwards[i]->anchor < anchor) {
-                walker = walker->forwards[i];
+        for (auto curr = next_at(pred, 0); curr && curr->anchor <= anchor; curr = next_at(curr, 0)) {
+            pred = curr;
+        }
+        return pred;
+#else
+        auto pred = head;
+
+        for (int i = current_level.load(std::memory_order_acquire) - 1; i >= 0; i--) {
+            auto curr = SkipListNode::unmarked(pred->forwards[i].load(std::memory_order_acquire));
+            while (curr) {
+                auto succ = curr->forwards[i].load(std::memory_order_acquire);
+                // skip a node being removed
+                if (SkipListNode::is_marked(succ)) {
+                    curr = SkipListNode::unmarked(succ);
+                    continue;
+                }
+
+                if (curr->anchor > anchor)
+                    break;
+
+                pred = curr;
+                curr = succ;
             }
         }
 
-        if (walker->forwards[0] == nullptr)
+        return pred;
+#endif
+    }
+
+#ifdef __BTREE_SEARCH_LAYER__
+    auto SkipList::index_floor(const Anchor &anchor, bool inclusive) const noexcept -> SkipListNode * {
+        auto k = anchor;
+        if (!inclusive && !anchor.prev(k))
             return nullptr;
+        return index.floor(k);
+    }
 
-        if (walker->forwards[0]->anchor == anchor) {
-            return walker->forwards[0];
+    auto SkipList::index_insert(SkipListNode *node) noexcept -> void {
+        while (!index.insert(node->anchor, node)) {
+            // only a removed node shares the anchor, and it is retired after being erased
+            auto indexed = index.lookup(node->anchor);
+            if (indexed && index.replace(node->anchor, indexed, node))
+                return;
         }
-
-        return nullptr;
     }
+#endif
 }
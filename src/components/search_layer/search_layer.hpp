@@ -5,6 +5,9 @@
 #include "data_layer/data_layer.hpp"
 
 #include "handover_locktable/handover_locktable.hpp"
+#include "epoch/epoch.hpp"
+#include "anchor/anchor.hpp"
+#include "btree/btree.hpp"
 
 #include <atomic>
 #include <mutex>
@@ -12,38 +15,90 @@ namespace DiStore::SearchLayer {
     using namespace Memory;
     namespace Constants {
         static constexpr int MAX_LEVEL = 16;
+
+        // lifecycle bits of a node, whoever sets the second one unlinks and retires it
+        static constexpr int TOWER_BUILT = 1;
+        static constexpr int UNLINKING = 2;
+
+        static_assert(ANCHOR_SIZE == DataLayer::Constants::KEYLEN, "an anchor should hold a whole key");
     }
 
+    /*
+     * forwards[i] carries a mark in its lowest bit once the node is logically deleted
+     * at level i. Nodes are never freed while a reader may hold them, see Epoch
+     */
     struct SkipListNode {
-        std::string anchor;
+        Anchor anchor;
         RemotePointer data_node;
         DataLayer::LinkedNodeType type;
+        int level;
+        std::atomic<int> lifecycle;
+        // requests the winner of ctx takes, adapted to the waiters it has seen
+        std::atomic<int> combining;
         std::atomic<Concurrency::ConcurrencyContext *> ctx;
-        SkipListNode *backward;
-        SkipListNode *forwards[];
+        // predecessor at the bottom level. It is updated by whoever inserts or removes right
+        // before this node, i.e., the holder of the predecessor's lock, so it is only a hint
+        // to lock-free readers
+        std::atomic<SkipListNode *> backward;
+        std::atomic<SkipListNode *> forwards[];
 
-        static auto make_skip_node(int level, const std::string &k, RemotePointer r = nullptr,
+        static auto make_skip_node(int level, const Anchor &k, RemotePointer r = nullptr,
                                    DataLayer::LinkedNodeType t = DataLayer::LinkedNodeType::NotSet,
                                    SkipListNode *n = nullptr, SkipListNode *b = nullptr)
             -> SkipListNode *
         {
-            auto buffer = new byte_t[sizeof(SkipListNode) + level * sizeof(SkipListNode *)];
-            auto anchor = new (buffer) std::string;
-            anchor->assign(k);
+            auto buffer = new byte_t[node_size(level)];
             auto ret = reinterpret_cast<SkipListNode *>(buffer);
-            ret->forwards[0] = n;
-            ret->backward = b;
+            new (&ret->forwards[0]) std::atomic<SkipListNode *>(n);
+            new (&ret->backward) std::atomic<SkipListNode *>(b);
             for (int i = 1; i < level; i++) {
-                ret->forwards[i] = nullptr;
+                new (&ret->forwards[i]) std::atomic<SkipListNode *>(nullptr);
             }
 
+            ret->anchor = k;
             ret->data_node = r;
             ret->type = t;
-            ret->ctx = nullptr;
+            ret->level = level;
+            new (&ret->lifecycle) std::atomic<int>(0);
+            new (&ret->combining) std::atomic<int>(Concurrency::Constants::COMBINING_DEPTH);
+            new (&ret->ctx) std::atomic<Concurrency::ConcurrencyContext *>(nullptr);
 
             return ret;
         }
 
+        static auto free_skip_node(void *node) -> void {
+            delete[] reinterpret_cast<byte_t *>(node);
+        }
+
+        static constexpr auto node_size(int level) noexcept -> size_t {
+            return sizeof(SkipListNode) + level * sizeof(std::atomic<SkipListNode *>);
+        }
+
+        inline static auto is_marked(SkipListNode *p) noexcept -> bool {
+            return reinterpret_cast<uintptr_t>(p) & 1UL;
+        }
+
+        inline static auto marked(SkipListNode *p) noexcept -> SkipListNode * {
+            return reinterpret_cast<SkipListNode *>(reinterpret_cast<uintptr_t>(p) | 1UL);
+        }
+
+        inline static auto unmarked(SkipListNode *p) noexcept -> SkipListNode * {
+            return reinterpret_cast<SkipListNode *>(reinterpret_cast<uintptr_t>(p) & ~1UL);
+        }
+
+        // the first successor that is not being removed at the bottom level
+        inline auto next() const noexcept -> SkipListNode * {
+            auto n = unmarked(forwards[0].load(std::memory_order_acquire));
+            while (n && is_marked(n->forwards[0].load(std::memory_order_acquire))) {
+                n = unmarked(n->forwards[0].load(std::memory_order_acquire));
+            }
+            return n;
+        }
+
+        inline auto is_removed() const noexcept -> bool {
+            return is_marked(forwards[0].load(std::memory_order_acquire));
+        }
+
         SkipListNode() = delete;
         SkipListNode(const SkipListNode &) = delete;
         SkipListNode(SkipListNode &&) = delete;
@@ -53,16 +108,24 @@ namespace DiStore::SearchLayer {
     };
 
 
-    // This skip list is not thread-safe
-    // for concurrency, it's expected to be updated by a dedicated thread
-    // but we guarantee reads are always valid
-    //
-    // the implementaion is based on Redis' zset, but customized for our
-    // use
+    /*
+     * A lock-free skip list following Fraser's and Herlihy's designs. Nodes are linked
+     * with CAS level by level from the bottom, and removed by marking their forward
+     * pointers from the top before being unlinked by any traversal that meets them.
+     * A node is visible once linked at the bottom level; upper levels only speed up
+     * searches.
+     *
+     * Readers never block or help, and unlinked nodes are reclaimed through Epoch, so
+     * callers should hold an Epoch::Guard as long as they use a returned node.
+     *
+     * With __BTREE_SEARCH_LAYER__ only the bottom level is kept, and a B+-tree maps
+     * each anchor to its node. A search starts from the floor of its anchor in the
+     * index and walks the bottom level from there.
+     */
     class SkipList {
     public:
         SkipList() : current_level(1) {
-            head = SkipListNode::make_skip_node(Constants::MAX_LEVEL, "", nullptr,
+            head = SkipListNode::make_skip_node(Constants::MAX_LEVEL, Anchor{0, 0}, nullptr,
                                                 DataLayer::LinkedNodeType::TypeHead);
         };
         SkipList(const SkipList &) = delete;
@@ -82,32 +145,53 @@ namespace DiStore::SearchLayer {
             return std::make_unique<SkipList>();
         }
 
-        static auto make_new_node(const std::string &anchor, const RemotePointer &r,
+        static auto new_node_level() -> int {
+#ifdef __BTREE_SEARCH_LAYER__
+            return 1;
+#else
+            return random_level();
+#endif
+        }
+
+        static auto make_new_node(std::string_view anchor, const RemotePointer &r,
                            DataLayer::LinkedNodeType t) noexcept
             -> std::pair<SkipListNode *, int> {
 
-            auto level = random_level();
-            auto new_node = SkipListNode::make_skip_node(level, anchor, r, t);
+            auto level = new_node_level();
+            auto new_node = SkipListNode::make_skip_node(level, Anchor::make_anchor(anchor), r, t);
             return {new_node, level};
         }
 
+        // the last node of every level, which appended nodes go after
+        struct AppendCursor {
+            SkipListNode *tails[Constants::MAX_LEVEL];
+        };
+
+        // the tails of a list that no one else modifies until appending is done
+        auto begin_append() noexcept -> AppendCursor;
+        // link a node whose anchor is larger than every linked one after the tails, level
+        // by level from the bottom. nullptr if the anchor is not larger
+        auto append(AppendCursor &cursor, const Anchor &anchor, const RemotePointer &r,
+                    DataLayer::LinkedNodeType t) noexcept
+            -> SkipListNode *;
+
         inline auto fake_head(RemotePointer valid) -> void {
             head->data_node = valid;
         }
 
-        auto insert(const std::string &anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept
+        // return false if the anchor exists
+        auto insert(std::string_view anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept
             -> bool;
-        auto update(const std::string &anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept
+        auto update(std::string_view anchor, const RemotePointer &r, DataLayer::LinkedNodeType t) noexcept
             -> bool;
-        auto search(const std::string &anchor) const noexcept -> SkipListNode *;
-
-        // a new node is linked at the bottom level, but upper levels are not updated
-        auto calibrate(SkipListNode *node, int level) -> void;
+        auto search(std::string_view anchor) const noexcept -> SkipListNode *;
 
         // search whether a member key's anchor key is in the list
         // 1 -> 10 -> 20 -> ... -> 100, searching for 3 will return 1
-        auto fuzzy_search(const std::string &member) -> SkipListNode *;
-        auto remove(const std::string &anchor) -> bool;
+        auto fuzzy_search(std::string_view member) const noexcept -> SkipListNode *;
+        auto remove(std::string_view anchor) -> bool;
+        // remove exactly this node, false if it is already being removed
+        auto remove(SkipListNode *victim) -> bool;
 
         auto dump() const noexcept -> void;
 
@@ -117,11 +201,27 @@ namespace DiStore::SearchLayer {
 
         auto show_levels() const noexcept -> void;
 
-        // delete and range are not needed
     private:
-        int current_level;
+        std::atomic<int> current_level;
         SkipListNode *head;
-        auto search_node(const std::string &anchor) const noexcept -> SkipListNode *;
+#ifdef __BTREE_SEARCH_LAYER__
+        BTree index;
+
+        // a linked node before anchor (not after it if inclusive) found through the index
+        auto index_floor(const Anchor &anchor, bool inclusive) const noexcept -> SkipListNode *;
+        // publish node in the index, replacing a removed node with the same anchor
+        auto index_insert(SkipListNode *node) noexcept -> void;
+#endif
+
+        // the last node before anchor and the first node not before anchor of every level,
+        // unlinking marked nodes on the way. Return whether anchor is found
+        auto find(const Anchor &anchor, SkipListNode **preds, SkipListNode **succs) noexcept -> bool;
+        // the last node whose anchor is not larger than anchor
+        auto search_node(const Anchor &anchor) const noexcept -> SkipListNode *;
+        // claim the retirement of a node that is being unlinked with the given lifecycle bit
+        auto try_retire(SkipListNode *node, int bit) noexcept -> void;
+        // the first unmarked successor of node at level
+        static auto next_at(const SkipListNode *node, int level) noexcept -> SkipListNode *;
     };
 }
 #endif
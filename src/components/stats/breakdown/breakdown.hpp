@@ -5,6 +5,7 @@
 #include "misc/misc.hpp"
 
 #include <vector>
+#include <memory>
 #include <unordered_map>
 
 namespace DiStore::Stats {
@@ -18,7 +19,11 @@ namespace DiStore::Stats {
         DataLayerWriteSplitted,
         DataLayerMorph,
         DataLayerSplit,
+        DataLayerMerge,
         DataLayerContention,
+        // requests a winner serves for waiters, a count rather than a span
+        DataLayerCombined,
+        DataLayerCombiningWindow,
 
         MemoryAllocation,
         RemoteMemoryAllocation,
@@ -27,8 +32,8 @@ namespace DiStore::Stats {
     class Breakdown {
     public:
         friend StatsCollector;
-        Breakdown(size_t batch_size)
-            :batch(batch_size) {}
+        Breakdown()
+            : histograms(new Histogram[OPS]) {}
         ~Breakdown() = default;
 
         inline auto begin(DiStoreBreakdownOps op) noexcept -> void {
@@ -43,14 +48,17 @@ namespace DiStore::Stats {
             pair.second = std::chrono::steady_clock::now();
 
             auto diff = pair.second - pair.first;
-            auto span = double(std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
-            auto &tmp_arr = tmp[op];
-            tmp_arr.push_back(span);
+            histograms[size_t(op)].record(std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
+#endif
+        }
 
-            if (tmp_arr.size() == batch) {
-                results[op].push_back(Misc::avg(tmp_arr));
-                tmp_arr.clear();
-            }
+        // sample a value that is not a span, e.g., DataLayerCombined
+        inline auto record(DiStoreBreakdownOps op, uint64_t value) noexcept -> void {
+#ifdef __BREAKDOWN__
+            histograms[size_t(op)].record(value);
+#else
+            UNUSED(op);
+            UNUSED(value);
 #endif
         }
 
@@ -58,35 +66,26 @@ namespace DiStore::Stats {
 #ifdef __BREAKDOWN__
             for (auto &k : ops_table) {
                 std::cout << ">> Breakdown " << decode_breakdown(k) << ": ";
-                auto &arr = results[k];
-                std::sort(arr.begin(), arr.end(), std::greater<>());
-                std::cout << "avg: " << Misc::avg(arr) << "ns, ";
-                std::cout << "p50: " << Misc::p50(arr) << "ns, ";
-                std::cout << "p90: " << Misc::p90(arr) << "ns, ";
-                std::cout << "p99: " << Misc::p99(arr) << "ns\n";
+                auto &h = histograms[size_t(k)];
+                auto unit = k == DiStoreBreakdownOps::DataLayerCombined ? "" : "ns";
+                std::cout << "avg: " << h.avg() << unit << ", ";
+                std::cout << "p50: " << h.percentile(50) << unit << ", ";
+                std::cout << "p90: " << h.percentile(90) << unit << ", ";
+                std::cout << "p99: " << h.percentile(99) << unit << ", ";
+                std::cout << "p999: " << h.percentile(99.9) << unit << "\n";
             }
 #endif
         }
 
         auto submit(StatsCollector &collector) noexcept -> void {
             for (auto &k : ops_table) {
-                auto tmp_arr = tmp[k];
-                if (tmp_arr.size() != 0) {
-                    results[k].push_back(Misc::avg(tmp_arr));
-                    tmp_arr.clear();
-                }
-                auto &arr = results[k];
-                std::sort(arr.begin(), arr.end(), std::greater<>());
-                collector.submit(decode_breakdown(k),
-                                 {Misc::avg(arr), Misc::p50(arr),
-                                  Misc::p90(arr), Misc::p99(arr)});
-            }            
+                collector.submit(decode_breakdown(k), histograms[size_t(k)]);
+            }
         }
 
         auto clear() noexcept -> void {
             for (auto &k : ops_table) {
-                results[k].clear();
-                tmp[k].clear();
+                histograms[size_t(k)].clear();
             }
         }
     private:
@@ -102,15 +101,19 @@ namespace DiStore::Stats {
             DiStoreBreakdownOps::DataLayerWriteSplitted,
             DiStoreBreakdownOps::DataLayerMorph,
             DiStoreBreakdownOps::DataLayerSplit,
+            DiStoreBreakdownOps::DataLayerMerge,
             DiStoreBreakdownOps::DataLayerContention,
+            DiStoreBreakdownOps::DataLayerCombined,
+            DiStoreBreakdownOps::DataLayerCombiningWindow,
 
             DiStoreBreakdownOps::MemoryAllocation,
             DiStoreBreakdownOps::RemoteMemoryAllocation,
         };
 
-        const size_t batch;
-        std::unordered_map<DiStoreBreakdownOps, std::vector<double>> results;
-        std::unordered_map<DiStoreBreakdownOps, std::vector<double>> tmp;
+        constexpr static size_t OPS = size_t(DiStoreBreakdownOps::RemoteMemoryAllocation) + 1;
+
+        // indexed by op, too large to live on a worker's stack
+        std::unique_ptr<Histogram[]> histograms;
         std::unordered_map<DiStoreBreakdownOps, SteadyTimePair> spans;
 
         auto decode_breakdown(DiStoreBreakdownOps op) -> std::string {
@@ -131,8 +134,14 @@ namespace DiStore::Stats {
                 return "DataLayerMorph";
             case DiStoreBreakdownOps::DataLayerSplit:
                 return "DataLayerSplit";
+            case DiStoreBreakdownOps::DataLayerMerge:
+                return "DataLayerMerge";
             case DiStoreBreakdownOps::DataLayerContention:
                 return "DataLayerContention";
+            case DiStoreBreakdownOps::DataLayerCombined:
+                return "DataLayerCombined";
+            case DiStoreBreakdownOps::DataLayerCombiningWindow:
+                return "DataLayerCombiningWindow";
             case DiStoreBreakdownOps::MemoryAllocation:
                 return "MemoryAllocation";
             case DiStoreBreakdownOps::RemoteMemoryAllocation:
@@ -0,0 +1 @@
+#include "histogram.hpp"
@@ -0,0 +1,174 @@
+#ifndef __DISTORE__STATS__HISTOGRAM__HISTOGRAM__
+#define __DISTORE__STATS__HISTOGRAM__HISTOGRAM__
+#include <atomic>
+#include <array>
+#include <limits>
+#include <ostream>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace DiStore::Stats {
+    /*
+     * An HDR-style log-bucketed histogram. Values below SUB_BUCKETS are counted exactly,
+     * each larger power of two is split into SUB_BUCKETS / 2 linear sub-buckets, so a
+     * reported value is within 1 / 64 of the recorded one over the whole uint64_t range.
+     *
+     * record() is single-writer: each thread records into its own histogram with plain
+     * relaxed stores. merge() adds atomically, so several threads may merge into one
+     * histogram while others read it without locks
+     */
+    class Histogram {
+    public:
+        constexpr static size_t SUB_BUCKET_BITS = 7;
+        constexpr static size_t SUB_BUCKETS = 1UL << SUB_BUCKET_BITS;
+        constexpr static size_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+        constexpr static size_t BUCKETS = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * HALF_SUB_BUCKETS;
+
+        Histogram() = default;
+        ~Histogram() = default;
+        Histogram(const Histogram &) = delete;
+        auto operator=(const Histogram &) -> Histogram & = delete;
+
+        static constexpr auto bucket_of(uint64_t value) noexcept -> size_t {
+            if (value < SUB_BUCKETS) {
+                return value;
+            }
+
+            size_t exp = 63 - __builtin_clzll(value);
+            auto sub = value >> (exp - SUB_BUCKET_BITS + 1);
+            return SUB_BUCKETS + (exp - SUB_BUCKET_BITS) * HALF_SUB_BUCKETS + (sub - HALF_SUB_BUCKETS);
+        }
+
+        // the largest value counted by a bucket
+        static constexpr auto upper_of(size_t bucket) noexcept -> uint64_t {
+            if (bucket < SUB_BUCKETS) {
+                return bucket;
+            }
+
+            auto exp = (bucket - SUB_BUCKETS) / HALF_SUB_BUCKETS + SUB_BUCKET_BITS;
+            auto sub = (bucket - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+            auto shift = exp - SUB_BUCKET_BITS + 1;
+            return (uint64_t(sub) << shift) + ((1UL << shift) - 1);
+        }
+
+        inline auto record(uint64_t value) noexcept -> void {
+            bump(buckets[bucket_of(value)], 1);
+            bump(total, 1);
+            bump(sum, value);
+            if (value < lowest.load(std::memory_order_relaxed)) {
+                lowest.store(value, std::memory_order_relaxed);
+            }
+            if (value > highest.load(std::memory_order_relaxed)) {
+                highest.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        auto merge(const Histogram &other) noexcept -> void {
+            for (size_t i = 0; i < BUCKETS; i++) {
+                auto c = other.buckets[i].load(std::memory_order_relaxed);
+                if (c != 0) {
+                    buckets[i].fetch_add(c, std::memory_order_relaxed);
+                }
+            }
+            total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            auto low = other.lowest.load(std::memory_order_relaxed);
+            auto cur = lowest.load(std::memory_order_relaxed);
+            while (low < cur && !lowest.compare_exchange_weak(cur, low, std::memory_order_relaxed))
+                ;
+
+            auto high = other.highest.load(std::memory_order_relaxed);
+            cur = highest.load(std::memory_order_relaxed);
+            while (high > cur && !highest.compare_exchange_weak(cur, high, std::memory_order_relaxed))
+                ;
+        }
+
+        auto clear() noexcept -> void {
+            for (auto &b : buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            total.store(0, std::memory_order_relaxed);
+            sum.store(0, std::memory_order_relaxed);
+            lowest.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+            highest.store(0, std::memory_order_relaxed);
+        }
+
+        inline auto count() const noexcept -> uint64_t {
+            return total.load(std::memory_order_relaxed);
+        }
+
+        inline auto min() const noexcept -> uint64_t {
+            return count() == 0 ? 0 : lowest.load(std::memory_order_relaxed);
+        }
+
+        inline auto max() const noexcept -> uint64_t {
+            return highest.load(std::memory_order_relaxed);
+        }
+
+        inline auto avg() const noexcept -> double {
+            auto c = count();
+            return c == 0 ? 0 : double(sum.load(std::memory_order_relaxed)) / c;
+        }
+
+        // nearest-rank percentile, reported as the upper bound of its bucket clamped to [min, max]
+        auto percentile(double percent) const noexcept -> uint64_t {
+            uint64_t counted = 0;
+            for (auto &b : buckets) {
+                counted += b.load(std::memory_order_relaxed);
+            }
+
+            if (counted == 0) {
+                return 0;
+            }
+
+            auto rank = std::max(uint64_t(1), uint64_t(std::ceil(percent / 100 * counted)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank) {
+                    return std::max(min(), std::min(upper_of(i), max()));
+                }
+            }
+            return max();
+        }
+
+        // non-empty buckets as [upper, count] pairs, which can be merged by a later reader
+        auto to_json(std::ostream &os) const -> void {
+            os << "{\"count\": " << count() << ", "
+               << "\"min\": " << min() << ", "
+               << "\"max\": " << max() << ", "
+               << "\"avg\": " << avg() << ", "
+               << "\"p50\": " << percentile(50) << ", "
+               << "\"p90\": " << percentile(90) << ", "
+               << "\"p99\": " << percentile(99) << ", "
+               << "\"p999\": " << percentile(99.9) << ", "
+               << "\"p9999\": " << percentile(99.99) << ", "
+               << "\"buckets\": [";
+
+            bool first = true;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                auto c = buckets[i].load(std::memory_order_relaxed);
+                if (c != 0) {
+                    os << (first ? "" : ", ") << "[" << upper_of(i) << ", " << c << "]";
+                    first = false;
+                }
+            }
+            os << "]}";
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> lowest{std::numeric_limits<uint64_t>::max()};
+        std::atomic<uint64_t> highest{0};
+
+        // only the owning thread writes, so a load and a store is enough
+        static inline auto bump(std::atomic<uint64_t> &a, uint64_t v) noexcept -> void {
+            a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+    };
+}
+#endif
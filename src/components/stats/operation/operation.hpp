@@ -4,6 +4,8 @@
 #include "config/config.hpp"
 #include "misc/misc.hpp"
 
+#include <memory>
+
 namespace DiStore::Stats {
     enum class DiStoreOperationOps {
         Put,
@@ -16,8 +18,8 @@ namespace DiStore::Stats {
     class Operation {
     public:
         friend StatsCollector;
-        Operation(size_t batch_size)
-            :batch(batch_size) {}
+        Operation()
+            : histograms(new Histogram[OPS]) {}
         ~Operation() = default;
 
         inline auto begin(DiStoreOperationOps op) noexcept -> void {
@@ -32,14 +34,7 @@ namespace DiStore::Stats {
             pair.second = std::chrono::steady_clock::now();
 
             auto diff = pair.second - pair.first;
-            auto span = double(std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
-            auto &tmp_arr = tmp[op];
-            tmp_arr.push_back(span);
-
-            if (tmp_arr.size() == batch) {
-                results[op].push_back(Misc::avg(tmp_arr));
-                tmp_arr.clear();
-            }
+            histograms[size_t(op)].record(std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count());
 #endif
         }
 
@@ -47,30 +42,25 @@ namespace DiStore::Stats {
 #ifdef __STATS__
             for (auto &k : ops_table) {
                 std::cout << ">> Operation " << decode_breakdown(k) << ": ";
-                auto &arr = results[k];
-                std::sort(arr.begin(), arr.end(), std::greater<>());
-                std::cout << "avg: " << Misc::avg(arr) << "ns, ";
-                std::cout << "p50: " << Misc::p50(arr) << "ns, ";
-                std::cout << "p90: " << Misc::p90(arr) << "ns, ";
-                std::cout << "p99: " << Misc::p99(arr) << "ns\n";
+                auto &h = histograms[size_t(k)];
+                std::cout << "avg: " << h.avg() << "ns, ";
+                std::cout << "p50: " << h.percentile(50) << "ns, ";
+                std::cout << "p90: " << h.percentile(90) << "ns, ";
+                std::cout << "p99: " << h.percentile(99) << "ns, ";
+                std::cout << "p999: " << h.percentile(99.9) << "ns\n";
             }
 #endif
         }
 
         auto submit(StatsCollector &collector) noexcept -> void {
             for (auto &k : ops_table) {
-                auto &arr = results[k];
-                std::sort(arr.begin(), arr.end(), std::greater<>());
-                collector.submit(decode_breakdown(k),
-                                 {Misc::avg(arr), Misc::p50(arr),
-                                  Misc::p90(arr), Misc::p99(arr)});
-            }            
+                collector.submit(decode_breakdown(k), histograms[size_t(k)]);
+            }
         }
 
         auto clear() noexcept -> void {
             for (auto &k : ops_table) {
-                results[k].clear();
-                tmp[k].clear();
+                histograms[size_t(k)].clear();
             }
         }
     private:
@@ -85,9 +75,10 @@ namespace DiStore::Stats {
             DiStoreOperationOps::Delete,
         };
 
-        const size_t batch;
-        std::unordered_map<DiStoreOperationOps, std::vector<double>> results;
-        std::unordered_map<DiStoreOperationOps, std::vector<double>> tmp;
+        constexpr static size_t OPS = size_t(DiStoreOperationOps::Delete) + 1;
+
+        // indexed by op, too large to live on a worker's stack
+        std::unique_ptr<Histogram[]> histograms;
         std::unordered_map<DiStoreOperationOps, SteadyTimePair> spans;
 
         auto decode_breakdown(DiStoreOperationOps op) -> std::string {
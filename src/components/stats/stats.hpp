@@ -1,5 +1,6 @@
 #ifndef __DISTORE__STATS__STATS__
 #define __DISTORE__STATS__STATS__
+#include "stats/histogram/histogram.hpp"
 #include "misc/misc.hpp"
 #include "debug/debug.hpp"
 
@@ -8,59 +9,58 @@
 #include <algorithm>
 #include <numeric>
 #include <unordered_map>
+#include <map>
 namespace DiStore::Stats {
     struct LatStats {
+        uint64_t count;
         double avg;
-        double p50;
-        double p90;
-        double p99;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t p9999;
+        uint64_t max;
 
         LatStats() = default;
-        LatStats(double avg_, double p50_, double p90_, double p99_)
-            : avg(avg_),
-              p50(p50_),
-              p90(p90_),
-              p99(p99_) {}
+        LatStats(const Histogram &h)
+            : count(h.count()),
+              avg(h.avg()),
+              p50(h.percentile(50)),
+              p90(h.percentile(90)),
+              p99(h.percentile(99)),
+              p999(h.percentile(99.9)),
+              p9999(h.percentile(99.99)),
+              max(h.max()) {}
         ~LatStats() = default;
     };
 
+    /*
+     * Accumulates the histograms submitted by Operation or Breakdown. Collectors of different
+     * threads are merged into one before reporting, so tails are taken over all samples
+     * rather than averaged over threads
+     */
     class StatsCollector {
     public:
         StatsCollector() = default;
         ~StatsCollector() = default;
 
-        inline auto submit(const std::string &op, LatStats &&stats) -> void {
-            lats[op].push_back(std::move(stats));
+        inline auto submit(const std::string &op, const Histogram &histogram) -> void {
+            lats[op].merge(histogram);
+        }
+
+        auto merge(const StatsCollector &other) -> void {
+            for (const auto &[k, v] : other.lats) {
+                lats[k].merge(v);
+            }
         }
 
         auto get_summarized() const noexcept -> std::vector<std::pair<std::string, LatStats>> {
             std::vector<std::pair<std::string, LatStats>> ret;
             for (const auto &[k, v] : lats) {
-                std::vector<double> avg_tmp;
-                std::vector<double> p50_tmp;
-                std::vector<double> p90_tmp;
-                std::vector<double> p99_tmp;
-                LatStats stats;
-                avg_tmp.reserve(v.size());
-                p50_tmp.reserve(v.size());
-                p90_tmp.reserve(v.size());
-                p99_tmp.reserve(v.size());
-
-                for (const auto &n : v) {
-                    avg_tmp.push_back(n.avg);
-                    p50_tmp.push_back(n.p50);
-                    p90_tmp.push_back(n.p90);
-                    p99_tmp.push_back(n.p99);                    
+                if (v.count() != 0) {
+                    ret.emplace_back(k, LatStats(v));
                 }
-
-                stats.avg = Misc::avg(avg_tmp);
-                stats.p50 = Misc::avg(p50_tmp);
-                stats.p90 = Misc::avg(p90_tmp);
-                stats.p99 = Misc::avg(p99_tmp);
-
-                ret.push_back({k, stats});
             }
-
             return ret;
         }
 
@@ -69,14 +69,41 @@ namespace DiStore::Stats {
 
             for (const auto &v : ret) {
                 std::cout << v.first << ": ";
+                std::cout << "count: " << v.second.count << ", ";
                 std::cout << "avg: " << v.second.avg << ", ";
                 std::cout << "p50: " << v.second.p50 << ", ";
                 std::cout << "p90: " << v.second.p90 << ", ";
-                std::cout << "p99: " << v.second.p99 << "\n";
+                std::cout << "p99: " << v.second.p99 << ", ";
+                std::cout << "p999: " << v.second.p999 << ", ";
+                std::cout << "p9999: " << v.second.p9999 << ", ";
+                std::cout << "max: " << v.second.max << "\n";
+            }
+        }
+
+        auto to_json(std::ostream &os) const -> void {
+            os << "{";
+            bool first = true;
+            for (const auto &[k, v] : lats) {
+                if (v.count() == 0) {
+                    continue;
+                }
+                os << (first ? "" : ", ") << "\"" << k << "\": ";
+                v.to_json(os);
+                first = false;
+            }
+            os << "}\n";
+        }
+
+        auto to_csv(std::ostream &os) const -> void {
+            os << "op,count,avg,p50,p90,p99,p999,p9999,max\n";
+            for (const auto &[k, v] : get_summarized()) {
+                os << k << "," << v.count << "," << v.avg << "," << v.p50 << "," << v.p90 << ","
+                   << v.p99 << "," << v.p999 << "," << v.p9999 << "," << v.max << "\n";
             }
         }
     private:
-        std::unordered_map<std::string, std::vector<LatStats>> lats;
+        // ordered so that exports are stable across runs
+        std::map<std::string, Histogram> lats;
     };
 }
 #endif
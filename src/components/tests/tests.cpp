@@ -1 +1,14 @@
 #include "tests.hpp"
+
+namespace DiStore::Tests {
+    auto make_loopback_node(size_t mem_cap, int nodes, uint64_t latency)
+        -> std::unique_ptr<Cluster::ComputeNode>
+    {
+        auto node = Cluster::ComputeNode::make_loopback_compute_node(mem_cap, latency, nodes);
+        if (node == nullptr || !node->register_thread()) {
+            Debug::error("Failed to set up a loopback compute node\n");
+            return nullptr;
+        }
+        return node;
+    }
+}
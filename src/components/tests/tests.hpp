@@ -1,4 +1,62 @@
 #ifndef __DISTORE__TESTS__TESTS__
 #define __DISTORE__TESTS__TESTS__
+#include "node/compute_node/compute_node.hpp"
+#include "workload/workload.hpp"
+#include "debug/debug.hpp"
 
+#include <string>
+#include <memory>
+
+namespace DiStore::Tests {
+    // keys and values of test pairs are both the zero-padded i
+    inline auto key_of(size_t i) -> std::string {
+        return Workload::make_key(i);
+    }
+
+    /*
+     * A loopback compute node over two memory nodes, so that neighbouring data nodes
+     * often live on different ones. Each RDMA completion is delayed by latency
+     * nanoseconds. The calling thread is registered
+     */
+    auto make_loopback_node(size_t mem_cap = 2048UL << 20, int nodes = 2, uint64_t latency = 0)
+        -> std::unique_ptr<Cluster::ComputeNode>;
+
+    /*
+     * Keys i in [0, total) with keep(i) must be found in order by a range from the first
+     * key and by get, and no other key may be found
+     */
+    template<typename Keep>
+    auto check_keys(Cluster::ComputeNode *node, size_t total, Keep keep) -> bool {
+        size_t expect = 0;
+        for (auto it = node->range(key_of(0)); it.valid(); it.next(), ++expect) {
+            while (expect < total && !keep(expect)) {
+                ++expect;
+            }
+
+            if (it.key() != key_of(expect) || it.value() != key_of(expect)) {
+                Debug::error("%s is found, but %lu is expected\n", std::string(it.key()).c_str(), expect);
+                return false;
+            }
+        }
+
+        while (expect < total && !keep(expect)) {
+            ++expect;
+        }
+
+        if (expect != total) {
+            Debug::error("Range stops at %lu\n", expect);
+            return false;
+        }
+
+        for (size_t i = 0; i < total; i++) {
+            auto k = key_of(i);
+            auto v = node->get(k, nullptr);
+            if (v.has_value() != keep(i) || (v && *v != k)) {
+                Debug::error("%s is %s\n", k.c_str(), v ? "found" : "missing");
+                return false;
+            }
+        }
+        return true;
+    }
+}
 #endif
@@ -5,6 +5,7 @@
 #include <random>
 #include <memory>
 #include <stdexcept>
+#include <string>
 
 namespace DiStore::Workload {
     namespace Constants {
@@ -12,6 +13,20 @@ namespace DiStore::Workload {
         static constexpr size_t KEY_SIZE = 16;
     };
 
+    // write k zero-padded into a buffer of KEY_SIZE bytes, so that keys ascend as k does
+    inline auto pad_key(uint64_t k, char *key) noexcept -> void {
+        for (auto i = Constants::KEY_SIZE; i > 0; i--) {
+            key[i - 1] = '0' + k % 10;
+            k /= 10;
+        }
+    }
+
+    inline auto make_key(uint64_t k) -> std::string {
+        std::string key(Constants::KEY_SIZE, '0');
+        pad_key(k, key.data());
+        return key;
+    }
+
     enum class WorkloadType {
         Uniform,
         Zipf,
@@ -163,42 +178,48 @@ namespace DiStore::Workload {
         ~YCSBWorkload() = default;
 
         inline auto next() -> std::pair<YCSBOperation, std::string> {
-            auto k = std::to_string(load_generator->next_unrecorded());
-            k.insert(0, Constants::KEY_SIZE - k.size(), '0');
+            std::string k(Constants::KEY_SIZE, '0');
+            auto op = next(k.data());
+            return {op, k};
+        }
+
+        // write the zero-padded key into a buffer of KEY_SIZE bytes without allocating
+        inline auto next(char *key) -> YCSBOperation {
+            pad_key(load_generator->next_unrecorded(), key);
 
             auto op = op_generator->next_unrecorded();
 
             switch (type) {
             case YCSBWorkloadType::YCSB_A:
                 if (op < 49) {
-                    return {YCSBOperation::Update, k};
+                    return YCSBOperation::Update;
                 } else {
-                    return {YCSBOperation::Search, k};
+                    return YCSBOperation::Search;
                 }
             case YCSBWorkloadType::YCSB_B:
                 if (op < 4) {
-                    return {YCSBOperation::Update, k};
+                    return YCSBOperation::Update;
                 } else {
-                    return {YCSBOperation::Search, k};
+                    return YCSBOperation::Search;
                 }
             case YCSBWorkloadType::YCSB_C:
-                return {YCSBOperation::Search, k};
+                return YCSBOperation::Search;
             case YCSBWorkloadType::YCSB_D:
                 if (op < 4) {
-                    return {YCSBOperation::Insert, k};
+                    return YCSBOperation::Insert;
                 } else {
-                    return {YCSBOperation::Search, k};
+                    return YCSBOperation::Search;
                 }
             case YCSBWorkloadType::YCSB_E:
                 if (op < 4) {
-                    return {YCSBOperation::Insert, k};
+                    return YCSBOperation::Insert;
                 } else {
-                    return {YCSBOperation::Scan, k};
+                    return YCSBOperation::Scan;
                 }
             case YCSBWorkloadType::YCSB_L:
-                return {YCSBOperation::Insert, k};
+                return YCSBOperation::Insert;
             case YCSBWorkloadType::YCSB_R:
-                return {YCSBOperation::Scan, k};
+                return YCSBOperation::Scan;
             default:
                 throw std::invalid_argument("Unkown YCSB workload type");
             }
@@ -4,6 +4,6 @@ using namespace DiStore::Memory;
 
 auto main() -> int {
     ComputeNodeAllocator allocator;
-    allocator.allocate(1064);
+    allocator.allocate(1064, 0);
     return 0;
 }
@@ -0,0 +1,93 @@
+#include "search_layer/btree/btree.hpp"
+#include "debug/debug.hpp"
+
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using namespace DiStore::SearchLayer;
+
+// values are fake node pointers carrying the index of their key
+static auto as_value(size_t i) -> SkipListNode * {
+    return reinterpret_cast<SkipListNode *>((i + 1) << 1);
+}
+
+static auto check(const BTree &tree, const std::map<std::pair<uint64_t, uint64_t>, SkipListNode *> &truth,
+                  std::mt19937_64 &gen) -> bool {
+    for (int i = 0; i < 100000; i++) {
+        Anchor k{gen() % 1024, gen()};
+        auto it = truth.upper_bound({k.hi, k.lo});
+        auto expect = it == truth.begin() ? nullptr : std::prev(it)->second;
+        auto got = tree.floor(k);
+        if (got != expect) {
+            Debug::error("Floor of %lx:%lx is %p, but %p is expected\n", k.hi, k.lo, got, expect);
+            return false;
+        }
+    }
+    return true;
+}
+
+auto main() -> int {
+    const int threads = 8;
+    const size_t per_thread = 50000;
+
+    std::vector<Anchor> keys;
+    std::mt19937_64 gen(7);
+    for (size_t i = 0; i < threads * per_thread; i++) {
+        // a narrow hi part so that keys share the first word
+        keys.push_back({gen() % 1024, gen()});
+    }
+
+    BTree tree;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < keys.size(); i += threads) {
+                tree.insert(keys[i], as_value(i));
+                if (!tree.lookup(keys[i])) {
+                    Debug::error("Key %lu is lost after insertion\n", i);
+                    exit(-1);
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    std::map<std::pair<uint64_t, uint64_t>, SkipListNode *> truth;
+    for (size_t i = 0; i < keys.size(); i++) {
+        truth.emplace(std::make_pair(keys[i].hi, keys[i].lo), as_value(i));
+    }
+
+    if (!check(tree, truth, gen))
+        return -1;
+    Debug::info("%lu keys are inserted, the height is %d\n", truth.size(), tree.height());
+
+    workers.clear();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < keys.size(); i += 2 * threads) {
+                tree.erase(keys[i], as_value(i));
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    for (size_t i = 0; i < keys.size(); i += 2 * threads) {
+        for (int t = 0; t < threads; t++) {
+            truth.erase({keys[i + t].hi, keys[i + t].lo});
+        }
+    }
+
+    if (!check(tree, truth, gen))
+        return -1;
+    Debug::info("%lu keys are left\n", truth.size());
+    return 0;
+}
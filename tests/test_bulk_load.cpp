@@ -0,0 +1,60 @@
+#include "tests/tests.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+// even keys are bulk loaded, then odd keys are put into the loaded nodes by two threads
+auto main() -> int {
+    const size_t total = 200000;
+    auto node = Tests::make_loopback_node();
+    if (!node) {
+        return -1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (size_t i = 0; i < total; i += 2) {
+        pairs.emplace_back(key_of(i), key_of(i));
+    }
+
+    if (node->bulk_load(pairs.begin(), pairs.end(), 2)) {
+        Debug::error("Bulk load accepts a fill factor of 2\n");
+        return -1;
+    }
+
+    auto even = [](size_t i) { return i % 2 == 0; };
+    if (!node->bulk_load(pairs.begin(), pairs.end()) || !Tests::check_keys(node.get(), total, even)) {
+        return -1;
+    }
+
+    if (node->bulk_load(pairs.begin(), pairs.end())) {
+        Debug::error("Bulk load fills a loaded compute node\n");
+        return -1;
+    }
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; t++) {
+        writers.emplace_back([&, t] {
+            node->register_thread();
+            for (size_t i = 1 + 2 * t; i < total; i += 4) {
+                if (!node->put(key_of(i), key_of(i), nullptr)) {
+                    Debug::error("Putting %lu failed\n", i);
+                    exit(-1);
+                }
+            }
+        });
+    }
+
+    for (auto &w : writers) {
+        w.join();
+    }
+
+    if (!Tests::check_keys(node.get(), total, [](size_t) { return true; })) {
+        return -1;
+    }
+
+    Debug::info("Bulk load passed\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "tests/tests.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+/*
+ * Many threads first update the same seeded keys, so that their nodes adapt to deep
+ * combining, and then put the keys in between, so that winners of those nodes morph
+ * and split them with more requests than the defaults would take. A long RDMA latency
+ * keeps winners holding their locks while waiters queue up, even on a single core
+ */
+auto main() -> int {
+    const size_t total = 4096;
+    const size_t stride = 64;
+    const size_t waves = 4;
+    const int rounds = 2;
+    const int threads = 32;
+    auto node = Tests::make_loopback_node(2048UL << 20, 2, 1000000);
+    if (!node) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < total; i += stride) {
+        node->put(key_of(i), key_of(i), nullptr);
+    }
+
+    std::atomic<int> ready = 0, updated = 0;
+    std::vector<Stats::StatsCollector> collectors(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            node->register_thread();
+            Stats::Breakdown breakdown;
+            ++ready;
+            while (ready != threads)
+                ;
+
+            // each wave puts a slice of every gap between the seeds
+            for (size_t w = 0; w < waves; w++) {
+                for (int r = 0; r < rounds; r++) {
+                    for (size_t i = 0; i < total; i += stride) {
+                        node->update(key_of(i), key_of(i), nullptr);
+                    }
+                }
+                ++updated;
+                while (updated != threads * int(w + 1))
+                    ;
+
+                for (size_t i = t; i < total; i += threads) {
+                    if (i % stride != 0 && i % stride * waves / stride == w &&
+                        !node->put(key_of(i), key_of(i), &breakdown)) {
+                        Debug::error("Failed to put %lu\n", i);
+                        exit(-1);
+                    }
+                }
+            }
+            breakdown.submit(collectors[t]);
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    for (int t = 1; t < threads; t++) {
+        collectors[0].merge(collectors[t]);
+    }
+
+    // combined requests are sampled by the breakdown, see __BREAKDOWN__
+    uint64_t deepest = 0;
+    for (auto &[op, stats] : collectors[0].get_summarized()) {
+        if (op == "DataLayerCombined") {
+            deepest = stats.max;
+        }
+    }
+
+    if (deepest <= Concurrency::Constants::COMBINING_DEPTH) {
+        Debug::error("At most %lu requests are combined\n", deepest);
+        return -1;
+    }
+    Debug::info("Up to %lu requests are combined\n", deepest);
+
+    if (!Tests::check_keys(node.get(), total, [](size_t) { return true; }))
+        return -1;
+    Debug::info("Combining passed\n");
+    return 0;
+}
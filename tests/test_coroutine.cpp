@@ -0,0 +1,120 @@
+#include "tests/tests.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+static size_t failures = 0;
+
+static auto check_value(Cluster::ComputeNode *node, std::string key, std::string expect)
+    -> Coroutine::Task<void>
+{
+    auto v = co_await node->co_get(key);
+    if (!v || *v != expect) {
+        Debug::error("%s is %s\n", key.c_str(), v ? v->c_str() : "missing");
+        ++failures;
+    }
+}
+
+static auto check_scan(Cluster::ComputeNode *node, std::string key, size_t count, uint64_t expect)
+    -> Coroutine::Task<void>
+{
+    if (auto n = co_await node->co_scan(key, count); n != expect) {
+        Debug::error("Scanning %lu from %s gives %lu\n", count, key.c_str(), n);
+        ++failures;
+    }
+}
+
+// async puts of shuffled keys morph and split nodes, then gets, updates and scans follow
+auto main() -> int {
+    const size_t total = 100000;
+    auto node = Tests::make_loopback_node();
+    if (!node) {
+        return -1;
+    }
+
+    // the smallest key goes first, others are never put to the head
+    node->put(key_of(0), key_of(0), nullptr);
+
+    std::vector<size_t> keys;
+    for (size_t i = 1; i < total; i++) {
+        keys.push_back(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(13));
+
+    auto on_done = [](bool succeed, std::optional<std::string>) {
+        if (!succeed) {
+            ++failures;
+        }
+    };
+
+    auto &epochs = Epoch::EpochManager::instance();
+    auto first = epochs.current();
+    size_t most = 0;
+    for (auto i : keys) {
+        node->async_put(key_of(i), key_of(i), on_done);
+        // submitted operations queue up for slots, so the window stays full
+        node->poll_async();
+        most = std::max(most, epochs.pending());
+    }
+
+    // chunks replaced by morphs and splits are freed while coroutines are still in flight
+    if (epochs.current() == first || most > 4 * Epoch::Constants::COLLECT_THRESHOLD) {
+        Debug::error("Epochs %lu -> %lu, %lu retired chunks are held\n", first, epochs.current(), most);
+        return -1;
+    }
+    node->wait_async();
+
+    if (failures != 0 || !Tests::check_keys(node.get(), total, [](size_t) { return true; })) {
+        Debug::error("Async puts failed\n");
+        return -1;
+    }
+
+    for (auto i : keys) {
+        if (i % 2 == 0) {
+            node->async_update(key_of(i), key_of(i + total), on_done);
+        } else {
+            node->async_get(key_of(i), [i](bool succeed, std::optional<std::string> v) {
+                if (!succeed || *v != key_of(i)) {
+                    ++failures;
+                }
+            });
+        }
+        node->poll_async();
+    }
+    node->wait_async();
+
+    for (auto i : keys) {
+        node->spawn_async(check_value(node.get(), key_of(i), key_of(i % 2 ? i : i + total)));
+        node->poll_async();
+    }
+
+    node->spawn_async(check_scan(node.get(), key_of(100), 50, 50));
+    node->spawn_async(check_scan(node.get(), key_of(total - 10), 50, 10));
+    // across many nodes of all types
+    node->spawn_async(check_scan(node.get(), key_of(total / 2), 5000, 5000));
+    node->wait_async();
+
+    if (failures != 0) {
+        Debug::error("%lu async operations failed\n", failures);
+        return -1;
+    }
+
+    // a key smaller than every key is rejected rather than put to the head
+    auto smallest = std::string(Workload::Constants::KEY_SIZE, '/');
+    bool rejected = false;
+    node->async_put(smallest, smallest, [&](bool succeed, std::optional<std::string>) {
+        rejected = !succeed;
+    });
+    node->wait_async();
+    if (!rejected || node->get(smallest, nullptr)) {
+        Debug::error("A key below the head is put\n");
+        return -1;
+    }
+
+    Debug::info("Coroutine passed\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "stats/stats.hpp"
+#include "debug/debug.hpp"
+
+#include <thread>
+#include <random>
+#include <sstream>
+
+using namespace DiStore;
+
+// a reported value must be within the relative error of its bucket
+static auto close(uint64_t reported, uint64_t exact) -> bool {
+    auto diff = reported > exact ? reported - exact : exact - reported;
+    return diff <= exact / (Stats::Histogram::SUB_BUCKETS / 2) + 1;
+}
+
+auto main() -> int {
+    for (uint64_t v = 0; v < (1UL << 20); v += 7) {
+        auto b = Stats::Histogram::bucket_of(v);
+        if (Stats::Histogram::upper_of(b) < v || (b != 0 && Stats::Histogram::upper_of(b - 1) >= v)) {
+            Debug::error("%lu falls in a wrong bucket %lu\n", v, b);
+            return -1;
+        }
+    }
+
+    if (Stats::Histogram::bucket_of(~0UL) != Stats::Histogram::BUCKETS - 1) {
+        Debug::error("The largest value is out of buckets\n");
+        return -1;
+    }
+
+    // each thread records a heavy-tailed distribution, whose exact percentiles are known after sorting
+    const size_t threads = 4;
+    const size_t samples = 250000;
+    std::vector<std::vector<uint64_t>> recorded(threads);
+    Stats::StatsCollector collectors[threads];
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t);
+            std::lognormal_distribution<> dist(8, 1.5);
+            Stats::Histogram histogram;
+            for (size_t i = 0; i < samples; i++) {
+                auto v = uint64_t(dist(gen));
+                histogram.record(v);
+                recorded[t].push_back(v);
+            }
+            collectors[t].submit("Op", histogram);
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    Stats::StatsCollector merged;
+    std::vector<uint64_t> all;
+    for (size_t t = 0; t < threads; t++) {
+        merged.merge(collectors[t]);
+        all.insert(all.end(), recorded[t].begin(), recorded[t].end());
+    }
+    std::sort(all.begin(), all.end());
+
+    auto summarized = merged.get_summarized();
+    if (summarized.size() != 1 || summarized[0].second.count != all.size()) {
+        Debug::error("Merged count mismatches\n");
+        return -1;
+    }
+
+    auto &stats = summarized[0].second;
+    std::pair<uint64_t, double> checks[] = {
+        {stats.p50, 50}, {stats.p90, 90}, {stats.p99, 99}, {stats.p999, 99.9}, {stats.p9999, 99.99},
+    };
+    for (auto &[reported, p] : checks) {
+        auto exact = Misc::percentile(all, p);
+        if (!close(reported, exact)) {
+            Debug::error("p%.2f is %lu, but %lu is expected\n", p, reported, exact);
+            return -1;
+        }
+    }
+
+    if (stats.max != all.back() || std::abs(stats.avg - Misc::avg(all)) > 1) {
+        Debug::error("Max or avg mismatches\n");
+        return -1;
+    }
+
+    std::stringstream json, csv;
+    merged.to_json(json);
+    merged.to_csv(csv);
+    if (json.str().find("\"Op\": {\"count\": 1000000") == std::string::npos ||
+        csv.str().find("Op,1000000,") == std::string::npos) {
+        Debug::error("Exported stats are malformed\n");
+        return -1;
+    }
+
+    merged.summarize();
+    Debug::info("Histogram passed\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "rdma_util/rdma_util.hpp"
+#include "cmd_parser/cmd_parser.hpp"
+#include "debug/debug.hpp"
+
+#include <chrono>
+#include <cstring>
+
+using namespace DiStore;
+using namespace DiStore::RDMAUtil;
+using namespace CmdParser;
+
+auto main(int argc, char *argv[]) -> int {
+    Parser parser;
+    parser.add_option<size_t>("--size", "-s", 1 << 20);
+    parser.add_option<uint64_t>("--latency", "-l", 2000);
+
+    parser.parse(argc, argv);
+    auto size = parser.get_as<size_t>("--size").value();
+    auto latency = parser.get_as<uint64_t>("--latency").value();
+
+    auto [region, status] = LoopbackRegion::make_loopback_region(size);
+    if (status != Status::Ok) {
+        Debug::error("Failed to map loopback region: %s\n", decode_rdma_status(status).c_str());
+        return -1;
+    }
+
+    auto buffer = new byte_t[1024];
+    auto ctx = RDMAContext::make_loopback_context(buffer, 1024, region->base, size, latency);
+
+    // single write then read back
+    const char *msg = "hello loopback";
+    auto remote = region->base + 128;
+    ctx->post_write(remote, (const uint8_t *)msg, strlen(msg) + 1);
+    if (auto [wc, ret] = ctx->poll_one_completion(); wc != nullptr) {
+        Debug::error("Write failed with %s\n", ibv_wc_status_str(wc->status));
+        return -1;
+    }
+
+    if (strcmp((char *)region->base + 128, msg) != 0) {
+        Debug::error("Remote memory is not updated\n");
+        return -1;
+    }
+
+    memset(buffer, 0, 1024);
+    auto start = std::chrono::steady_clock::now();
+    ctx->post_read(remote, strlen(msg) + 1, 512);
+    ctx->poll_one_completion();
+    auto end = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    if (strcmp((char *)buffer + 512, msg) != 0) {
+        Debug::error("Read returns %s\n", (char *)buffer + 512);
+        return -1;
+    }
+
+    if ((uint64_t)elapsed < latency) {
+        Debug::error("Completion arrives after %ldns, earlier than %luns\n", elapsed, latency);
+        return -1;
+    }
+
+    // a chain of 4 writes with only the last one signaled
+    for (int i = 0; i < 4; i++) {
+        memset(buffer + i * 64, 'a' + i, 64);
+    }
+
+    ibv_send_wr *wrs[4];
+    for (int i = 0; i < 4; i++) {
+        wrs[i] = ctx->next_send_wr(i, 64, i * 64, region->base + 4096 + i * 64);
+        if (i != 0) {
+            wrs[i - 1]->send_flags = 0;
+            wrs[i - 1]->next = wrs[i];
+        }
+    }
+
+    ctx->post_batch_write(wrs[0]);
+    if (auto [wc, ret] = ctx->poll_one_completion(); wc != nullptr) {
+        Debug::error("Batch write failed with %s\n", ibv_wc_status_str(wc->status));
+        return -1;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (region->base[4096 + i * 64 + 63] != 'a' + i) {
+            Debug::error("Batch write %d is lost\n", i);
+            return -1;
+        }
+    }
+
+    Debug::info("Loopback transport works, read latency %ldns\n", elapsed);
+    delete[] buffer;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "tests/tests.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+// keys[i] is expected to be found iff i < total
+static auto check(Cluster::ComputeNode *node, const std::vector<std::string> &keys, size_t total,
+                  Stats::Breakdown *breakdown) -> bool
+{
+    auto values = node->multi_get(keys, breakdown);
+    if (values.size() != keys.size()) {
+        Debug::error("%lu values are returned for %lu keys\n", values.size(), keys.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto present = std::stoul(keys[i]) < total;
+        if (values[i].has_value() != present || (present && *values[i] != keys[i])) {
+            Debug::error("%s is %s\n", keys[i].c_str(), values[i] ? "found" : "missing");
+            return false;
+        }
+    }
+    return true;
+}
+
+// batches of one data node read per distinct node
+static auto fetched(Stats::Breakdown &breakdown) -> uint64_t {
+    Stats::StatsCollector collector;
+    breakdown.submit(collector);
+    breakdown.clear();
+    for (const auto &[k, v] : collector.get_summarized()) {
+        if (k == "DataLayerFetch") {
+            return v.count;
+        }
+    }
+    return 0;
+}
+
+auto main() -> int {
+    const size_t total = 50000;
+    auto node = Tests::make_loopback_node();
+    if (!node) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        node->put(key_of(i), key_of(i), nullptr);
+    }
+
+    if (!node->multi_get(std::vector<std::string>(), nullptr).empty()) {
+        Debug::error("Keys are made up\n");
+        return -1;
+    }
+
+    // 64 neighbouring keys repeated 8 times live in a few data nodes, which fit one batch
+    std::vector<std::string> keys;
+    for (int r = 0; r < 8; r++) {
+        for (size_t i = 1000; i < 1064; i++) {
+            keys.push_back(key_of(i));
+        }
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(3));
+
+    Stats::Breakdown breakdown;
+    if (!check(node.get(), keys, total, &breakdown)) {
+        return -1;
+    }
+#ifdef __BREAKDOWN__
+    if (auto batches = fetched(breakdown); batches != 1) {
+        Debug::error("Duplicated keys take %lu batches\n", batches);
+        return -1;
+    }
+#endif
+
+    // keys over the whole range, missing ones and duplicates need several batches on both memory nodes
+    keys.clear();
+    for (size_t i = 0; i < total + 1000; i += 37) {
+        keys.push_back(key_of(i));
+        keys.push_back(key_of(total - 1 - i % total));
+    }
+    std::vector<std::string> again(keys.begin(), keys.begin() + keys.size() / 2);
+    keys.insert(keys.end(), again.begin(), again.end());
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(5));
+
+    if (!check(node.get(), keys, total, &breakdown)) {
+        return -1;
+    }
+#ifdef __BREAKDOWN__
+    if (auto batches = fetched(breakdown); batches < 2) {
+        Debug::error("Keys over the whole range take %lu batch\n", batches);
+        return -1;
+    }
+#endif
+
+    Debug::info("Multi-get passed\n");
+    return 0;
+}
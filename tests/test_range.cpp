@@ -0,0 +1,124 @@
+#include "tests/tests.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+// keys of the even numbers in [from, to) must come out one by one
+static auto check(Cluster::ComputeNode *node, size_t from, size_t to, size_t depth) -> bool {
+    auto expect = from + from % 2;
+    for (auto it = node->range(key_of(from), key_of(to), depth); it.valid(); it.next()) {
+        if (it.key() != key_of(expect) || it.value() != key_of(expect)) {
+            Debug::error("%s is found in [%lu, %lu), but %lu is expected\n",
+                         std::string(it.key()).c_str(), from, to, expect);
+            return false;
+        }
+
+        // sync operations do not disturb the outstanding window
+        if (expect % 64 == 0 && !node->get(key_of(expect), nullptr)) {
+            Debug::error("%lu is lost\n", expect);
+            return false;
+        }
+        expect += 2;
+    }
+
+    if (expect < to) {
+        Debug::error("Range [%lu, %lu) stops at %lu\n", from, to, expect);
+        return false;
+    }
+    return true;
+}
+
+// ranges of shuffled even keys, then scans while odd keys are put concurrently
+auto main() -> int {
+    const size_t total = 100000;
+    auto node = Tests::make_loopback_node();
+    if (!node) {
+        return -1;
+    }
+
+    std::vector<size_t> keys;
+    for (size_t i = 0; i < total; i += 2) {
+        keys.push_back(i);
+    }
+    // the first key is the smallest so that no key goes to the head
+    std::shuffle(keys.begin() + 1, keys.end(), std::mt19937_64(7));
+    for (auto i : keys) {
+        node->put(key_of(i), key_of(i), nullptr);
+    }
+
+    for (size_t depth : {1, 4, 32}) {
+        if (!check(node.get(), 0, total, depth))
+            return -1;
+    }
+
+    std::mt19937_64 gen(11);
+    for (int i = 0; i < 1000; i++) {
+        auto from = gen() % total;
+        auto to = std::min(total, from + gen() % 500);
+        if (!check(node.get(), from, to, 1 + gen() % 16))
+            return -1;
+    }
+
+    byte_t values[100 * DataLayer::Constants::VALLEN];
+    if (node->scan(key_of(1001), 100, values, nullptr) != 100 ||
+        std::string((char *)values, DataLayer::Constants::VALLEN) != key_of(1002)) {
+        Debug::error("Scan from 1001 does not start at 1002\n");
+        return -1;
+    }
+
+    const size_t writers = 4;
+    std::atomic<size_t> done = 0;
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < writers; w++) {
+        threads.emplace_back([&, w] {
+            node->register_thread();
+            for (size_t i = 2 * w + 1; i < total; i += 2 * writers) {
+                node->put(key_of(i), key_of(i), nullptr);
+            }
+            ++done;
+        });
+    }
+
+    // even keys stay put while odd ones split their nodes, none of them may be skipped
+    while (done != writers) {
+        auto from = gen() % total;
+        auto expect = from + from % 2;
+        std::string last;
+        for (auto it = node->range(key_of(from)); it.valid(); it.next()) {
+            if (it.key() <= last) {
+                Debug::error("%s follows %s\n", std::string(it.key()).c_str(), last.c_str());
+                exit(-1);
+            }
+            last = it.key();
+
+            if (auto k = std::stoul(last); k % 2 == 0) {
+                if (k != expect) {
+                    Debug::error("%lu is found from %lu, but %lu is expected\n", k, from, expect);
+                    exit(-1);
+                }
+                expect += 2;
+            }
+        }
+
+        if (expect < total) {
+            Debug::error("Range from %lu stops at %lu\n", from, expect);
+            exit(-1);
+        }
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (!Tests::check_keys(node.get(), total, [](size_t) { return true; })) {
+        return -1;
+    }
+
+    Debug::info("Range passed\n");
+    return 0;
+}
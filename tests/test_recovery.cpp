@@ -0,0 +1,110 @@
+#include "tests/tests.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+static auto put_range(Cluster::ComputeNode *node, size_t from, size_t total, size_t step) -> void {
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 2; t++) {
+        writers.emplace_back([&, t] {
+            node->register_thread();
+            for (size_t i = from + t * step; i < total; i += 2 * step) {
+                if (!node->put(key_of(i), key_of(i), nullptr)) {
+                    Debug::error("Putting %lu failed\n", i);
+                    exit(-1);
+                }
+            }
+        });
+    }
+
+    for (auto &w : writers) {
+        w.join();
+    }
+}
+
+/*
+ * Even keys are bulk loaded and checkpointed, then splits by odd keys make most samples
+ * stale before each restart. The last restart follows a fresh checkpoint
+ */
+auto main() -> int {
+    const size_t total = 200000;
+    // chunks a node retired must not outlive it in the epoch manager, which would free them
+    // into the destroyed node later
+    auto &epochs = Epoch::EpochManager::instance();
+    auto held = epochs.pending();
+    auto gone = Tests::make_loopback_node();
+    if (!gone) {
+        return -1;
+    }
+    for (size_t i = 0; i < 20000; i++) {
+        gone->put(key_of(i), key_of(i), nullptr);
+    }
+    gone.reset();
+    if (epochs.pending() > held) {
+        Debug::error("%lu retired chunks are left behind by a destroyed node\n", epochs.pending() - held);
+        return -1;
+    }
+
+    // every restart fetches segments of its own, the crashed ones are never returned
+    auto first = Tests::make_loopback_node(16UL << 30);
+    if (!first) {
+        return -1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (size_t i = 0; i < total; i += 2) {
+        pairs.emplace_back(key_of(i), key_of(i));
+    }
+
+    if (!first->bulk_load(pairs.begin(), pairs.end())) {
+        return -1;
+    }
+    put_range(first.get(), 1, total / 2, 2);
+
+    auto second = Cluster::ComputeNode::recover_loopback_compute_node(*first);
+    if (!second || !second->register_thread() ||
+        !Tests::check_keys(second.get(), total, [&](size_t i) { return i % 2 == 0 || i < total / 2; })) {
+        return -1;
+    }
+
+    // chunks of the crashed node are rewritten and retired, which are not freed
+    put_range(second.get(), total / 2 + 1, total, 2);
+    for (size_t i = 0; i < total / 4; i += 3) {
+        if (!second->remove(key_of(i), nullptr)) {
+            Debug::error("Removing %lu failed\n", i);
+            return -1;
+        }
+    }
+
+    auto removed = [&](size_t i) { return i < total / 4 && i % 3 == 0; };
+    auto third = Cluster::ComputeNode::recover_loopback_compute_node(*second);
+    if (!third || !third->register_thread() ||
+        !Tests::check_keys(third.get(), total, [&](size_t i) { return !removed(i); })) {
+        return -1;
+    }
+
+    if (!third->checkpoint()) {
+        return -1;
+    }
+
+    auto fourth = Cluster::ComputeNode::recover_loopback_compute_node(*third);
+    if (!fourth || !fourth->register_thread() ||
+        !Tests::check_keys(fourth.get(), total, [&](size_t i) { return !removed(i); })) {
+        return -1;
+    }
+
+    // a compute node crashing before any data node is flushed leaves an empty chain
+    auto empty = Cluster::ComputeNode::make_loopback_compute_node(4UL << 30);
+    auto restarted = empty ? Cluster::ComputeNode::recover_loopback_compute_node(*empty) : nullptr;
+    if (!restarted || !restarted->register_thread() || !restarted->put(key_of(1), key_of(1), nullptr) ||
+        !restarted->get(key_of(1), nullptr)) {
+        Debug::error("Recovering an empty data layer failed\n");
+        return -1;
+    }
+
+    Debug::info("Recovery passed\n");
+    return 0;
+}
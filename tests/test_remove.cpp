@@ -0,0 +1,82 @@
+#include "tests/tests.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using Tests::key_of;
+
+// remove most keys so that underfull nodes are merged, then put them back
+auto main() -> int {
+    const size_t total = 200000;
+    const int threads = 4;
+    auto node = Tests::make_loopback_node();
+    if (!node) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        node->put(key_of(i), key_of(i), nullptr);
+    }
+    node->report_search_layer_stats();
+
+    for (size_t i = 1; i < total; i++) {
+        if (i % 4 != 0 && !node->remove(key_of(i), nullptr)) {
+            Debug::error("Failed to remove %lu\n", i);
+            return -1;
+        }
+    }
+
+    if (node->remove(key_of(1), nullptr)) {
+        Debug::error("A removed key is removed again\n");
+        return -1;
+    }
+
+    if (!Tests::check_keys(node.get(), total, [](size_t i) { return i % 4 == 0; }))
+        return -1;
+    node->report_search_layer_stats();
+
+    for (size_t i = 1; i < total; i++) {
+        if (i % 4 != 0) {
+            node->put(key_of(i), key_of(i), nullptr);
+        }
+    }
+
+    if (!Tests::check_keys(node.get(), total, [](size_t) { return true; }))
+        return -1;
+
+    // concurrent removals merge nodes that others are reading
+    std::atomic<int> ready = 0;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            node->register_thread();
+            ++ready;
+            while (ready != threads)
+                ;
+
+            for (size_t i = 1 + t; i < total; i += threads) {
+                if (i % 8 != 0 && !node->remove(key_of(i), nullptr)) {
+                    Debug::error("Failed to remove %lu\n", i);
+                    exit(-1);
+                }
+
+                if (!node->get(key_of(i - i % 8), nullptr)) {
+                    Debug::error("%lu is lost\n", i - i % 8);
+                    exit(-1);
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    if (!Tests::check_keys(node.get(), total, [](size_t i) { return i % 8 == 0; }))
+        return -1;
+    node->report_search_layer_stats();
+    Debug::info("Removal passed\n");
+    return 0;
+}
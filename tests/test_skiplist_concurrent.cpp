@@ -0,0 +1,69 @@
+#include "data_layer/data_layer.hpp"
+#include "search_layer/search_layer.hpp"
+#include "epoch/epoch.hpp"
+#include "debug/debug.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace DiStore;
+using namespace DiStore::SearchLayer;
+using namespace DiStore::DataLayer;
+using namespace DiStore::Memory;
+
+// every worker publishes split anchors while others search and remove
+auto main() -> int {
+    SkipList slist;
+    const int threads = 8;
+    const int per_thread = 20000;
+    const auto start = 1000000UL;
+
+    std::atomic<size_t> removed = 0;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < per_thread; i++) {
+                auto k = start + i * threads + t;
+                Epoch::Guard guard;
+                slist.insert(std::to_string(k), RemotePointer::make_remote_pointer(0, k),
+                             LinkedNodeType::Type10);
+
+                // remove every odd key inserted by the previous worker
+                auto victim = std::to_string(start + i * threads + (t + threads - 1) % threads);
+                if (i % 2 == 1 && slist.remove(victim)) {
+                    ++removed;
+                }
+
+                auto node = slist.fuzzy_search(std::to_string(k));
+                if (node->anchor > Anchor::make_anchor(std::to_string(k))) {
+                    Debug::error("Fuzzy search of %lu returns %s\n", k, node->anchor.to_string().c_str());
+                    exit(-1);
+                }
+            }
+        });
+    }
+
+    for (auto &w : workers) {
+        w.join();
+    }
+
+    size_t count = 0;
+    auto prev = slist.iter();
+    for (auto walker = prev->next(); walker; prev = walker, walker = walker->next()) {
+        if (walker->anchor <= prev->anchor) {
+            Debug::error("%s follows %s\n", walker->anchor.to_string().c_str(), prev->anchor.to_string().c_str());
+            return -1;
+        }
+        ++count;
+    }
+
+    if (count != threads * per_thread - removed) {
+        Debug::error("%lu anchors are linked, but %lu are expected\n", count, threads * per_thread - removed);
+        return -1;
+    }
+
+    slist.show_levels();
+    Debug::info("%lu anchors are linked\n", count);
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include "workload/workload.hpp"
 #include "stats/stats.hpp"
 #include <chrono>
+#include <fstream>
 #include <stdexcept>
 
 using namespace CmdParser;
@@ -11,10 +12,9 @@ using namespace DiStore;
 
 size_t total = 0;
 
-auto launch_compute_ycsb(const std::string &config, const std::string &memory_nodes,
-                         int threads, Workload::YCSBWorkloadType workload_type) -> void {
-    auto node = Cluster::ComputeNode::make_compute_node(config, memory_nodes);
-
+auto launch_compute_ycsb(std::unique_ptr<Cluster::ComputeNode> node, int threads,
+                         Workload::YCSBWorkloadType workload_type, bool async,
+                         const std::optional<std::string> &stats_out) -> void {
     if (node == nullptr) {
         Debug::error("Wow you can do a really bad job\n");
         return;
@@ -47,7 +47,8 @@ auto launch_compute_ycsb(const std::string &config, const std::string &memory_no
     auto start = std::chrono::steady_clock::now();
     for (int i = 0; i < threads; i++) {
         workers.emplace_back([&](int tid) {
-            if (!node->register_thread()) {
+            auto worker = node->register_thread();
+            if (!worker) {
                 Debug::error("Failed to register a thread\n");
                 return;
             }
@@ -57,27 +58,24 @@ auto launch_compute_ycsb(const std::string &config, const std::string &memory_no
                 ;
 
             if (tid == 0) {
-                Stats::Breakdown b(1000000);
                 auto warm = total;
                 if (workload_type == Workload::YCSBWorkloadType::YCSB_L) {
                     warm /= 10;
                 }
 
                 Debug::info("Populating %lu items\n", warm);
+                std::vector<std::pair<std::string, std::string>> pairs;
+                pairs.reserve(warm);
                 for (size_t i = 0; i < warm; i++) {
-                    auto k = std::to_string(i);
-                    k.insert(0, Workload::Constants::KEY_SIZE - k.size(), '0');
-
-                    if (!node->put(k, k, &b)) {
-                        Debug::error("Putting key %s failed\n", k.c_str());
-                        return;
-                    }
+                    auto k = Workload::make_key(i);
+                    pairs.emplace_back(k, k);
+                }
 
-                    if ((i % 500000) == 0) {
-                        std::cout << i << " items populated\n";
-                    }
+                // keys are zero-padded, so they ascend as i does
+                if (!node->bulk_load(pairs.begin(), pairs.end())) {
+                    Debug::error("Bulk loading %lu items failed\n", warm);
+                    return;
                 }
-                b.clear();
                 go = true;
             } else {
                 while(!go)
@@ -86,39 +84,65 @@ auto launch_compute_ycsb(const std::string &config, const std::string &memory_no
 
             auto total_counter = 0;
 
-            Stats::Breakdown breakdown(sample_batch);
-            Stats::Operation operation(sample_batch);
+            // operations over the handle record into its breakdown
+            auto &breakdown = worker->breakdown;
+            Stats::Operation operation;
+
+            // synchronous operations reuse these buffers and allocate nothing
+            char key_buffer[Workload::Constants::KEY_SIZE];
+            Memory::byte_t value[DataLayer::Constants::VALLEN];
+            Memory::byte_t scanned[100 * DataLayer::Constants::VALLEN];
 
             for (size_t i = 0; i < total / threads; i++) {
-                auto op = ycsb->next();
-                switch (op.first) {
+                auto type = ycsb->next(key_buffer);
+                auto key = std::string_view(key_buffer, sizeof(key_buffer));
+                if (async && type != Workload::YCSBOperation::Scan) {
+                    auto k = std::string(key);
+                    auto on_done = [k](bool succeed, std::optional<std::string>) {
+                        if (!succeed) {
+                            Debug::error("Async operation on %s failed\n", k.c_str());
+                        }
+                    };
+
+                    if (type == Workload::YCSBOperation::Insert) {
+                        node->async_put(k, k, on_done);
+                    } else if (type == Workload::YCSBOperation::Update) {
+                        node->async_update(k, k, on_done);
+                    } else {
+                        node->async_get(k, on_done);
+                    }
+                    node->poll_async();
+                    continue;
+                }
+
+                switch (type) {
                 case Workload::YCSBOperation::Insert:
                     operation.begin(Stats::DiStoreOperationOps::Put);
-                    if (!node->put(op.second, op.second, &breakdown)) {
-                        Debug::error("Putting %s failed\n", op.second.c_str());
+                    if (!node->put(*worker, key, key)) {
+                        Debug::error("Putting %.*s failed\n", (int)key.size(), key.data());
                         return;
                     }
                     operation.end(Stats::DiStoreOperationOps::Put);
                     break;
                 case Workload::YCSBOperation::Update:
                     operation.begin(Stats::DiStoreOperationOps::Update);
-                    if (!node->update(op.second, op.second, &breakdown)) {
-                        Debug::error("Updating %s failed\n", op.second.c_str());
+                    if (!node->update(*worker, key, key)) {
+                        Debug::error("Updating %.*s failed\n", (int)key.size(), key.data());
                         return;
                     }
                     operation.end(Stats::DiStoreOperationOps::Update);
                     break;
                 case Workload::YCSBOperation::Search:
                     operation.begin(Stats::DiStoreOperationOps::Get);
-                    if (auto v = node->get(op.second, &breakdown); !v.has_value()) {
-                        Debug::error("Searching %s failed\n", op.second.c_str());
+                    if (!node->get(*worker, key, value)) {
+                        Debug::error("Searching %.*s failed\n", (int)key.size(), key.data());
                         return;
                     }
                     operation.end(Stats::DiStoreOperationOps::Get);
                     break;
                 case Workload::YCSBOperation::Scan:
                     operation.begin(Stats::DiStoreOperationOps::Scan);
-                    node->scan(op.second, 100, &breakdown);
+                    node->scan(*worker, key, 100, scanned);
                     operation.end(Stats::DiStoreOperationOps::Scan);
                     break;
                 default:
@@ -140,6 +164,14 @@ auto launch_compute_ycsb(const std::string &config, const std::string &memory_no
                 }
             }
 
+            if (async) {
+                node->wait_async();
+            }
+
+            // samples since the last report
+            breakdown.submit(breakdown_collectors[tid]);
+            operation.submit(operation_collectors[tid]);
+
         }, i);
     }
 
@@ -164,6 +196,28 @@ auto launch_compute_ycsb(const std::string &config, const std::string &memory_no
         operation_collectors[i].summarize();
     }
 
+    // tails are taken over the samples of all threads rather than averaged over threads
+    Stats::StatsCollector breakdown_all;
+    Stats::StatsCollector operation_all;
+    for (int i = 0; i < threads; i++) {
+        breakdown_all.merge(breakdown_collectors[i]);
+        operation_all.merge(operation_collectors[i]);
+    }
+    Debug::info("Performance of all threads\n");
+    operation_all.summarize();
+
+    if (stats_out.has_value()) {
+        std::ofstream operation_json(stats_out.value() + ".operation.json");
+        std::ofstream operation_csv(stats_out.value() + ".operation.csv");
+        std::ofstream breakdown_json(stats_out.value() + ".breakdown.json");
+        std::ofstream breakdown_csv(stats_out.value() + ".breakdown.csv");
+        operation_all.to_json(operation_json);
+        operation_all.to_csv(operation_csv);
+        breakdown_all.to_json(breakdown_json);
+        breakdown_all.to_csv(breakdown_csv);
+        Debug::info("Latency histograms are exported to %s.*\n", stats_out.value().c_str());
+    }
+
     node->report_search_layer_stats();
     node->report_data_layer_stats();
     Debug::info("You may see segfault due to the destruction of RDMAContext,"
@@ -186,7 +240,7 @@ auto launch_compute(const std::string &config, const std::string &memory_nodes,
     auto total = 10000000UL;
     auto guard = std::to_string(0);
     // guard.append(DataLayer::Constants::KEYLEN - guard.size(), '0');
-    Stats::Breakdown breakdown(1000);
+    Stats::Breakdown breakdown;
     std::cout << "Populating\n";
     for (size_t i = 0; i < total; i++) {
         auto k = std::to_string(total + i);
@@ -248,6 +302,11 @@ auto main(int argc, char *argv[]) -> int {
     parser.add_option<int>("--threads", "-T", 1);
     parser.add_option<size_t>("--size", "-s", 10000000);
     parser.add_option<std::string>("--workload", "-w", "C");
+    parser.add_option<size_t>("--mem_cap", "-M", 4096);
+    parser.add_option<uint64_t>("--latency", "-l", 0);
+    parser.add_option<int>("--loopback_nodes", "-n", 1);
+    parser.add_switch("--async", "-a", false);
+    parser.add_option("--stats_out", "-o");
 
     parser.parse(argc, argv);
 
@@ -257,6 +316,27 @@ auto main(int argc, char *argv[]) -> int {
     auto threads = parser.get_as<int>("--threads").value();
     total = parser.get_as<size_t>("--size").value();
     auto workload = parser.get_as<std::string>("--workload").value();
+    auto mem_cap = parser.get_as<size_t>("--mem_cap").value();
+    auto latency = parser.get_as<uint64_t>("--latency").value();
+    auto loopback_nodes = parser.get_as<int>("--loopback_nodes").value();
+    auto async = parser.get_as<bool>("--async").value();
+    auto stats_out = parser.get_as<std::string>("--stats_out");
+
+    Workload::YCSBWorkloadType workload_type;
+    if (workload == "A") {
+        workload_type = Workload::YCSBWorkloadType::YCSB_A;
+    } else if (workload == "B") {
+        workload_type = Workload::YCSBWorkloadType::YCSB_B;
+    } else if (workload == "C") {
+        workload_type = Workload::YCSBWorkloadType::YCSB_C;
+    } else if (workload == "L") {
+        workload_type = Workload::YCSBWorkloadType::YCSB_L;
+    } else if (workload == "R") {
+        workload_type = Workload::YCSBWorkloadType::YCSB_R;
+    } else {
+        Debug::error("Other YCSB workloads are not supported\n");
+        return -1;
+    }
 
     if (type == "compute") {
         if (!config.has_value()) {
@@ -269,26 +349,19 @@ auto main(int argc, char *argv[]) -> int {
             return -1;
         }
 
-        Workload::YCSBWorkloadType workload_type;
-        if (workload == "A") {
-            workload_type = Workload::YCSBWorkloadType::YCSB_A;
-        } else if (workload == "B") {
-            workload_type = Workload::YCSBWorkloadType::YCSB_B;
-        } else if (workload == "C") {
-            workload_type = Workload::YCSBWorkloadType::YCSB_C;
-        } else if (workload == "L") {
-            workload_type = Workload::YCSBWorkloadType::YCSB_L;
-        } else if (workload == "R") {
-            workload_type = Workload::YCSBWorkloadType::YCSB_R;
-        } else {
-            Debug::error("Other YCSB workloads are not supported\n");
-            return -1;
-        }
-
         Debug::info("Running %d-thread benchmark YCSB %s with %lu operations\n",
                     threads, workload.c_str(), total);
 
-        launch_compute_ycsb(config.value(), memory_nodes.value(), threads, workload_type);
+        launch_compute_ycsb(Cluster::ComputeNode::make_compute_node(config.value(), memory_nodes.value()),
+                            threads, workload_type, async, stats_out);
+    } else if (type == "loopback") {
+        // --mem_cap is in MiB per memory node, --latency in ns per RDMA completion
+        Debug::info("Running %d-thread loopback benchmark YCSB %s with %lu operations on %d memory nodes\n",
+                    threads, workload.c_str(), total, loopback_nodes);
+
+        launch_compute_ycsb(Cluster::ComputeNode::make_loopback_compute_node(mem_cap << 20, latency,
+                                                                             loopback_nodes),
+                            threads, workload_type, async, stats_out);
     } else if (type == "memory") {
         if (!config.has_value()) {
             Debug::error("Please offer a configuration file to configure current node\n");